@@ -12,135 +12,117 @@
  * Code updated in the period 2017-2018 by Jochen Jankowai
  *
  *************************************************************************************************/
+#include <algorithm>
 #include <cassert>
+#include <fstream>
 #include <gtc/type_ptr.hpp>
 #include <Decimation/DecimationMesh.h>
+#include <Decimation/ProgressiveMesh.h>
 #include <GUI/GUI.h>
 
 const DecimationMesh::VisualizationMode DecimationMesh::CollapseCost =
     NewVisualizationMode("Collapse cost");
 
 void DecimationMesh::Initialize() {
+    // The boundary half-edges have to exist before the flags are sized
+    mConn.BuildBoundary();
+    const size_t numEdges = GetNumEdges();
+
     // Allocate memory for the 'collapsed flags'
-    mCollapsedVerts.reserve(mVerts.size());
-    mCollapsedEdges.reserve(mEdges.size());
-    mCollapsedFaces.reserve(mFaces.size());
+    mCollapsedVerts.reserve(GetNumVerts());
+    mCollapsedEdges.reserve(numEdges);
+    mCollapsedFaces.reserve(GetNumFaces());
 
     // Set all flags to false
-    mCollapsedVerts.assign(mVerts.size(), false);
-    mCollapsedEdges.assign(mEdges.size(), false);
-    mCollapsedFaces.assign(mFaces.size(), false);
+    mCollapsedVerts.assign(GetNumVerts(), 0);
+    mCollapsedEdges.assign(numEdges, 0);
+    mCollapsedFaces.assign(GetNumFaces(), 0);
 
     // Allocate memory for the references from half-edge
     // to edge collapses
-    mHalfEdge2EdgeCollapse.reserve(mEdges.size());
-    mHalfEdge2EdgeCollapse.assign(mEdges.size(), NULL);
-
-    // Loop through the half-edges (we know they are stored
-    // sequentially) and create an edge collapse operation
-    // for each pair
-    auto numCollapses = mEdges.size() / 2;
-    for (size_t i = 0; i < numCollapses; i++) {
-        EdgeCollapse* collapse = new EdgeCollapse();
-
-        // Connect the edge collapse with the half-edge pair
-        collapse->halfEdge = i * 2;
-
-        // Check if the collapse is valid
-        if (!isValidCollapse(collapse)) {
-            delete collapse;
-        } else {
-            mHalfEdge2EdgeCollapse[i * 2] = collapse;
-            mHalfEdge2EdgeCollapse[i * 2 + 1] = collapse;
-
-            // Compute the cost and push it to the heap
-            computeCollapse(collapse);
-            mHeap.push(collapse);
-        }
+    mHalfEdge2EdgeCollapse.reserve(numEdges);
+    mHalfEdge2EdgeCollapse.assign(numEdges, NULL);
+
+    // One edge collapse for each pair, owned by its lower half-edge. The
+    // pool is filled completely before any pointer into it is taken
+    mCollapses.clear();
+    mCollapses.reserve(numEdges / 2);
+    for (size_t i = 0; i < numEdges; i++) {
+        if (EdgePair(i) > i) mCollapses.push_back(EdgeCollapse(i));
+    }
+    mHeap.clear();
+    mSplits.clear();
+    mNumAppliedSplits = 0;
+    mHeap.reserve(mCollapses.size(), mCollapses.size());
+
+    // The collapses don't depend on each other before the first one is
+    // done, so validity and cost are evaluated in parallel
+    std::vector<uint8_t> valid(mCollapses.size(), 0);
+    ParallelFor(0, mCollapses.size(), [&](size_t i) {
+        if (!isValidCollapse(&mCollapses[i])) return;
+        valid[i] = 1;
+        computeCollapse(&mCollapses[i]);
+    });
+
+    for (size_t i = 0; i < mCollapses.size(); i++) {
+        // Invalid collapses stay in the pool but never enter the heap
+        if (!valid[i]) continue;
+
+        EdgeCollapse& collapse = mCollapses[i];
+        mHalfEdge2EdgeCollapse[collapse.halfEdge] = &collapse;
+        mHalfEdge2EdgeCollapse[EdgePair(collapse.halfEdge)] = &collapse;
+        mHeap.append(i, collapse.cost);
     }
+    // Building the heap bottom up is linear, pushing one by one is not
+    mHeap.heapify();
     // mHeap.print(std::cout);
 
     HalfEdgeMesh::Initialize();
 }
 
 void DecimationMesh::Update() {
+    // A vertex marked by an earlier collapse may have been collapsed since
+    for (size_t i : mDirtyVerts) {
+        if (isVertexCollapsed(i)) mVertFlags[i] = 0;
+    }
+    mDirtyVerts.erase(std::remove_if(mDirtyVerts.begin(), mDirtyVerts.end(),
+                                     [this](size_t i) { return isVertexCollapsed(i); }),
+                      mDirtyVerts.end());
+    if (UpdateDirtyRegion()) return;
+
     // Calculate and store all differentials and area
 
     // First update all face normals and triangle areas
-    for (size_t i = 0; i < GetNumFaces(); i++) {
-        if (!isFaceCollapsed(i)) f(i).normal = FaceNormal(i);
-    }
-    // Then update all vertex normals and curvature
-    for (size_t i = 0; i < GetNumVerts(); i++) {
+    std::vector<glm::vec3>& faceNormals = mFaceAttribs.Normals();
+    ParallelFor(0, GetNumFaces(), [&](size_t i) {
+        if (!isFaceCollapsed(i)) faceNormals[i] = FaceNormal(i);
+    });
+    // Then update all vertex normals
+    std::vector<glm::vec3>& vertNormals = mVertAttribs.Normals();
+    ParallelFor(0, GetNumVerts(), [&](size_t i) {
         // Vertex normals are just weighted averages
-        if (!isVertexCollapsed(i)) mVerts.at(i).normal = VertexNormal(i);
-    }
-
-    // Then update vertex curvature
-    for (size_t i = 0; i < GetNumVerts(); i++) {
-        if (!isVertexCollapsed(i)) mVerts.at(i).curvature = VertexCurvature(i);
-        //    std::cerr <<   mVerts.at(i).curvature << "\n";
-    }
-
-    // Finally update face curvature
-    for (size_t i = 0; i < GetNumFaces(); i++) {
-        if (!isFaceCollapsed(i)) f(i).curvature = FaceCurvature(i);
+        if (!isVertexCollapsed(i)) vertNormals[i] = VertexNormal(i);
+    });
+
+    // The curvature only if it is shown or kept
+    if (NeedsCurvature()) {
+        std::vector<float>& vertCurvature = mVertAttribs.Curvature();
+        ParallelFor(0, GetNumVerts(), [&](size_t i) {
+            if (!isVertexCollapsed(i)) vertCurvature[i] = VertexCurvature(i);
+        });
+
+        std::vector<float>& faceCurvature = mFaceAttribs.Curvature();
+        ParallelFor(0, GetNumFaces(), [&](size_t i) {
+            if (!isFaceCollapsed(i)) faceCurvature[i] = FaceCurvature(i);
+        });
     }
+    ClearDirty();
 
     //  std::cerr << "Area: " << Area() << ".\n";
     //  std::cerr << "Volume: " << Volume() << ".\n";
 
     // Update vertex and face colors
-    // TODO: Make a common function for all meshes
-    if (!mColorMap) {
-        return;
-    }
-
-    float minCurvature = std::numeric_limits<float>::max();
-    float maxCurvature = -std::numeric_limits<float>::max();
-
-    if (!mAutoMinMax) {
-        minCurvature = mMinCMap;
-        maxCurvature = mMaxCMap;
-    }
-
-    if (mVisualizationMode == CurvatureVertex) {
-        if (!mAutoMinMax) {
-            std::cerr << "Mapping color based on vertex curvature with range [" << mMinCMap << ","
-                      << mMaxCMap << "]" << std::endl;
-        } else {
-            // Compute range from vertices
-            for (auto& vert : mVerts) {
-                if (minCurvature > vert.curvature) minCurvature = vert.curvature;
-                if (maxCurvature < vert.curvature) maxCurvature = vert.curvature;
-            }
-            std::cerr << "Automatic mapping of color based on vertex curvature with range ["
-                      << minCurvature << "," << maxCurvature << "]" << std::endl;
-            mMinCMap = minCurvature;
-            mMaxCMap = maxCurvature;
-        }
-        for (auto& vert : mVerts) {
-            vert.color = mColorMap->Map(vert.curvature, minCurvature, maxCurvature);
-        }
-    } else if (mVisualizationMode == CurvatureFace) {
-        if (!mAutoMinMax) {
-            std::cerr << "Mapping color based on face curvature with range [" << mMinCMap << ","
-                      << mMaxCMap << "]" << std::endl;
-        } else {
-            // Compute range from faces
-            for (auto& face : mFaces) {
-                if (minCurvature > face.curvature) minCurvature = face.curvature;
-                if (maxCurvature < face.curvature) maxCurvature = face.curvature;
-            }
-            std::cerr << "Automatic mapping of color based on face curvature with range ["
-                      << minCurvature << "," << maxCurvature << "]" << std::endl;
-            mMinCMap = minCurvature;
-            mMaxCMap = maxCurvature;
-        }
-        for (auto& face : mFaces) {
-            face.color = mColorMap->Map(face.curvature, minCurvature, maxCurvature);
-        }
-    }
+    MapCurvatureColors(mVertAttribs, mFaceAttribs);
 }
 
 bool DecimationMesh::decimate(size_t targetFaces) {
@@ -149,176 +131,430 @@ bool DecimationMesh::decimate(size_t targetFaces) {
         targetFaces = 2;
     }
 
-    // Keep collapsing one edge at a time until the target is reached
-    // or the heap is empty (when we have no possible collapses left)
-    while (mFaces.size() - mNumCollapsedFaces > targetFaces && !mHeap.isEmpty()) {
-        decimate();
+    // Recorded collapses undone by SetLevelOfDetail are redone before the heap is used
+    while (GetNumFaces() - mNumCollapsedFaces > targetFaces &&
+           mNumAppliedSplits < mSplits.size()) {
+        redoCollapse(mSplits[mNumAppliedSplits++]);
+    }
+
+    if (mBatchFraction > 0) {
+        decimateInRounds(targetFaces);
+    } else {
+        // Keep collapsing one edge at a time until the target is reached
+        // or the heap is empty (when we have no possible collapses left)
+        while (GetNumFaces() - mNumCollapsedFaces > targetFaces && !mHeap.isEmpty() &&
+               !errorBoundReached()) {
+            decimate();
+        }
+    }
+    if (errorBoundReached()) {
+        std::cout << "Stopped at the error bound " << mErrorBound << std::endl;
     }
     // Return true if target is reached
-    std::cout << "Collapsed mesh to " << mFaces.size() - mNumCollapsedFaces << " faces"
+    std::cout << "Collapsed mesh to " << GetNumFaces() - mNumCollapsedFaces << " faces"
               << std::endl;
-    return mFaces.size() - mNumCollapsedFaces == targetFaces;
+    return GetNumFaces() - mNumCollapsedFaces == targetFaces;
 }
 
 bool DecimationMesh::decimate() {
-    EdgeCollapse* collapse = static_cast<EdgeCollapse*>(mHeap.pop());
-    if (collapse == NULL) {
+    if (mNumAppliedSplits < mSplits.size()) {
+        redoCollapse(mSplits[mNumAppliedSplits++]);
+        return true;
+    }
+    if (mHeap.isEmpty() || errorBoundReached()) {
         return false;
     }
+    EdgeCollapse* collapse = &mCollapses[mHeap.pop()];
     // Stop the collapse when we only have two triangles left
     // (the smallest entity representable)
-    if (mFaces.size() - mNumCollapsedFaces == 2) {
+    if (GetNumFaces() - mNumCollapsedFaces == 2) {
         return false;
     }
 
     size_t e1 = collapse->halfEdge;
-    size_t e2 = mEdges[e1].pair;
-
-    size_t v1 = mEdges[e1].vert;
-    size_t v2 = mEdges[e2].vert;
-    size_t v3 = mEdges[mEdges[e1].prev].vert;
-    size_t v4 = mEdges[mEdges[e2].prev].vert;
-
-    size_t f1 = mEdges[e1].face;
-    size_t f2 = mEdges[e2].face;
+    size_t e2 = EdgePair(e1);
 
 #ifndef NDEBUG
-    std::cout << "Collapsing faces " << f1 << " and " << f2 << std::endl;
-    std::cout << "Collapsing edges " << e1 << ", " << mEdges[e1].next << ", " << mEdges[e1].prev;
-    std::cout << ", " << e2 << ", " << mEdges[e2].next << " and " << mEdges[e2].prev << std::endl;
-    std::cout << "Collapsing vertex " << v1 << std::endl;
+    std::cout << "Collapsing faces " << EdgeFace(e1) << " and " << EdgeFace(e2) << std::endl;
+    std::cout << "Collapsing edges " << e1 << ", " << EdgeNext(e1) << ", " << EdgePrev(e1);
+    std::cout << ", " << e2 << ", " << EdgeNext(e2) << " and " << EdgePrev(e2) << std::endl;
+    std::cout << "Collapsing vertex " << EdgeVert(e1) << std::endl;
 #endif
 
     // Verify that the collapse is valid, exit if not so
     if (!isValidCollapse(collapse)) {
-        delete collapse;
         mHalfEdge2EdgeCollapse[e1] = NULL;
         mHalfEdge2EdgeCollapse[e2] = NULL;
         std::cout << "failed..." << std::endl;
         return false;
     }
 
-    // We want to remove v1, so we need to connect all of v1's half-edges to v2
-    size_t edge = mVerts[v1].edge;
-    do {
-        mEdges[edge].vert = v2;
-        edge = mEdges[mEdges[edge].pair].next;
-    } while (edge != mVerts[v1].edge);
-
-    // Make sure v2 points to a valid edge
-    while (mEdges[mVerts[v2].edge].face == f1 || mEdges[mVerts[v2].edge].face == f2) {
-        mVerts[v2].edge = mEdges[mEdges[mVerts[v2].edge].pair].next;
+    if (mRecordSplits) {
+        mSplits.push_back(recordSplit(*collapse));
+        mNumAppliedSplits++;
     }
 
-    // Make sure v3 points to a valid edge
-    while (mEdges[mVerts[v3].edge].face == f1) {
-        mVerts[v3].edge = mEdges[mEdges[mVerts[v3].edge].pair].next;
-    }
+    std::vector<size_t> removed, changed, invalid;
+    const size_t v2 = applyCollapse(collapse, removed);
+    countCollapses(1);
+    MarkVertexDirty(v2);
 
-    // Make sure v4 points to a valid edge
-    while (mEdges[mVerts[v4].edge].face == f2) {
-        mVerts[v4].edge = mEdges[mEdges[mVerts[v4].edge].pair].next;
+    // One edge collapse further removes 2 additional collapse
+    // candidates from the heap
+    for (size_t handle : removed) mHeap.remove(handle);
+
+    // Finally, loop through neighborhood of v2 and update all edge collapses
+    // (and remove possible invalid cases)
+    updateNeighborhood(v2, changed, invalid);
+    for (size_t handle : invalid) {
+        mHeap.remove(handle);
+#ifndef NDEBUG
+        std::cout << "Removed one invalid edge collapse" << std::endl;
+#endif
     }
+    for (size_t handle : changed) mHeap.update(handle, mCollapses[handle].cost);
 
-    // Redirect pair pointers
-    mEdges[mEdges[mEdges[e1].next].pair].pair = mEdges[mEdges[e1].prev].pair;
-    mEdges[mEdges[mEdges[e1].prev].pair].pair = mEdges[mEdges[e1].next].pair;
+    // mHeap.print(std::cout);
 
-    mEdges[mEdges[mEdges[e2].next].pair].pair = mEdges[mEdges[e2].prev].pair;
-    mEdges[mEdges[mEdges[e2].prev].pair].pair = mEdges[mEdges[e2].next].pair;
+    return true;
+}
 
-    // Move v2 to its new position
-    mVerts[v2].pos = collapse->position;
+size_t DecimationMesh::applyCollapse(EdgeCollapse* collapse, std::vector<size_t>& removed) {
+    size_t e1 = collapse->halfEdge;
+    size_t e2 = EdgePair(e1);
 
-    // One edge collapse further removes 2 additional collapse
-    // candidates from the heap
-    if (mHalfEdge2EdgeCollapse[mEdges[e1].prev] != NULL) {
-        delete mHeap.remove(mHalfEdge2EdgeCollapse[mEdges[e1].prev]);
+    // The collapses of the edges that are merged into others vanish
+    if (mHalfEdge2EdgeCollapse[EdgePrev(e1)] != NULL) {
+        removed.push_back(collapseHandle(mHalfEdge2EdgeCollapse[EdgePrev(e1)]));
     }
-    mHalfEdge2EdgeCollapse[mEdges[mEdges[e1].prev].pair] = mHalfEdge2EdgeCollapse[mEdges[e1].next];
+    mHalfEdge2EdgeCollapse[EdgePair(EdgePrev(e1))] = mHalfEdge2EdgeCollapse[EdgeNext(e1)];
 
-    if (mHalfEdge2EdgeCollapse[mEdges[e2].next] != NULL) {
-        delete mHeap.remove(mHalfEdge2EdgeCollapse[mEdges[e2].next]);
+    if (mHalfEdge2EdgeCollapse[EdgeNext(e2)] != NULL) {
+        removed.push_back(collapseHandle(mHalfEdge2EdgeCollapse[EdgeNext(e2)]));
     }
-    mHalfEdge2EdgeCollapse[mEdges[mEdges[e2].next].pair] = mHalfEdge2EdgeCollapse[mEdges[e2].prev];
+    mHalfEdge2EdgeCollapse[EdgePair(EdgeNext(e2))] = mHalfEdge2EdgeCollapse[EdgePrev(e2)];
 
     // Make sure the edge collapses point to valid edges
-    if (mHalfEdge2EdgeCollapse[mEdges[e1].next] != NULL) {
-        mHalfEdge2EdgeCollapse[mEdges[e1].next]->halfEdge = mEdges[mEdges[e1].prev].pair;
+    if (mHalfEdge2EdgeCollapse[EdgeNext(e1)] != NULL) {
+        mHalfEdge2EdgeCollapse[EdgeNext(e1)]->halfEdge = EdgePair(EdgePrev(e1));
+    }
+    if (mHalfEdge2EdgeCollapse[EdgePrev(e2)] != NULL) {
+        mHalfEdge2EdgeCollapse[EdgePrev(e2)]->halfEdge = EdgePair(EdgeNext(e2));
+    }
+
+    // Move v2 to its new position, its one-ring is refreshed by the next Update
+    mPositions[EdgeVert(e2)] = collapse->position;
+
+    return collapseConnectivity(e1);
+}
+
+size_t DecimationMesh::collapseConnectivity(size_t e1) {
+    size_t e2 = EdgePair(e1);
+
+    size_t v1 = EdgeVert(e1);
+    size_t v2 = EdgeVert(e2);
+    size_t v3 = EdgeVert(EdgePrev(e1));
+    size_t v4 = EdgeVert(EdgePrev(e2));
+
+    size_t f1 = EdgeFace(e1);
+    size_t f2 = EdgeFace(e2);
+
+    // We want to remove v1, so we need to connect all of v1's half-edges to v2
+    size_t edge = VertEdge(v1);
+    do {
+        SetEdgeVert(edge, v2);
+        edge = EdgeNext(EdgePair(edge));
+    } while (edge != VertEdge(v1));
+
+    // Make sure v2 points to a valid edge
+    while (EdgeFace(VertEdge(v2)) == f1 || EdgeFace(VertEdge(v2)) == f2) {
+        SetVertEdge(v2, EdgeNext(EdgePair(VertEdge(v2))));
     }
-    if (mHalfEdge2EdgeCollapse[mEdges[e2].prev] != NULL) {
-        mHalfEdge2EdgeCollapse[mEdges[e2].prev]->halfEdge = mEdges[mEdges[e2].next].pair;
+
+    // Make sure v3 points to a valid edge
+    while (EdgeFace(VertEdge(v3)) == f1) {
+        SetVertEdge(v3, EdgeNext(EdgePair(VertEdge(v3))));
     }
 
-    delete collapse;
+    // Make sure v4 points to a valid edge
+    while (EdgeFace(VertEdge(v4)) == f2) {
+        SetVertEdge(v4, EdgeNext(EdgePair(VertEdge(v4))));
+    }
+
+    // Redirect pair pointers
+    SetEdgePair(EdgePair(EdgeNext(e1)), EdgePair(EdgePrev(e1)));
+    SetEdgePair(EdgePair(EdgePrev(e1)), EdgePair(EdgeNext(e1)));
+
+    SetEdgePair(EdgePair(EdgeNext(e2)), EdgePair(EdgePrev(e2)));
+    SetEdgePair(EdgePair(EdgePrev(e2)), EdgePair(EdgeNext(e2)));
 
     // Collapse the neighborhood
     collapseFace(f1);
     collapseFace(f2);
 
     collapseEdge(e1);
-    collapseEdge(mEdges[e1].next);
-    collapseEdge(mEdges[e1].prev);
+    collapseEdge(EdgeNext(e1));
+    collapseEdge(EdgePrev(e1));
 
     collapseEdge(e2);
-    collapseEdge(mEdges[e2].next);
-    collapseEdge(mEdges[e2].prev);
+    collapseEdge(EdgeNext(e2));
+    collapseEdge(EdgePrev(e2));
 
     collapseVertex(v1);
 
-    // Finally, loop through neighborhood of v2 and update all edge collapses
-    // (and remove possible invalid cases)
-    updateVertexProperties(v2);
-    edge = mVerts[v2].edge;
+    return v2;
+}
+
+/*!
+ * The collapse leaves the half-edges of the two removed faces untouched,
+ * apart from the origin of e1 and of the half-edge after e2. Their pairs
+ * still name the outer half-edges they were paired with, so the split
+ * only has to pair those back and walk the fan of v1 to hand it its
+ * half-edges again.
+ */
+void DecimationMesh::splitVertex(VertexSplit& split) {
+    const size_t e1 = split.halfEdge;
+    const size_t e2 = EdgePair(e1);
+    const size_t v1 = split.vert;
+    const size_t v2 = EdgeVert(e2);
+
+    const size_t inner[4] = {EdgeNext(e1), EdgePrev(e1), EdgeNext(e2), EdgePrev(e2)};
+    for (size_t edge : inner) SetEdgePair(EdgePair(edge), edge);
+
+    size_t edge = e1;
     do {
-        size_t face = mEdges[edge].face;
-        size_t vert = mEdges[mEdges[edge].pair].vert;
-        if (!isFaceCollapsed(face)) updateFaceProperties(face);
-        if (!isVertexCollapsed(vert)) updateVertexProperties(vert);
-
-        collapse = mHalfEdge2EdgeCollapse[edge];
-        if (collapse != NULL) {
-            if (!isValidCollapse(collapse)) {
-                delete mHeap.remove(collapse);
-                mHalfEdge2EdgeCollapse[edge] = NULL;
-                mHalfEdge2EdgeCollapse[mEdges[edge].pair] = NULL;
-#ifndef NDEBUG
-                std::cout << "Removed one invalid edge collapse" << std::endl;
-#endif
-            } else {
-                computeCollapse(collapse);
-                mHeap.update(collapse);
-            }
+        SetEdgeVert(edge, v1);
+        edge = EdgeNext(EdgePair(edge));
+    } while (edge != e1);
+    SetVertEdge(v1, e1);
+    // The outgoing edge of v2 may have gone to v1
+    SetVertEdge(v2, e2);
+
+    std::swap(mPositions[v2], split.position);
+
+    mCollapsedFaces[EdgeFace(e1)] = 0;
+    mCollapsedFaces[EdgeFace(e2)] = 0;
+    for (size_t edge : {e1, EdgeNext(e1), EdgePrev(e1), e2, EdgeNext(e2), EdgePrev(e2)}) {
+        mCollapsedEdges[edge] = 0;
+    }
+    mCollapsedVerts[v1] = 0;
+    mNumCollapsedVerts--;
+    mNumCollapsedEdges -= 6;
+    mNumCollapsedFaces -= 2;
+
+    MarkVertexDirty(v1);
+    MarkVertexDirty(v2);
+}
+
+void DecimationMesh::redoCollapse(VertexSplit& split) {
+    const size_t v2 = EdgeVert(EdgePair(split.halfEdge));
+    std::swap(mPositions[v2], split.position);
+    collapseConnectivity(split.halfEdge);
+    countCollapses(1);
+    MarkVertexDirty(v2);
+}
+
+DecimationMesh::VertexSplit DecimationMesh::recordSplit(const EdgeCollapse& collapse) const {
+    VertexSplit split;
+    split.vert = static_cast<uint32_t>(EdgeVert(collapse.halfEdge));
+    split.halfEdge = static_cast<uint32_t>(collapse.halfEdge);
+    split.position = mPositions[EdgeVert(EdgePair(collapse.halfEdge))];
+    return split;
+}
+
+size_t DecimationMesh::SetLevelOfDetail(size_t numFaces) {
+    while (GetNumFaces() - mNumCollapsedFaces < numFaces && mNumAppliedSplits > 0) {
+        splitVertex(mSplits[--mNumAppliedSplits]);
+    }
+    while (GetNumFaces() - mNumCollapsedFaces >= numFaces + 2 &&
+           mNumAppliedSplits < mSplits.size()) {
+        redoCollapse(mSplits[mNumAppliedSplits++]);
+    }
+    return GetNumFaces() - mNumCollapsedFaces;
+}
+
+void DecimationMesh::updateNeighborhood(size_t vert, std::vector<size_t>& changed,
+                                        std::vector<size_t>& invalid) {
+    updateVertexProperties(vert);
+    for (size_t edge : EdgesAroundVertex(vert)) {
+        size_t face = EdgeFace(edge);
+        size_t other = EdgeVert(EdgePair(edge));
+        if (face != EdgeState::Border && !isFaceCollapsed(face)) updateFaceProperties(face);
+        if (!isVertexCollapsed(other)) updateVertexProperties(other);
+        recomputeCollapse(edge, changed, invalid);
+    }
+    if (recomputeRadius() < 2) return;
+
+    // The edges around the one-ring, their costs read the faces that moved with vert
+    const auto isNeighbor = [&](size_t v) {
+        for (size_t nb : VerticesAroundVertex(vert)) {
+            if (nb == v) return true;
+        }
+        return false;
+    };
+    for (size_t nb : VerticesAroundVertex(vert)) {
+        for (size_t edge : EdgesAroundVertex(nb)) {
+            // The edges to vert are done, those between two neighbors from the lower one
+            const size_t far = EdgeVert(EdgePair(edge));
+            if (far == vert || (far < nb && isNeighbor(far))) continue;
+            recomputeCollapse(edge, changed, invalid);
         }
+    }
+}
 
-        edge = mEdges[mEdges[edge].pair].next;
-    } while (edge != mVerts[v2].edge);
+void DecimationMesh::recomputeCollapse(size_t edge, std::vector<size_t>& changed,
+                                       std::vector<size_t>& invalid) {
+    EdgeCollapse* collapse = mHalfEdge2EdgeCollapse[edge];
+    if (collapse == NULL) return;
+    if (!isValidCollapse(collapse)) {
+        invalid.push_back(collapseHandle(collapse));
+        mHalfEdge2EdgeCollapse[edge] = NULL;
+        mHalfEdge2EdgeCollapse[EdgePair(edge)] = NULL;
+    } else {
+        computeCollapse(collapse);
+        changed.push_back(collapseHandle(collapse));
+    }
+}
 
-    // mHeap.print(std::cout);
+bool DecimationMesh::claimNeighborhood(const EdgeCollapse& collapse,
+                                       std::vector<uint8_t>& claimed,
+                                       std::vector<size_t>& claimedVerts) {
+    const size_t ends[2] = {EdgeVert(collapse.halfEdge), EdgeVert(EdgePair(collapse.halfEdge))};
 
+    // The region grows ring by ring, marked 2 until it is known to be free
+    const size_t first = claimedVerts.size();
+    const auto release = [&]() {
+        for (size_t i = first; i < claimedVerts.size(); i++) claimed[claimedVerts[i]] = 0;
+        claimedVerts.resize(first);
+        return false;
+    };
+    for (size_t v : ends) {
+        if (claimed[v] == 1) return release();
+        claimed[v] = 2;
+        claimedVerts.push_back(v);
+    }
+    size_t ringStart = first;
+    for (size_t ring = 0; ring < recomputeRadius(); ring++) {
+        const size_t ringEnd = claimedVerts.size();
+        for (size_t i = ringStart; i < ringEnd; i++) {
+            for (size_t u : VerticesAroundVertex(claimedVerts[i])) {
+                if (claimed[u] == 1) return release();
+                if (claimed[u] == 2) continue;
+                claimed[u] = 2;
+                claimedVerts.push_back(u);
+            }
+        }
+        ringStart = ringEnd;
+    }
+    for (size_t i = first; i < claimedVerts.size(); i++) claimed[claimedVerts[i]] = 1;
     return true;
 }
 
-void DecimationMesh::updateVertexProperties(size_t ind) {
-    std::vector<size_t> neighborFaces = FindNeighborFaces(ind);
+/*!
+ * Two collapses whose end vertices and recomputeRadius() rings around them
+ * are disjoint neither touch the same half-edges when rewiring the mesh
+ * nor the same vertices, faces or collapses when refreshing their
+ * neighborhood. A round picks such a set greedily in cost order, applies
+ * it in parallel, refreshes the neighborhoods in parallel and only then
+ * updates the heap serially.
+ */
+void DecimationMesh::decimateInRounds(size_t targetFaces) {
+    // The streams written by the property updates must exist before the
+    // threads start, requesting them in parallel would race
+    mVertAttribs.Normals();
+    mFaceAttribs.Normals();
+
+    std::vector<uint8_t> claimed(GetNumVerts(), 0), valid;
+    std::vector<size_t> claimedVerts, candidates, selected, kept;
+    std::vector<std::vector<size_t>> removed, changed, invalid;
+
+    while (GetNumFaces() - mNumCollapsedFaces > targetFaces && !mHeap.isEmpty() &&
+           !errorBoundReached()) {
+        // Every collapse removes two faces, and two faces are the least we keep
+        const size_t numFaces = GetNumFaces() - mNumCollapsedFaces;
+        const size_t maxCollapses =
+            std::min((numFaces - targetFaces + 1) / 2, (numFaces - 2) / 2);
+        if (maxCollapses == 0) break;
+
+        // The cheapest candidates within the error bound, their validity can
+        // be checked in parallel as nothing changes before the round is picked
+        const size_t numCandidates = std::min(
+            mHeap.size(), std::max<size_t>(1, static_cast<size_t>(mBatchFraction * mHeap.size())));
+        candidates.clear();
+        while (candidates.size() < numCandidates && mHeap.topKey() <= mErrorBound) {
+            candidates.push_back(mHeap.pop());
+        }
+        valid.assign(candidates.size(), 0);
+        ParallelFor(0, candidates.size(), [&](size_t i) {
+            valid[i] = isValidCollapse(&mCollapses[candidates[i]]);
+        });
+
+        // Pick the independent set in cost order, the others wait for a later round
+        selected.clear();
+        for (size_t i = 0; i < candidates.size(); i++) {
+            EdgeCollapse& collapse = mCollapses[candidates[i]];
+            if (!valid[i]) {
+                mHalfEdge2EdgeCollapse[collapse.halfEdge] = NULL;
+                mHalfEdge2EdgeCollapse[EdgePair(collapse.halfEdge)] = NULL;
+            } else if (selected.size() < maxCollapses &&
+                       claimNeighborhood(collapse, claimed, claimedVerts)) {
+                selected.push_back(candidates[i]);
+            } else {
+                mHeap.push(candidates[i], collapse.cost);
+            }
+        }
+        for (size_t v : claimedVerts) claimed[v] = 0;
+        claimedVerts.clear();
+
+        const size_t numSelected = selected.size();
+        if (mRecordSplits) {
+            for (size_t handle : selected) mSplits.push_back(recordSplit(mCollapses[handle]));
+            mNumAppliedSplits += numSelected;
+        }
+        kept.resize(numSelected);
+        removed.resize(numSelected);
+        changed.resize(numSelected);
+        invalid.resize(numSelected);
+
+        ParallelFor(0, numSelected, [&](size_t i) {
+            removed[i].clear();
+            kept[i] = applyCollapse(&mCollapses[selected[i]], removed[i]);
+        });
+        countCollapses(numSelected);
+        for (size_t i = 0; i < numSelected; i++) {
+            for (size_t handle : removed[i]) mHeap.remove(handle);
+            MarkVertexDirty(kept[i]);
+        }
+
+        // The neighborhoods are refreshed once all collapses of the round are done
+        ParallelFor(0, numSelected, [&](size_t i) {
+            changed[i].clear();
+            invalid[i].clear();
+            updateNeighborhood(kept[i], changed[i], invalid[i]);
+        });
+        for (size_t i = 0; i < numSelected; i++) {
+            for (size_t handle : invalid[i]) mHeap.remove(handle);
+            for (size_t handle : changed[i]) mHeap.update(handle, mCollapses[handle].cost);
+        }
+    }
+}
 
+void DecimationMesh::updateVertexProperties(size_t ind) {
     // Approximate vertex normal
     glm::vec3 n(0, 0, 0);
 
-    const auto numCandidates = neighborFaces.size();
-    for (size_t i = 0; i < numCandidates; i++) {
-        Face& triangle = mFaces[neighborFaces[i]];
-
+    for (size_t face : FacesAroundVertex(ind)) {
+        if (face == EdgeState::Border) continue;
         // Calculate face normal
-        HalfEdge* edge = &mEdges[triangle.edge];
+        size_t edge = FaceEdge(face);
 
-        glm::vec3& p0 = mVerts[edge->vert].pos;
-        edge = &mEdges[edge->next];
+        const glm::vec3& p0 = mPositions[EdgeVert(edge)];
+        edge = EdgeNext(edge);
 
-        glm::vec3& p1 = mVerts[edge->vert].pos;
-        edge = &mEdges[edge->next];
+        const glm::vec3& p1 = mPositions[EdgeVert(edge)];
+        edge = EdgeNext(edge);
 
-        glm::vec3& p2 = mVerts[edge->vert].pos;
+        const glm::vec3& p2 = mPositions[EdgeVert(edge)];
 
         glm::vec3 v1 = p1 - p0;
         glm::vec3 v2 = p2 - p0;
@@ -329,19 +565,19 @@ void DecimationMesh::updateVertexProperties(size_t ind) {
     }
 
     n = glm::normalize(n);
-    mVerts[ind].normal = n;
+    mVertAttribs.Normals()[ind] = n;
 }
 
 void DecimationMesh::updateFaceProperties(size_t ind) {
-    HalfEdge* edge = &mEdges[mFaces[ind].edge];
+    size_t edge = FaceEdge(ind);
 
-    glm::vec3& p0 = mVerts[edge->vert].pos;
-    edge = &mEdges[edge->next];
+    const glm::vec3& p0 = mPositions[EdgeVert(edge)];
+    edge = EdgeNext(edge);
 
-    glm::vec3& p1 = mVerts[edge->vert].pos;
-    edge = &mEdges[edge->next];
+    const glm::vec3& p1 = mPositions[EdgeVert(edge)];
+    edge = EdgeNext(edge);
 
-    glm::vec3& p2 = mVerts[edge->vert].pos;
+    const glm::vec3& p2 = mPositions[EdgeVert(edge)];
 
     // Calculate face normal
     glm::vec3 v1 = p1 - p0;
@@ -349,47 +585,267 @@ void DecimationMesh::updateFaceProperties(size_t ind) {
     glm::vec3 n = glm::cross(v1, v2);
     n = glm::normalize(n);
 
-    mFaces[ind].normal = n;
+    mFaceAttribs.Normals()[ind] = n;
 }
 
 bool DecimationMesh::isValidCollapse(EdgeCollapse* collapse) {
     size_t e1 = collapse->halfEdge;
-    size_t e2 = mEdges[e1].pair;
+    size_t e2 = EdgePair(e1);
 
-    size_t v1 = mEdges[e1].vert;
-    size_t v2 = mEdges[e2].vert;
-    size_t v3 = mEdges[mEdges[e1].prev].vert;
-    size_t v4 = mEdges[mEdges[e2].prev].vert;
+    size_t v1 = EdgeVert(e1);
+    size_t v2 = EdgeVert(e2);
+    size_t v3 = EdgeVert(EdgePrev(e1));
+    size_t v4 = EdgeVert(EdgePrev(e2));
 
     // Do a dummy check
     if (isEdgeCollapsed(e1) || isEdgeCollapsed(e1) || isVertexCollapsed(v1) ||
         isVertexCollapsed(v2))
         return false;
 
-    size_t edge = mVerts[v2].edge;
-    std::vector<size_t> neighbors;
-    do {
-        size_t ind = mEdges[mEdges[edge].pair].vert;
-        if (ind != v3 && ind != v4) neighbors.push_back(ind);
-        edge = mEdges[mEdges[edge].pair].next;
-    } while (edge != mVerts[v2].edge);
+    // A boundary edge has one face and an interior edge between two boundary
+    // vertices would pinch the mesh, collapseConnectivity handles neither
+    if (EdgeFace(e1) == EdgeState::Border || EdgeFace(e2) == EdgeState::Border ||
+        (isBoundaryVertex(v1) && isBoundaryVertex(v2)))
+        return false;
 
-    edge = mVerts[v1].edge;
-    do {
-        size_t ind = mEdges[mEdges[edge].pair].vert;
-        if (find(neighbors.begin(), neighbors.end(), ind) != neighbors.end()) {
+    // v1 and v2 may only share the two opposite corners v3 and v4,
+    // anything else would fold the mesh
+    for (size_t ind2 : VerticesAroundVertex(v2)) {
+        if (ind2 == v3 || ind2 == v4) continue;
+        for (size_t ind1 : VerticesAroundVertex(v1)) {
+            if (ind1 == ind2) return false;
+        }
+    }
+
+    return true;
+}
+
+bool DecimationMesh::Save(std::ostream& os, MeshFormat format) {
+    // Number the remaining vertices and faces consecutively
+    std::vector<size_t> verts, faces;
+    std::vector<uint32_t> newIndex(GetNumVerts(), 0);
+    verts.reserve(GetNumVerts() - mNumCollapsedVerts);
+    faces.reserve(GetNumFaces() - mNumCollapsedFaces);
+    for (size_t i = 0; i < GetNumVerts(); i++) {
+        if (isVertexCollapsed(i)) continue;
+        newIndex[i] = static_cast<uint32_t>(verts.size());
+        verts.push_back(i);
+    }
+    for (size_t i = 0; i < GetNumFaces(); i++) {
+        if (!isFaceCollapsed(i)) faces.push_back(i);
+    }
+
+    return WriteMesh(
+        os, format, "DecimationMesh", mVertAttribs.HasNormals(), mVertAttribs.HasColors(),
+        verts.size(),
+        [&](size_t i) { return GetVertex(verts[i]); }, faces.size(),
+        [&](size_t i) {
+            const size_t edge = FaceEdge(faces[i]);
+            return glm::uvec3(newIndex[EdgeVert(edge)], newIndex[EdgeVert(EdgeNext(edge))],
+                              newIndex[EdgeVert(EdgePrev(edge))]);
+        });
+}
+
+/*!
+ * The error bound of a level only applies while it is decimated, the one
+ * set with SetErrorBound stays in force for all of them. A level the
+ * mesh is already past is written as it is.
+ */
+size_t DecimationMesh::DecimateLevels(const std::vector<LevelOfDetail>& levels,
+                                      const std::function<bool(size_t level)>& write) {
+    const float errorBound = mErrorBound;
+    size_t numWritten = 0;
+    for (const LevelOfDetail& level : levels) {
+        mErrorBound = std::min(errorBound, level.maxCost);
+        decimate(level.numFaces);
+        mErrorBound = errorBound;
+
+        if (!write(numWritten)) break;
+        numWritten++;
+    }
+    return numWritten;
+}
+
+bool DecimationMesh::SaveLevelsOfDetail(const std::vector<LevelOfDetail>& levels,
+                                        const std::string& filename) {
+    const size_t dot = filename.find_last_of('.');
+    const size_t slash = filename.find_last_of("/\\");
+    const bool hasExtension =
+        dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    const std::string stem = hasExtension ? filename.substr(0, dot) : filename;
+    const std::string extension = hasExtension ? filename.substr(dot) : std::string(".obj");
+    const MeshFormat format = MeshFormatFromFilename(filename);
+
+    const size_t numWritten = DecimateLevels(levels, [&](size_t level) {
+        const std::string path = stem + "_lod" + std::to_string(level) + extension;
+        std::ios::openmode mode = std::ios::out;
+        if (format != MeshFormat::Obj) mode |= std::ios::binary;
+        std::ofstream out(path.c_str(), mode);
+        if (!out || !Save(out, format)) {
+            std::cerr << "Error: could not write level of detail " << path << std::endl;
             return false;
         }
+        std::cout << "Wrote " << GetNumFaces() - mNumCollapsedFaces << " faces to " << path
+                  << std::endl;
+        return true;
+    });
+    return numWritten == levels.size();
+}
+
+/*!
+ * The mesh is coarsened along the record to the base mesh, which is
+ * written, and then refined split by split, each written once it is
+ * applied. It is left at the level it had.
+ */
+bool DecimationMesh::SaveProgressive(std::ostream& os) {
+    const size_t numFaces = GetNumFaces() - mNumCollapsedFaces;
+    while (mNumAppliedSplits < mSplits.size()) redoCollapse(mSplits[mNumAppliedSplits++]);
+
+    ProgressiveMeshHeader header = ProgressiveMeshHeader::Make(
+        GetNumVerts(), GetNumFaces(), GetNumVerts() - mNumCollapsedVerts,
+        GetNumFaces() - mNumCollapsedFaces, mSplits.size());
+    header.SwapToHost();
+
+    BufferedWriter out(os);
+    out.Write(&header, sizeof(header));
+    const auto writeVec = [&out](const glm::vec3& v) {
+        for (int k = 0; k < 3; k++) out.WriteLittleEndian(v[k]);
+    };
+    for (size_t i = 0; i < GetNumVerts(); i++) {
+        if (isVertexCollapsed(i)) continue;
+        out.WriteLittleEndian(uint32_t(i));
+        writeVec(mPositions[i]);
+    }
+    for (size_t i = 0; i < GetNumFaces(); i++) {
+        if (isFaceCollapsed(i)) continue;
+        out.WriteLittleEndian(uint32_t(i));
+        for (size_t k = 0; k < 3; k++) out.WriteLittleEndian(uint32_t(EdgeVert(3 * i + k)));
+    }
+
+    std::vector<uint32_t> fan;
+    while (mNumAppliedSplits > 0) {
+        VertexSplit& split = mSplits[--mNumAppliedSplits];
+        splitVertex(split);
+
+        const size_t e1 = split.halfEdge, e2 = EdgePair(e1);
+        const size_t v1 = split.vert, v2 = EdgeVert(e2);
+        // The half-edges of v1 outside the two new faces came from v2
+        fan.clear();
+        for (size_t edge = EdgeNext(EdgePair(EdgeNext(e2))); edge != e1;
+             edge = EdgeNext(EdgePair(edge))) {
+            if (EdgeFace(edge) != EdgeState::Border) fan.push_back(static_cast<uint32_t>(edge));
+        }
 
-        edge = mEdges[mEdges[edge].pair].next;
-    } while (edge != mVerts[v1].edge);
+        const uint32_t words[6] = {uint32_t(v1), uint32_t(v2), uint32_t(e1), uint32_t(e2),
+                                   uint32_t(EdgeVert(EdgePrev(e1))),
+                                   uint32_t(EdgeVert(EdgePrev(e2)))};
+        for (uint32_t w : words) out.WriteLittleEndian(w);
+        writeVec(mPositions[v1]);
+        writeVec(mPositions[v2]);
+        out.WriteLittleEndian(uint32_t(fan.size()));
+        for (uint32_t edge : fan) out.WriteLittleEndian(edge);
+    }
 
-    return true;
+    SetLevelOfDetail(numFaces);
+    return out.Flush();
 }
 
+/*!
+ * Live vertices, faces and half-edges keep their order. Face f moves to
+ * face newFace[f], so its inner half-edges move from 3f + k to
+ * 3 newFace[f] + k, and the live boundary half-edges follow the inner
+ * ones. With the maps in place every link is remapped independently.
+ */
 void DecimationMesh::Cleanup() {
-    //  HalfEdgeMesh mesh;
-    //  *this = mesh;
+    // The attributes are compacted as they are, so they have to be up to date
+    if (mAllDirty || !mDirtyVerts.empty() || !mDirtyFaces.empty()) Update();
+
+    const uint32_t Dead = static_cast<uint32_t>(EdgeState::Uninitialized);
+    const size_t numEdges = GetNumEdges(), numInner = mConn.NumInner();
+    std::vector<uint32_t> verts, faces, boundary;
+    std::vector<uint32_t> newVert(GetNumVerts(), Dead), newEdge(numEdges, Dead);
+    for (size_t i = 0; i < GetNumVerts(); i++) {
+        if (isVertexCollapsed(i)) continue;
+        newVert[i] = static_cast<uint32_t>(verts.size());
+        verts.push_back(static_cast<uint32_t>(i));
+    }
+    for (size_t i = 0; i < GetNumFaces(); i++) {
+        if (isFaceCollapsed(i)) continue;
+        for (size_t k = 0; k < 3; k++) {
+            newEdge[3 * i + k] = static_cast<uint32_t>(3 * faces.size() + k);
+        }
+        faces.push_back(static_cast<uint32_t>(i));
+    }
+    for (size_t i = numInner; i < numEdges; i++) {
+        if (isEdgeCollapsed(i)) continue;
+        newEdge[i] = static_cast<uint32_t>(3 * faces.size() + boundary.size());
+        boundary.push_back(static_cast<uint32_t>(i));
+    }
+
+    const size_t newInner = 3 * faces.size();
+    const size_t newEdges = newInner + boundary.size();
+    const auto oldEdge = [&](size_t h) {
+        return h < newInner ? 3 * size_t(faces[h / 3]) + h % 3 : size_t(boundary[h - newInner]);
+    };
+    std::vector<uint32_t> vert(newEdges), pair(newEdges), vertEdge(verts.size());
+    std::vector<uint32_t> boundaryNext(boundary.size()), boundaryPrev(boundary.size());
+    ParallelFor(0, newEdges, [&](size_t h) {
+        const size_t old = oldEdge(h);
+        vert[h] = newVert[EdgeVert(old)];
+        pair[h] = newEdge[EdgePair(old)];
+        if (h >= newInner) {
+            boundaryNext[h - newInner] = newEdge[EdgeNext(old)];
+            boundaryPrev[h - newInner] = newEdge[EdgePrev(old)];
+        }
+    });
+    ParallelFor(0, verts.size(), [&](size_t v) { vertEdge[v] = newEdge[VertEdge(verts[v])]; });
+
+    mConn.Assign(verts.size(), faces.size(), newEdges,
+                 [&](Connectivity::Index* vertArray, Connectivity::Index* pairArray,
+                     Connectivity::Index* vertEdgeArray, Connectivity::Index* nextArray,
+                     Connectivity::Index* prevArray) {
+                     std::copy(vert.begin(), vert.end(), vertArray);
+                     std::copy(pair.begin(), pair.end(), pairArray);
+                     std::copy(vertEdge.begin(), vertEdge.end(), vertEdgeArray);
+                     std::copy(boundaryNext.begin(), boundaryNext.end(), nextArray);
+                     std::copy(boundaryPrev.begin(), boundaryPrev.end(), prevArray);
+                 });
+
+    std::vector<glm::vec3> positions(verts.size());
+    ParallelFor(0, verts.size(), [&](size_t v) { positions[v] = mPositions[verts[v]]; });
+    mPositions.swap(positions);
+    mVertAttribs.Select(verts);
+    mFaceAttribs.Select(faces);
+
+    // Nothing is collapsed any more, the decimation state is dropped
+    mCollapsedVerts.assign(verts.size(), 0);
+    mCollapsedEdges.assign(newEdges, 0);
+    mCollapsedFaces.assign(faces.size(), 0);
+    mNumCollapsedVerts = mNumCollapsedEdges = mNumCollapsedFaces = 0;
+    std::vector<EdgeCollapse>().swap(mCollapses);
+    std::vector<EdgeCollapse*>().swap(mHalfEdge2EdgeCollapse);
+    std::vector<VertexSplit>().swap(mSplits);
+    mNumAppliedSplits = 0;
+    mHeap = IndexedHeap<float>();
+
+    ReleaseBuildIndex();
+    ClearDirty();
+}
+
+HalfEdgeMesh DecimationMesh::ExtractMesh() {
+    Cleanup();
+    HalfEdgeMesh mesh(std::move(static_cast<HalfEdgeMesh&>(*this)));
+
+    // What was moved from is left empty rather than half valid
+    mConn.Clear();
+    mPositions.clear();
+    mVertAttribs.clear();
+    mFaceAttribs.clear();
+    mCollapsedVerts.clear();
+    mCollapsedEdges.clear();
+    mCollapsedFaces.clear();
+    ClearDirty();
+    return mesh;
 }
 
 void DecimationMesh::Render() {
@@ -406,23 +862,24 @@ void DecimationMesh::Render() {
     if (mWireframe) glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     // Draw geometry
-    for (size_t i = 0; i < mFaces.size(); i++) {
+    for (size_t i = 0; i < GetNumFaces(); i++) {
         if (isFaceCollapsed(i)) {
             continue;
         }
 
         // Render without notations
-        Face& f = mFaces[i];
+        const glm::vec3 faceColor = mFaceAttribs.Color(i);
+        const glm::vec3 faceNormal = mFaceAttribs.Normal(i);
 
-        HalfEdge* edge = &mEdges[f.edge];
+        size_t edge = FaceEdge(i);
 
-        Vertex& v1 = mVerts[edge->vert];
-        edge = &mEdges[edge->next];
+        const Vertex v1 = GetVertex(EdgeVert(edge));
+        edge = EdgeNext(edge);
 
-        Vertex& v2 = mVerts[edge->vert];
-        edge = &mEdges[edge->next];
+        const Vertex v2 = GetVertex(EdgeVert(edge));
+        edge = EdgeNext(edge);
 
-        Vertex& v3 = mVerts[edge->vert];
+        const Vertex v3 = GetVertex(EdgeVert(edge));
 
         // Render with notations
         //  Uncomment this block, and comment the block above
@@ -492,8 +949,8 @@ void DecimationMesh::Render() {
             glNormal3fv(glm::value_ptr(v3.normal));
             glVertex3fv(glm::value_ptr(v3.pos));
         } else {
-            glColor3fv(glm::value_ptr(f.color));
-            glNormal3fv(glm::value_ptr(f.normal));
+            glColor3fv(glm::value_ptr(faceColor));
+            glNormal3fv(glm::value_ptr(faceNormal));
 
             glVertex3fv(glm::value_ptr(v1.pos));
             glVertex3fv(glm::value_ptr(v2.pos));
@@ -509,8 +966,8 @@ void DecimationMesh::Render() {
     if (mVisualizationMode == CollapseCost) {
         float minCost = std::numeric_limits<float>::max();
         float maxCost = -std::numeric_limits<float>::max();
-        for (auto iter = mEdges.begin(); iter != mEdges.end(); iter++) {
-            EdgeCollapse* collapse = mHalfEdge2EdgeCollapse.at(iter - mEdges.begin());
+        for (size_t ind = 0; ind < GetNumEdges(); ind++) {
+            EdgeCollapse* collapse = mHalfEdge2EdgeCollapse.at(ind);
             if (collapse != NULL) {
                 if (minCost > collapse->cost) minCost = collapse->cost;
                 if (maxCost < collapse->cost) maxCost = collapse->cost;
@@ -526,11 +983,10 @@ void DecimationMesh::Render() {
         glDisable(GL_LIGHTING);
         glEnable(GL_LINE_SMOOTH);
         glBegin(GL_LINES);
-        for (auto iter = mEdges.begin(); iter != mEdges.end(); iter++) {
-            size_t ind = iter - mEdges.begin();
+        for (size_t ind = 0; ind < GetNumEdges(); ind++) {
             if (!isEdgeCollapsed(ind)) {
-                const Vertex& v1 = v(e(ind).vert);
-                const Vertex& v2 = v(e(e(ind).pair).vert);
+                const glm::vec3& p1 = Position(EdgeVert(ind));
+                const glm::vec3& p2 = Position(EdgeVert(EdgePair(ind)));
 
                 EdgeCollapse* collapse = mHalfEdge2EdgeCollapse.at(ind);
                 if (collapse == NULL) {
@@ -539,8 +995,8 @@ void DecimationMesh::Render() {
                     glColor3fv(glm::value_ptr(mColorMap->Map(collapse->cost, minCost, maxCost)));
                 }
 
-                glVertex3fv(glm::value_ptr(v1.pos));
-                glVertex3fv(glm::value_ptr(v2.pos));
+                glVertex3fv(glm::value_ptr(p1));
+                glVertex3fv(glm::value_ptr(p2));
             }
         }
         glEnd();
@@ -1,9 +1,10 @@
 #pragma once
 
+#include <functional>
 #include <Decimation/DecimationInterface.h>
 #include <Geometry/HalfEdgeMesh.h>
 #include <Util/ColorMap.h>
-#include <Util/Heap.h>
+#include <Util/IndexedHeap.h>
 
 class DecimationMesh : public DecimationInterface, public HalfEdgeMesh {
 public:
@@ -14,11 +15,16 @@ public:
         return L;
     }
 
-    DecimationMesh() : mNumCollapsedVerts(0), mNumCollapsedEdges(0), mNumCollapsedFaces(0) {}
+    DecimationMesh()
+        : mNumCollapsedVerts(0), mNumCollapsedEdges(0), mNumCollapsedFaces(0),
+          mErrorBound(std::numeric_limits<float>::max()), mBatchFraction(0),
+          mRecordSplits(false), mNumAppliedSplits(0) {}
     virtual ~DecimationMesh() {}
 
-    /*! The EdgeCollapse is a Heapable type */
-    struct EdgeCollapse : public Heap::Heapable {
+    /*! An edge collapse candidate, ordered in the heap by its cost */
+    struct EdgeCollapse {
+        EdgeCollapse(size_t edge = 0) : cost(0), halfEdge(edge) {}
+        float cost;
         size_t halfEdge;
         glm::vec3 position;
     };
@@ -31,6 +37,80 @@ public:
 
     virtual bool decimate(size_t targetFaces);
 
+    /*! Makes decimate stop once the cheapest collapse costs more than
+     * maxCost, even if the target is not reached. The cost is in the unit
+     * of computeCollapse, e.g. the quadric error. No bound by default.
+     */
+    void SetErrorBound(float maxCost) { mErrorBound = maxCost; }
+
+    float GetErrorBound() const { return mErrorBound; }
+
+    /*! A level of detail for DecimateLevels, reached when the mesh has at
+     * most numFaces faces or the cheapest collapse costs more than maxCost
+     */
+    struct LevelOfDetail {
+        LevelOfDetail(size_t faces = 0, float cost = std::numeric_limits<float>::max())
+            : numFaces(faces), maxCost(cost) {}
+        size_t numFaces;
+        float maxCost;
+    };
+
+    /*! Decimates through the levels, each coarser than the one before, and
+     * calls write with the index of each level once it is reached. The
+     * whole chain takes one run instead of one per level. Stops early if
+     * write returns false.
+     * \return the number of levels written
+     */
+    size_t DecimateLevels(const std::vector<LevelOfDetail>& levels,
+                          const std::function<bool(size_t level)>& write);
+
+    /*! Writes the levels to files named after filename with _lod and the
+     * level index before the extension, e.g. bunny_lod0.obj, bunny_lod1.obj,
+     * in the format of the extension
+     */
+    bool SaveLevelsOfDetail(const std::vector<LevelOfDetail>& levels, const std::string& filename);
+
+    /*! Lets decimate(targetFaces) collapse edges in parallel rounds. Each
+     * round takes up to this fraction of the candidates off the heap,
+     * cheapest first, and collapses concurrently those whose neighborhoods
+     * (see recomputeRadius) don't overlap. The rest go back to the heap. A
+     * larger fraction gives more parallelism but strays further from the
+     * greedy order. 0, the default, collapses one edge at a time.
+     */
+    void SetBatchFraction(float fraction) { mBatchFraction = fraction; }
+
+    /*! Records every collapse from the next Initialize on as a vertex
+     * split, so that SetLevelOfDetail can move between the decimated
+     * meshes without decimating again.
+     */
+    void SetRecordSplits(bool record) { mRecordSplits = record; }
+
+    size_t GetNumVertexSplits() const { return mSplits.size(); }
+
+    /*! Undoes or redoes recorded collapses, each changing the mesh by two
+     * faces and a vertex, until it has the fewest faces not below
+     * numFaces that the record reaches. decimate continues from there.
+     * \return the number of faces reached
+     */
+    size_t SetLevelOfDetail(size_t numFaces);
+
+    /*! Writes the coarsest recorded mesh and all splits that refine it
+     * back to the initial mesh as a progressive mesh stream, see
+     * ProgressiveMesh.h
+     */
+    bool SaveProgressive(std::ostream& os);
+
+    /*! Removes the collapsed vertices, edges and faces from the arrays,
+     * renumbering the rest, and frees the heap, the collapses and the
+     * recorded splits. Call Initialize to decimate further.
+     */
+    virtual void Cleanup();
+
+    /*! Cleans up and moves the mesh out as a plain HalfEdgeMesh, leaving
+     * this one empty
+     */
+    HalfEdgeMesh ExtractMesh();
+
     virtual void Render() override;
 
     virtual const char* GetTypeName() { return typeid(DecimationMesh).name(); }
@@ -40,36 +120,111 @@ protected:
 
     virtual void updateFaceProperties(size_t ind);
 
+    //! Computes cost and position of a collapse. Initialize calls it from
+    //! several threads at once for different collapses, so it may only read the mesh
     virtual void computeCollapse(EdgeCollapse* collapse) = 0;
 
-    virtual void Cleanup();
-
     bool isValidCollapse(EdgeCollapse* collapse);
 
-    inline bool isVertexCollapsed(size_t ind) { return mCollapsedVerts[ind]; }
-    inline bool isEdgeCollapsed(size_t ind) { return mCollapsedEdges[ind]; }
-    inline bool isFaceCollapsed(size_t ind) { return mCollapsedFaces[ind]; }
+    /*! Rewires the mesh around a valid collapse and moves the kept vertex,
+     * without touching the heap or the collapse counters. The handles of
+     * the two collapses that vanish with the faces are added to removed.
+     * Collapses whose one-rings don't overlap may be applied concurrently.
+     * \return the kept vertex
+     */
+    size_t applyCollapse(EdgeCollapse* collapse, std::vector<size_t>& removed);
+
+    /*! Refreshes the properties around a vertex moved by a collapse and
+     * recomputes the collapses of the edges within recomputeRadius()
+     * rings. The handles of the recomputed ones are added to changed,
+     * those that became invalid to invalid. The heap is left alone, so
+     * this may run concurrently for vertices whose neighborhoods of that
+     * radius don't overlap.
+     */
+    void updateNeighborhood(size_t vert, std::vector<size_t>& changed,
+                            std::vector<size_t>& invalid);
+
+    /*! The rings of vertices around a collapsed vertex whose edges
+     * updateNeighborhood recomputes. 1 if the cost of an edge only depends
+     * on its end vertices, 2 if it reads the faces around them.
+     */
+    virtual size_t recomputeRadius() const { return 1; }
+
+    //! Recomputes the collapse of an edge, or drops it if it became invalid
+    void recomputeCollapse(size_t edge, std::vector<size_t>& changed,
+                           std::vector<size_t>& invalid);
+
+    /*! A recorded collapse. The collapse keeps the half-edges of the two
+     * removed faces, so the removed vertex and the half-edge from it to
+     * the kept vertex are enough to undo it.
+     */
+    struct VertexSplit {
+        //! The vertex removed by the collapse
+        uint32_t vert;
+        //! The collapsed half-edge, from vert to the kept vertex
+        uint32_t halfEdge;
+        //! Position of the kept vertex in the state the mesh is not in
+        glm::vec3 position;
+    };
+
+    //! The split that will undo collapse, to be taken before it is applied
+    VertexSplit recordSplit(const EdgeCollapse& collapse) const;
+
+    /*! Rewires the mesh for the collapse of half-edge e1 and marks the
+     * removed vertex, edges and faces as collapsed
+     * \return the kept vertex
+     */
+    size_t collapseConnectivity(size_t e1);
+
+    //! Undoes the recorded collapse, swapping the kept vertex position with the record
+    void splitVertex(VertexSplit& split);
+
+    //! Applies the recorded collapse again, without touching the heap
+    void redoCollapse(VertexSplit& split);
+
+    //! Collapses edges in parallel rounds until targetFaces are left, see SetBatchFraction
+    void decimateInRounds(size_t targetFaces);
 
-    inline void collapseVertex(size_t ind) {
-        mCollapsedVerts[ind] = true;
-        mNumCollapsedVerts++;
+    /*! Claims both end vertices of a collapse and recomputeRadius() rings
+     * around them for a round of decimateInRounds, unless one of them is
+     * claimed already. The newly claimed vertices are added to claimedVerts.
+     */
+    bool claimNeighborhood(const EdgeCollapse& collapse, std::vector<uint8_t>& claimed,
+                           std::vector<size_t>& claimedVerts);
+
+    //! True if the vertex has a boundary half-edge
+    bool isBoundaryVertex(size_t ind) const {
+        for (size_t face : FacesAroundVertex(ind)) {
+            if (face == EdgeState::Border) return true;
+        }
+        return false;
     }
+
+    inline bool isVertexCollapsed(size_t ind) { return mCollapsedVerts[ind] != 0; }
+    inline bool isEdgeCollapsed(size_t ind) { return mCollapsedEdges[ind] != 0; }
+    inline bool isFaceCollapsed(size_t ind) { return mCollapsedFaces[ind] != 0; }
+
+    //! The flags are set by applyCollapse, countCollapses updates the counters
+    inline void collapseVertex(size_t ind) { mCollapsedVerts[ind] = 1; }
     inline void collapseEdge(size_t ind) {
         mHalfEdge2EdgeCollapse[ind] = NULL;
-        mCollapsedEdges[ind] = true;
-        mNumCollapsedEdges++;
+        mCollapsedEdges[ind] = 1;
     }
-    inline void collapseFace(size_t ind) {
-        mCollapsedFaces[ind] = true;
-        mNumCollapsedFaces++;
+    inline void collapseFace(size_t ind) { mCollapsedFaces[ind] = 1; }
+
+    //! Counts numCollapses applied collapses of a vertex, 3 edges and 2 faces each
+    inline void countCollapses(size_t numCollapses) {
+        mNumCollapsedVerts += numCollapses;
+        mNumCollapsedEdges += 6 * numCollapses;
+        mNumCollapsedFaces += 2 * numCollapses;
     }
 
-    //! State array of 'active' verts
-    std::vector<bool> mCollapsedVerts;
+    //! State array of 'active' verts, bytes so that threads may set different flags
+    std::vector<uint8_t> mCollapsedVerts;
     //! State array of 'active' edges
-    std::vector<bool> mCollapsedEdges;
+    std::vector<uint8_t> mCollapsedEdges;
     //! State array of 'active' faces
-    std::vector<bool> mCollapsedFaces;
+    std::vector<uint8_t> mCollapsedFaces;
 
     //! Number of collapsed verts
     size_t mNumCollapsedVerts;
@@ -78,32 +233,40 @@ protected:
     //! Number of collapsed faces
     size_t mNumCollapsedFaces;
 
-    //! Utility mapping between half edges and collapses
+    //! decimate stops when the cheapest collapse costs more
+    float mErrorBound;
+
+    //! Fraction of the heap considered per round, 0 for one collapse at a time
+    float mBatchFraction;
+
+    //! Whether collapses are recorded in mSplits
+    bool mRecordSplits;
+    //! Recorded collapses in the order they were done
+    std::vector<VertexSplit> mSplits;
+    //! The first mNumAppliedSplits of mSplits are collapsed, the rest split again
+    size_t mNumAppliedSplits;
+
+    /*! One edge collapse per edge, allocated together in Initialize. The
+     * index of a collapse is its handle in mHeap.
+     */
+    std::vector<EdgeCollapse> mCollapses;
+
+    //! Utility mapping between half edges and collapses, points into mCollapses
     std::vector<EdgeCollapse*> mHalfEdge2EdgeCollapse;
 
-    //! The heap that stores the edge collapses
-    Heap mHeap;
+    //! The heap that orders the valid edge collapses by cost
+    IndexedHeap<float> mHeap;
 
-    void drawText(const glm::vec3& pos, const char* str);
+    //! True if the cheapest collapse left costs more than mErrorBound
+    bool errorBoundReached() const { return !mHeap.isEmpty() && mHeap.topKey() > mErrorBound; }
 
-    virtual bool save(std::ostream& os) {
-        os << "# DecimationMesh obj streamer\n# M&A 2008\n\n";
-        os << "# Vertices\n";
-        for (size_t i = 0; i < GetNumVerts(); i++) {
-            os << "v " << v(i).pos[0] << " " << v(i).pos[1] << " " << v(i).pos[2] << "\n";
-        }
-        os << "\n# Faces\n";
-        for (size_t i = 0; i < GetNumFaces(); i++) {
-            if (!isFaceCollapsed(i)) {
-                size_t ind = f(i).edge;
-                os << "f ";
-                os << e(ind).vert + 1 << " ";
-                ind = e(ind).next;
-                os << e(ind).vert + 1 << " ";
-                ind = e(ind).next;
-                os << e(ind).vert + 1 << "\n";
-            }
-        }
-        return os.good();
+    //! Handle of a collapse in mHeap
+    size_t collapseHandle(const EdgeCollapse* collapse) const {
+        return collapse - mCollapses.data();
     }
+
+    void drawText(const glm::vec3& pos, const char* str);
+
+    //! Writes the mesh without the collapsed vertices and faces
+    virtual bool Save(std::ostream& os, MeshFormat format) override;
 };
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cmath>
+#include <glm.hpp>
+
+/*! \brief Symmetric fundamental error quadric of Garland and Heckbert.
+ *
+ * The 4x4 matrix Q = p p^T of a plane p = (a, b, c, d) is symmetric, so
+ * only its 10 unique coefficients are stored, in the order
+ *
+ *   a2 ab ac ad b2 bc bd c2 cd d2
+ *
+ * The error of a point v is v^T A v + 2 b.v + c, with A the upper left
+ * 3x3 block, b the last column and c = d2. The coefficients are kept in
+ * Real, float halves the memory of a vertex quadric, while all
+ * evaluation and solving is done in double. Sums of many quadrics can be
+ * accumulated in an ErrorQuadricT<double> first.
+ */
+template <typename Real>
+class ErrorQuadricT {
+public:
+    //! The zero quadric
+    ErrorQuadricT() {
+        for (Real& c : mCoeff) c = 0;
+    }
+
+    //! The quadric of the plane n.x + d = 0, n is expected to be normalized
+    ErrorQuadricT(const glm::dvec3& n, double d) {
+        const double p[4] = {n.x, n.y, n.z, d};
+        size_t k = 0;
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = i; j < 4; j++) mCoeff[k++] = static_cast<Real>(p[i] * p[j]);
+        }
+    }
+
+    //! Converts between storage precisions
+    template <typename Other>
+    explicit ErrorQuadricT(const ErrorQuadricT<Other>& q) {
+        for (size_t i = 0; i < 10; i++) mCoeff[i] = static_cast<Real>(q[i]);
+    }
+
+    Real operator[](size_t i) const { return mCoeff[i]; }
+
+    template <typename Other>
+    ErrorQuadricT& operator+=(const ErrorQuadricT<Other>& q) {
+        for (size_t i = 0; i < 10; i++) mCoeff[i] += static_cast<Real>(q[i]);
+        return *this;
+    }
+
+    template <typename Other>
+    ErrorQuadricT operator+(const ErrorQuadricT<Other>& q) const {
+        ErrorQuadricT sum(*this);
+        return sum += q;
+    }
+
+    //! Scales the quadric, e.g. to weight a plane by the area of its face
+    ErrorQuadricT& operator*=(Real s) {
+        for (Real& c : mCoeff) c *= s;
+        return *this;
+    }
+
+    //! Squared distance measure of v to the planes of the quadric
+    double Evaluate(const glm::dvec3& v) const {
+        const double a2 = mCoeff[0], ab = mCoeff[1], ac = mCoeff[2], ad = mCoeff[3];
+        const double b2 = mCoeff[4], bc = mCoeff[5], bd = mCoeff[6];
+        const double c2 = mCoeff[7], cd = mCoeff[8], d2 = mCoeff[9];
+        return v.x * (a2 * v.x + 2 * (ab * v.y + ac * v.z + ad)) +
+               v.y * (b2 * v.y + 2 * (bc * v.z + bd)) + v.z * (c2 * v.z + 2 * cd) + d2;
+    }
+
+    /*! Finds the point of least error by solving A v = -b in closed form.
+     * Returns false, leaving v untouched, if A is singular or so badly
+     * conditioned that the minimum would be far off the surface, as for
+     * a quadric built from (nearly) coplanar faces. The caller then picks
+     * the best of some candidate points instead.
+     */
+    bool Minimize(glm::dvec3& v) const {
+        const double a2 = mCoeff[0], ab = mCoeff[1], ac = mCoeff[2], ad = mCoeff[3];
+        const double b2 = mCoeff[4], bc = mCoeff[5], bd = mCoeff[6];
+        const double c2 = mCoeff[7], cd = mCoeff[8];
+
+        // Cofactors of the symmetric A, which is also symmetric
+        const double c00 = b2 * c2 - bc * bc;
+        const double c01 = ac * bc - ab * c2;
+        const double c02 = ab * bc - ac * b2;
+        const double c11 = a2 * c2 - ac * ac;
+        const double c12 = ab * ac - a2 * bc;
+        const double c22 = a2 * b2 - ab * ab;
+        const double det = a2 * c00 + ab * c01 + ac * c02;
+
+        // The determinant relative to the cube of the matrix norm bounds
+        // the ratio of the smallest to the largest eigenvalue from below
+        const double norm2 =
+            a2 * a2 + b2 * b2 + c2 * c2 + 2 * (ab * ab + ac * ac + bc * bc);
+        if (!(std::abs(det) > MinConditioning * norm2 * std::sqrt(norm2))) return false;
+
+        const double inv = -1.0 / det;
+        v = glm::dvec3((c00 * ad + c01 * bd + c02 * cd) * inv,
+                       (c01 * ad + c11 * bd + c12 * cd) * inv,
+                       (c02 * ad + c12 * bd + c22 * cd) * inv);
+        return true;
+    }
+
+    //! The full matrix, e.g. for drawing the quadric
+    glm::mat4 ToMat4() const {
+        glm::mat4 Q;
+        size_t k = 0;
+        for (int i = 0; i < 4; i++) {
+            for (int j = i; j < 4; j++) {
+                Q[i][j] = Q[j][i] = static_cast<float>(mCoeff[k++]);
+            }
+        }
+        return Q;
+    }
+
+    //! Smallest relative determinant for which Minimize trusts the solution
+    static constexpr double MinConditioning = 1e-10;
+
+protected:
+    Real mCoeff[10];
+};
+
+typedef ErrorQuadricT<float> ErrorQuadric;
+typedef ErrorQuadricT<double> ErrorQuadricD;
@@ -0,0 +1,179 @@
+#include "MemorylessDecimationMesh.h"
+
+namespace {
+/*! Up to three linear constraints a.v = b on the new vertex. A constraint
+ * is only taken if it is not nearly a combination of the ones before it.
+ */
+class Constraints {
+public:
+    Constraints() : mCount(0) {}
+
+    size_t size() const { return mCount; }
+
+    void add(const glm::dvec3& a, double b) {
+        // Constraints closer than about a degree to the ones before are dropped
+        const double minSin2 = 3e-4;
+        const double aa = glm::dot(a, a);
+        bool independent = false;
+        if (mCount == 0) {
+            independent = aa > 0;
+        } else if (mCount == 1) {
+            const double d = glm::dot(mA[0], a);
+            const double aa0 = glm::dot(mA[0], mA[0]);
+            independent = aa0 * aa - d * d > minSin2 * aa0 * aa;
+        } else if (mCount == 2) {
+            const glm::dvec3 n = glm::cross(mA[0], mA[1]);
+            const double d = glm::dot(n, a);
+            independent = d * d > minSin2 * glm::dot(n, n) * aa;
+        }
+        if (independent) {
+            mA[mCount] = a;
+            mB[mCount] = b;
+            mCount++;
+        }
+    }
+
+    /*! Adds the constraints that minimize v.Hv/2 - c.v in the directions
+     * the constraints so far leave free
+     */
+    void addObjective(const glm::dmat3& H, const glm::dvec3& c) {
+        if (mCount == 0) {
+            for (int i = 0; i < 3; i++) add(H[i], c[i]);
+        } else if (mCount == 1) {
+            // Two directions orthogonal to the constraint
+            const glm::dvec3 n = glm::normalize(mA[0]);
+            const glm::dvec3 absN = glm::abs(n);
+            const int minAxis = absN[0] < absN[1] ? (absN[0] < absN[2] ? 0 : 2)
+                                                  : (absN[1] < absN[2] ? 1 : 2);
+            glm::dvec3 axis(0, 0, 0);
+            axis[minAxis] = 1;
+            const glm::dvec3 q1 = glm::normalize(glm::cross(n, axis));
+            const glm::dvec3 q2 = glm::cross(n, q1);
+            add(H * q1, glm::dot(q1, c));
+            add(H * q2, glm::dot(q2, c));
+        } else if (mCount == 2) {
+            const glm::dvec3 q = glm::normalize(glm::cross(mA[0], mA[1]));
+            add(H * q, glm::dot(q, c));
+        }
+    }
+
+    //! The point meeting all three constraints, false if there are fewer
+    bool solve(glm::dvec3& v) const {
+        if (mCount < 3) return false;
+        const glm::dmat3 A = glm::transpose(glm::dmat3(mA[0], mA[1], mA[2]));
+        if (glm::determinant(A) == 0) return false;
+        v = glm::inverse(A) * glm::dvec3(mB[0], mB[1], mB[2]);
+        return true;
+    }
+
+protected:
+    size_t mCount;
+    glm::dvec3 mA[3];
+    double mB[3];
+};
+}  // namespace
+
+/*!
+ * \param[in,out] collapse The edge collapse object to (re-)compute,
+ * DecimationMesh::EdgeCollapse
+ */
+void MemorylessDecimationMesh::computeCollapse(EdgeCollapse* collapse) {
+    const size_t v0 = EdgeVert(collapse->halfEdge);
+    const size_t v1 = EdgeVert(EdgePair(collapse->halfEdge));
+    const glm::dvec3 p0(Position(v0));
+    const glm::dvec3 p1(Position(v1));
+
+    // Sums over the faces around the edge, each once. With n the face normal
+    // scaled by twice the area and a a corner, n.(v - a) / 6 is the volume
+    // between the face and the new vertex
+    glm::dvec3 volumeNormal(0, 0, 0);
+    double volumeOffset = 0;
+    glm::dmat3 volumeH(0.0);
+    glm::dvec3 volumeC(0, 0, 0);
+    double volumeConst = 0;
+
+    // Sums over the boundary edges a -> b at the edge, the area swept by
+    // them is |v x (sum b - a) - sum a x b| / 2
+    glm::dvec3 boundaryEdge(0, 0, 0);
+    glm::dvec3 boundaryCross(0, 0, 0);
+    bool onBoundary = false;
+
+    for (size_t k = 0; k < 2; k++) {
+        const size_t vert = k == 0 ? v0 : v1;
+        const size_t other = k == 0 ? v1 : v0;
+        for (size_t face : FacesAroundVertex(vert)) {
+            if (face == EdgeState::Border) continue;
+
+            const size_t edge[3] = {FaceEdge(face), EdgeNext(FaceEdge(face)),
+                                    EdgePrev(FaceEdge(face))};
+            const size_t corner[3] = {EdgeVert(edge[0]), EdgeVert(edge[1]), EdgeVert(edge[2])};
+            // The faces at the edge are already visited from v0
+            if (k == 1 && (corner[0] == other || corner[1] == other || corner[2] == other)) {
+                continue;
+            }
+
+            const glm::dvec3 a(Position(corner[0]));
+            const glm::dvec3 b(Position(corner[1]));
+            const glm::dvec3 c(Position(corner[2]));
+            const glm::dvec3 n = glm::cross(b - a, c - a);
+            const double d = glm::dot(n, a);
+            volumeNormal += n;
+            volumeOffset += d;
+            volumeH += glm::outerProduct(n, n);
+            volumeC += d * n;
+            volumeConst += d * d;
+
+            for (size_t i = 0; i < 3; i++) {
+                const size_t from = corner[i];
+                const size_t to = corner[(i + 1) % 3];
+                if (EdgeFace(EdgePair(edge[i])) != EdgeState::Border) continue;
+                if (from != v0 && from != v1 && to != v0 && to != v1) continue;
+                const glm::dvec3 pa(Position(from));
+                const glm::dvec3 pb(Position(to));
+                boundaryEdge += pb - pa;
+                boundaryCross += glm::cross(pa, pb);
+                onBoundary = true;
+            }
+        }
+    }
+
+    // |v x e - f|^2 = v.Hv - 2 (e x f).v + f.f
+    const glm::dvec3& e = boundaryEdge;
+    const glm::dvec3& f = boundaryCross;
+    const glm::dmat3 boundaryH = glm::dot(e, e) * glm::dmat3(1.0) - glm::outerProduct(e, e);
+    const glm::dvec3 boundaryC = glm::cross(e, f);
+
+    // The new edges as short as possible, to keep the triangles well shaped
+    glm::dvec3 shapeC(0, 0, 0);
+    double numNeighbors = 0;
+    for (size_t k = 0; k < 2; k++) {
+        const size_t vert = k == 0 ? v0 : v1;
+        const size_t other = k == 0 ? v1 : v0;
+        for (size_t nb : VerticesAroundVertex(vert)) {
+            if (nb == other) continue;
+            shapeC += glm::dvec3(Position(nb));
+            numNeighbors++;
+        }
+    }
+
+    Constraints constraints;
+    constraints.add(volumeNormal, volumeOffset);
+    if (onBoundary) constraints.addObjective(boundaryH, boundaryC);
+    constraints.addObjective(volumeH, volumeC);
+    constraints.addObjective(numNeighbors * glm::dmat3(1.0), shapeC);
+
+    glm::dvec3 v;
+    if (!constraints.solve(v)) v = 0.5 * (p0 + p1);
+
+    // The error can't be negative, except for rounding
+    const double volumeCost =
+        std::max(glm::dot(v, volumeH * v) - 2 * glm::dot(volumeC, v) + volumeConst, 0.0) / 36;
+    double boundaryCost = 0;
+    if (onBoundary) {
+        boundaryCost = glm::dot(glm::cross(v, e) - f, glm::cross(v, e) - f) / 4;
+    }
+    const double length2 = glm::dot(p1 - p0, p1 - p0);
+
+    collapse->cost = static_cast<float>(0.5 * volumeCost + 0.5 * length2 * boundaryCost);
+    collapse->position = glm::vec3(v);
+}
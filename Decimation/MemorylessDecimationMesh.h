@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Decimation/DecimationMesh.h"
+
+/*! \brief Decimation that computes the collapses from the current mesh
+ * alone, as in Lindstrom and Turk, "Fast and Memory Efficient Polygonal
+ * Simplification".
+ *
+ * Unlike QuadricDecimationMesh nothing is accumulated per vertex, the
+ * cost of a collapse only looks at the faces around the edge as they are
+ * now. The new vertex is placed by linear constraints, taken in order of
+ * priority until three independent ones are found: the volume enclosed
+ * by the faces is kept, on the boundary the area swept by the boundary
+ * edges is least, then the volume swept by the faces is least and last
+ * the new edges are as short as possible. The cost is the volume swept by
+ * the faces plus the area swept by the boundary, weighted with the
+ * squared edge length to have the same unit.
+ */
+class MemorylessDecimationMesh : public virtual DecimationMesh {
+public:
+    MemorylessDecimationMesh() {}
+    virtual ~MemorylessDecimationMesh() {}
+
+protected:
+    //! Compute the cost and new position for an edge collapse
+    virtual void computeCollapse(EdgeCollapse* collapse);
+
+    //! The cost sums the faces around both end vertices, which move with their neighbors
+    virtual size_t recomputeRadius() const { return 2; }
+};
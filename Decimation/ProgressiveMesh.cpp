@@ -0,0 +1,167 @@
+#include <Decimation/ProgressiveMesh.h>
+#include <Util/Util.h>
+#include <cstring>
+
+namespace {
+const char Magic[8] = {'M', 'O', 'A', 'P', 'M', 0, 0, 0};
+
+// Reads n little endian 32 bit values, false if the stream ends first
+template <typename T>
+bool ReadWords(std::istream& is, T* data, size_t n) {
+    static_assert(sizeof(T) == 4, "only 32 bit values are stored");
+    is.read(reinterpret_cast<char*>(data), 4 * n);
+    if (!is) return false;
+    if (IsBigEndian()) EndianSwap(data, n);
+    return true;
+}
+}  // namespace
+
+ProgressiveMeshHeader ProgressiveMeshHeader::Make(size_t numVerts, size_t numFaces,
+                                                  size_t numBaseVerts, size_t numBaseFaces,
+                                                  size_t numSplits) {
+    ProgressiveMeshHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.numVerts = static_cast<uint32_t>(numVerts);
+    header.numFaces = static_cast<uint32_t>(numFaces);
+    header.numBaseVerts = static_cast<uint32_t>(numBaseVerts);
+    header.numBaseFaces = static_cast<uint32_t>(numBaseFaces);
+    header.numSplits = static_cast<uint32_t>(numSplits);
+    return header;
+}
+
+bool ProgressiveMeshHeader::IsSupported() const {
+    return std::memcmp(magic, Magic, sizeof(Magic)) == 0 && version == Version;
+}
+
+void ProgressiveMeshHeader::SwapToHost() {
+    if (!IsBigEndian()) return;
+    // Everything after the magic is 32 bit words
+    EndianSwap(&version, (sizeof(ProgressiveMeshHeader) - sizeof(magic)) / sizeof(uint32_t));
+}
+
+bool ProgressiveMeshStream::ReadBase(std::istream& is) {
+    mPositions.clear();
+    mCorners.clear();
+    mActiveFaces.clear();
+    mSplits.clear();
+    mFans.clear();
+    mNumApplied = 0;
+    mNumActiveFaces = 0;
+
+    is.read(reinterpret_cast<char*>(&mHeader), sizeof(mHeader));
+    if (!is) {
+        std::cerr << "Error: the stream is not a progressive mesh" << std::endl;
+        return false;
+    }
+    mHeader.SwapToHost();
+    if (!mHeader.IsSupported() || mHeader.numBaseVerts > mHeader.numVerts ||
+        mHeader.numBaseFaces > mHeader.numFaces) {
+        std::cerr << "Error: the stream is not a progressive mesh of version "
+                  << ProgressiveMeshHeader::Version << std::endl;
+        return false;
+    }
+
+    mPositions.assign(mHeader.numVerts, glm::vec3(0, 0, 0));
+    mCorners.assign(3 * size_t(mHeader.numFaces), 0);
+    mActiveFaces.assign(mHeader.numFaces, 0);
+
+    uint32_t vert[4];
+    for (size_t i = 0; i < mHeader.numBaseVerts; i++) {
+        if (!ReadWords(is, vert, 4) || vert[0] >= mHeader.numVerts) return false;
+        std::memcpy(&mPositions[vert[0]][0], vert + 1, sizeof(glm::vec3));
+    }
+    uint32_t face[4];
+    for (size_t i = 0; i < mHeader.numBaseFaces; i++) {
+        if (!ReadWords(is, face, 4) || face[0] >= mHeader.numFaces) return false;
+        for (size_t k = 0; k < 3; k++) {
+            if (face[k + 1] >= mHeader.numVerts) return false;
+            mCorners[3 * size_t(face[0]) + k] = face[k + 1];
+        }
+        if (!mActiveFaces[face[0]]) mNumActiveFaces++;
+        mActiveFaces[face[0]] = 1;
+    }
+    return true;
+}
+
+size_t ProgressiveMeshStream::ReadSplits(std::istream& is, size_t maxSplits) {
+    const size_t numHalfEdges = mCorners.size();
+    size_t numRead = 0;
+    while (numRead < maxSplits && mSplits.size() < mHeader.numSplits) {
+        uint32_t words[13];
+        if (!ReadWords(is, words, 13)) break;
+
+        VertexSplit split;
+        split.vert = words[0];
+        split.kept = words[1];
+        split.halfEdge[0] = words[2];
+        split.halfEdge[1] = words[3];
+        split.opposite[0] = words[4];
+        split.opposite[1] = words[5];
+        std::memcpy(&split.position[0], words + 6, sizeof(glm::vec3));
+        std::memcpy(&split.keptPosition[0], words + 9, sizeof(glm::vec3));
+        split.collapsedPosition = glm::vec3(0, 0, 0);
+
+        const size_t numFan = words[12];
+        split.fanBegin = mFans.size();
+        split.fanEnd = split.fanBegin + numFan;
+        mFans.resize(split.fanEnd);
+        if (numFan > numHalfEdges || !ReadWords(is, mFans.data() + split.fanBegin, numFan)) {
+            mFans.resize(split.fanBegin);
+            break;
+        }
+
+        // A bad split must not make apply write outside the arrays
+        bool inRange = split.halfEdge[0] < numHalfEdges && split.halfEdge[1] < numHalfEdges;
+        for (uint32_t v : {split.vert, split.kept, split.opposite[0], split.opposite[1]}) {
+            inRange = inRange && v < mHeader.numVerts;
+        }
+        for (size_t i = split.fanBegin; i < split.fanEnd; i++) {
+            inRange = inRange && mFans[i] < numHalfEdges;
+        }
+        if (!inRange) {
+            std::cerr << "Error: vertex split " << mSplits.size() << " is out of range"
+                      << std::endl;
+            mFans.resize(split.fanBegin);
+            break;
+        }
+
+        mSplits.push_back(split);
+        numRead++;
+    }
+    return numRead;
+}
+
+void ProgressiveMeshStream::SetNumSplits(size_t numSplits) {
+    if (numSplits > mSplits.size()) numSplits = mSplits.size();
+    while (mNumApplied < numSplits) apply(mSplits[mNumApplied++]);
+    while (mNumApplied > numSplits) undo(mSplits[--mNumApplied]);
+}
+
+void ProgressiveMeshStream::apply(VertexSplit& split) {
+    split.collapsedPosition = mPositions[split.kept];
+    mPositions[split.kept] = split.keptPosition;
+    mPositions[split.vert] = split.position;
+
+    for (size_t i = split.fanBegin; i < split.fanEnd; i++) mCorners[mFans[i]] = split.vert;
+
+    const uint32_t corners[2][3] = {{split.vert, split.kept, split.opposite[0]},
+                                    {split.kept, split.vert, split.opposite[1]}};
+    for (size_t i = 0; i < 2; i++) {
+        const size_t h = split.halfEdge[i];
+        mCorners[h] = corners[i][0];
+        mCorners[next(h)] = corners[i][1];
+        mCorners[prev(h)] = corners[i][2];
+        mActiveFaces[h / 3] = 1;
+    }
+    mNumActiveFaces += 2;
+}
+
+void ProgressiveMeshStream::undo(const VertexSplit& split) {
+    mPositions[split.kept] = split.collapsedPosition;
+    for (size_t i = split.fanBegin; i < split.fanEnd; i++) mCorners[mFans[i]] = split.kept;
+    mActiveFaces[split.halfEdge[0] / 3] = 0;
+    mActiveFaces[split.halfEdge[1] / 3] = 0;
+    mNumActiveFaces -= 2;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <glm.hpp>
+
+/*! \brief Header of a progressive mesh stream (.pm), written by
+ * DecimationMesh::SaveProgressive.
+ *
+ * After the header come, as little endian 32 bit values,
+ * - numBaseVerts vertices of the coarsest mesh: index, x, y, z
+ * - numBaseFaces faces of the coarsest mesh: index and the three corners
+ * - numSplits vertex splits, from the coarsest mesh to the finest: vert,
+ *   kept, halfEdge[2], opposite[2], position, keptPosition, numFan and
+ *   numFan half-edges.
+ *
+ * Vertices and faces keep their indices of the finest mesh, so a split
+ * only writes into arrays of the final size. Corner k of face f is
+ * half-edge 3f + k. A split of kept moves it to keptPosition and adds
+ * vert at position. The half-edges of the fan get vert as corner, and the
+ * two faces of halfEdge[0] and halfEdge[1] come back with the corners
+ * (vert, kept, opposite[0]) and (kept, vert, opposite[1]) starting at
+ * those half-edges.
+ */
+struct ProgressiveMeshHeader {
+    static constexpr uint32_t Version = 1;
+
+    char magic[8];  //!< "MOAPM" padded with zeros
+    uint32_t version;
+    //! Size of the finest mesh
+    uint32_t numVerts;
+    uint32_t numFaces;
+    //! Size of the coarsest mesh
+    uint32_t numBaseVerts;
+    uint32_t numBaseFaces;
+    uint32_t numSplits;
+
+    //! Header for the given sizes
+    static ProgressiveMeshHeader Make(size_t numVerts, size_t numFaces, size_t numBaseVerts,
+                                      size_t numBaseFaces, size_t numSplits);
+
+    //! True if magic and version are the ones this code writes
+    bool IsSupported() const;
+
+    //! Converts between file (little endian) and host byte order
+    void SwapToHost();
+};
+static_assert(sizeof(ProgressiveMeshHeader) == 32, "ProgressiveMeshHeader must stay 32 bytes");
+
+/*! \brief Reads a progressive mesh stream into an indexed triangle mesh
+ * that can be refined and coarsened by any number of the splits read.
+ *
+ * The base mesh is read first. The splits can then be read in pieces as
+ * the stream comes in and applied while more are still on their way.
+ *
+ * \code
+ * ProgressiveMeshStream pm;
+ * pm.ReadBase(is);
+ * while (pm.ReadSplits(is, 1000) > 0) {
+ *     pm.SetNumSplits(pm.GetNumSplitsRead());
+ *     // draw the faces for which IsFaceActive is true
+ * }
+ * \endcode
+ */
+class ProgressiveMeshStream {
+public:
+    ProgressiveMeshStream() : mNumApplied(0), mNumActiveFaces(0) {}
+
+    //! Reads the header and the base mesh, false if the stream is no progressive mesh
+    bool ReadBase(std::istream& is);
+
+    /*! Reads up to maxSplits more splits, they are not applied yet.
+     * \return the number of splits read, 0 at the end of the stream
+     */
+    size_t ReadSplits(std::istream& is, size_t maxSplits);
+
+    //! Applies or undoes splits until the first numSplits read are applied
+    void SetNumSplits(size_t numSplits);
+
+    size_t GetNumSplitsRead() const { return mSplits.size(); }
+    size_t GetNumSplitsApplied() const { return mNumApplied; }
+    //! Number of splits in the whole stream
+    size_t GetNumSplits() const { return mHeader.numSplits; }
+
+    size_t GetNumActiveFaces() const { return mNumActiveFaces; }
+    bool IsFaceActive(size_t face) const { return mActiveFaces[face] != 0; }
+
+    //! Positions by vertex index, only those of the current mesh are set
+    const std::vector<glm::vec3>& Positions() const { return mPositions; }
+    //! The corners of face f start at 3f, only those of active faces are set
+    const std::vector<uint32_t>& Corners() const { return mCorners; }
+
+protected:
+    struct VertexSplit {
+        uint32_t vert, kept;
+        uint32_t halfEdge[2], opposite[2];
+        glm::vec3 position, keptPosition;
+        //! Position of kept before the split, set while it is applied
+        glm::vec3 collapsedPosition;
+        //! The fan is [fanBegin, fanEnd) in mFans
+        size_t fanBegin, fanEnd;
+    };
+
+    void apply(VertexSplit& split);
+    void undo(const VertexSplit& split);
+
+    static size_t next(size_t h) { return h % 3 == 2 ? h - 2 : h + 1; }
+    static size_t prev(size_t h) { return h % 3 == 0 ? h + 2 : h - 1; }
+
+    ProgressiveMeshHeader mHeader;
+
+    std::vector<glm::vec3> mPositions;
+    std::vector<uint32_t> mCorners;
+    std::vector<uint8_t> mActiveFaces;
+
+    std::vector<VertexSplit> mSplits;
+    std::vector<uint32_t> mFans;
+    size_t mNumApplied;
+    size_t mNumActiveFaces;
+};
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "QuadricDecimationMesh.h"
 #include "gtc/type_ptr.hpp"
 
@@ -5,31 +6,34 @@ const QuadricDecimationMesh::VisualizationMode QuadricDecimationMesh::QuadricIso
     NewVisualizationMode("Quadric Iso Surfaces");
 
 void QuadricDecimationMesh::Initialize() {
-    // Allocate memory for the quadric array
-    size_t numVerts = mVerts.size();
-    mQuadrics.reserve(numVerts);
-    std::streamsize width = std::cerr.precision();  // store stream precision
-    for (size_t i = 0; i < numVerts; i++) {
-
-        // Compute quadric for vertex i here
-        mQuadrics.push_back(createQuadricForVert(i));
-
-        // Calculate initial error, should be numerically close to 0
-
-        glm::vec3 v0 = mVerts[i].pos;
-        glm::vec4 v(v0[0], v0[1], v0[2], 1);
-        glm::mat4 m = mQuadrics.back();
-
-        // TODO CHECK
-        float error = glm::dot(v, (m * v));
-        // std::cerr << std::scientific << std::setprecision(2) << error << " ";
-    }
-    std::cerr << std::setprecision(width) << std::fixed;  // reset stream precision
+    const size_t numVerts = GetNumVerts();
+    const size_t numFaces = GetNumFaces();
+
+    // Every face quadric is computed once instead of once per corner
+    std::vector<ErrorQuadric> faceQuadrics(numFaces);
+    ParallelFor(0, numFaces, [&](size_t i) { faceQuadrics[i] = createQuadricForFace(i); });
+
+    // The quadric for a vertex is the sum of the quadrics of its faces.
+    // Each vertex gathers its own sum, so no two threads write the same quadric.
+    // The sum is accumulated in double and only stored in float
+    mQuadrics.assign(numVerts, ErrorQuadric());
+    ParallelFor(0, numVerts, [&](size_t i) {
+        ErrorQuadricD Q;
+        for (size_t face : FacesAroundVertex(i)) {
+            if (face != EdgeState::Border) Q += faceQuadrics[face];
+        }
+        mQuadrics[i] = ErrorQuadric(Q);
+    });
 
     // Run the initialize for the parent class to initialize the edge collapses
     DecimationMesh::Initialize();
 }
 
+void QuadricDecimationMesh::Cleanup() {
+    DecimationMesh::Cleanup();
+    std::vector<ErrorQuadric>().swap(mQuadrics);
+}
+
 /*! \lab2 Implement the computeCollapse here */
 /*!
  * \param[in,out] collapse The edge collapse object to (re-)compute,
@@ -39,64 +43,40 @@ void QuadricDecimationMesh::computeCollapse(EdgeCollapse* collapse) {
     // Compute collapse->position and collapse->cost here
     // based on the quadrics at the edge endpoints
 
-    size_t v1point = e(collapse->halfEdge).vert;
-    glm::vec4 v1 = glm::vec4(v(v1point).pos, 1.0f);
-
-    size_t v2point = e(e(collapse->halfEdge).pair).vert; 
-    glm::vec4 v2 = glm::vec4(v(v2point).pos, 1.0f);
-
-    glm::vec4 v3((v(v1point).pos + v(v2point).pos) / 2.0f, 1.0f);
+    size_t v1point = EdgeVert(collapse->halfEdge);
+    size_t v2point = EdgeVert(EdgePair(collapse->halfEdge));
 
-    glm::mat4 q1 = mQuadrics.at(v1point);
-    glm::mat4 q2 = mQuadrics.at(v2point);
-
-    glm::mat4 qTot = q1 + q2;
-    glm::mat4 qTotOpti = q1 + q2;
-
-    qTotOpti[3][0] = 0;
-    qTotOpti[3][1] = 0;
-    qTotOpti[3][2] = 0;
-    qTotOpti[3][3] = 1;
+    const ErrorQuadricD qTot = ErrorQuadricD(mQuadrics[v1point]) + mQuadrics[v2point];
 
     //Task for a 4
-    HalfEdgeMesh::Face face = f(e(collapse->halfEdge).face);
+    const glm::vec3 faceNormal = mFaceAttribs.Normal(EdgeFace(collapse->halfEdge));
     float weight = 1.0f;
-    if (face.normal.y >= 0.3) {
-        weight = face.normal.y * 20;
+    if (faceNormal.y >= 0.3) {
+        weight = faceNormal.y * 20;
     }
-    
-    
-    if (glm::determinant(qTotOpti) != 0) {
-        glm::vec4 optimalPos = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) *
-                               glm::inverse(qTotOpti);  //why vector times mat and not vice versa?
 
-        float error = glm::dot((optimalPos * qTot), optimalPos);
-       
-        collapse->cost = error * weight;
-
-        collapse->position = glm::vec3{optimalPos[0], optimalPos[1], optimalPos[2]};
-    }
-    else { 
-
-        float error1 = glm::dot((v1 * qTot), v1);
-        float error2 = glm::dot((v2 * qTot), v2);
-        float error3 = glm::dot((v3 * qTot), v3);
-
-        float min_error = std::min({error1, error2, error3});
-
-        collapse->cost = min_error * weight;
-
-        if (min_error == error1) {
-            collapse->position = v(v1point).pos;
-        } else if (min_error == error2) {
-            collapse->position = v(v2point).pos;
-        } else {
-            collapse->position = (v(v1point).pos + v(v2point).pos) / 2.0f;
+    glm::dvec3 optimalPos;
+    if (!qTot.Minimize(optimalPos)) {
+        // No well defined minimum, take the best of the endpoints and the midpoint
+        const glm::dvec3 v1(Position(v1point));
+        const glm::dvec3 v2(Position(v2point));
+        const glm::dvec3 candidates[3] = {v1, v2, 0.5 * (v1 + v2)};
+
+        optimalPos = candidates[0];
+        double minError = qTot.Evaluate(optimalPos);
+        for (size_t i = 1; i < 3; i++) {
+            const double error = qTot.Evaluate(candidates[i]);
+            if (error < minError) {
+                minError = error;
+                optimalPos = candidates[i];
+            }
         }
     }
 
-    //std::cout << v(v1point).pos.y << std::endl;
-   // std::cerr << "computeCollapse in QuadricDecimationMesh not implemented.\n";
+    // The error can't be negative, except for rounding
+    const double error = std::max(qTot.Evaluate(optimalPos), 0.0);
+    collapse->cost = static_cast<float>(error) * weight;
+    collapse->position = glm::vec3(optimalPos);
 }
 
 /*! After each edge collapse the vertex properties need to be updated */
@@ -106,50 +86,29 @@ void QuadricDecimationMesh::updateVertexProperties(size_t ind) {
 }
 
 /*!
- * \param[in] indx vertex index, points into HalfEdgeMesh::mVerts
+ * \param[in] indx vertex index, points into HalfEdgeMesh::mPositions
  */
-glm::mat4 QuadricDecimationMesh::createQuadricForVert(size_t indx) const {
-    glm::mat4 Q({0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f},
-                {0.0f, 0.0f, 0.0f, 0.0f});
-
-    // The quadric for a vertex is the sum of all the quadrics for the adjacent
-    // faces Tip: Matrix4x4 has an operator +=
-    
-    std::vector<size_t> oneRing = HalfEdgeMesh::FindNeighborFaces(indx);
-    
-
-    for (auto face : oneRing) {
-        Q += createQuadricForFace(face);   
+ErrorQuadric QuadricDecimationMesh::createQuadricForVert(size_t indx) const {
+    // The quadric for a vertex is the sum of all the quadrics for the adjacent faces
+    ErrorQuadricD Q;
+    for (size_t face : FacesAroundVertex(indx)) {
+        if (face != EdgeState::Border) Q += createQuadricForFace(face);
     }
 
-    return Q;
+    return ErrorQuadric(Q);
 }
 
 /*!
- * \param[in] indx face index, points into HalfEdgeMesh::mFaces
+ * \param[in] indx face index, points into HalfEdgeMesh::mFaceAttribs
  */
-glm::mat4 QuadricDecimationMesh::createQuadricForFace(size_t indx) const {
+ErrorQuadric QuadricDecimationMesh::createQuadricForFace(size_t indx) const {
 
     // Calculate the quadric (outer product of plane parameters) for a face
     // here using the formula from Garland and Heckbert
-    
-    glm::vec3 faceNormal = f(indx).normal;
-    glm::vec3 vZero = v(e(f(indx).edge).vert).pos;
-
-    float d = -glm::dot(vZero, faceNormal); 
-    glm::vec4 p(faceNormal.x, faceNormal.y, faceNormal.z, d);
-
-    glm::mat4 quadric_matrix({0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f},
-                             {0.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 0.0f});
-
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            quadric_matrix[i][j] = p[i] * p[j];
-
-        }
-    }
+    const glm::dvec3 faceNormal(mFaceAttribs.Normal(indx));
+    const glm::dvec3 vZero(Position(EdgeVert(FaceEdge(indx))));
 
-    return quadric_matrix;
+    return ErrorQuadric(faceNormal, -glm::dot(vZero, faceNormal));
 }
 
 void QuadricDecimationMesh::Render() {
@@ -167,10 +126,10 @@ void QuadricDecimationMesh::Render() {
         GLUquadric* GLquad = gluNewQuadric();
         glColor3f(0, 1, 0);
 
-        for (auto quad : mQuadrics){
+        for (const ErrorQuadric& quad : mQuadrics){
 			glm::mat4 R({ 0.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 0.0f },
 				{ 0.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 0.0f });
-			bool isFactorized = CholeskyFactorization(quad, R);
+			bool isFactorized = CholeskyFactorization(quad.ToMat4(), R);
             
 			if (isFactorized && !isVertexCollapsed(i)){
                 glPushMatrix();
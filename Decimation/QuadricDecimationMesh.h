@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Decimation/DecimationMesh.h"
+#include "Decimation/ErrorQuadric.h"
 #include <iomanip>
 
 #ifdef __APPLE__
@@ -25,18 +26,21 @@ public:
     //! Initialize member data (error quadrics)
     virtual void Initialize();
 
+    //! Frees the quadrics along with the rest of the decimation state
+    virtual void Cleanup();
+
 protected:
     //! Compute the cost and new position for an edge collapse
     virtual void computeCollapse(EdgeCollapse* collapse);
     //! Update vertex properties. Used after an edge collapse
     virtual void updateVertexProperties(size_t ind);
     //! Compute the quadric for a vertex
-    glm::mat4 createQuadricForVert(size_t indx) const;
+    ErrorQuadric createQuadricForVert(size_t indx) const;
     //! Copmute the quadric for a face
-    glm::mat4 createQuadricForFace(size_t indx) const;
+    ErrorQuadric createQuadricForFace(size_t indx) const;
     //! Render (redefined)
     virtual void Render();
 
     //! The quadrics used in the decimation
-    std::vector<glm::mat4> mQuadrics;
+    std::vector<ErrorQuadric> mQuadrics;
 };
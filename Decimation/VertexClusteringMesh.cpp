@@ -0,0 +1,185 @@
+#include <Decimation/VertexClusteringMesh.h>
+#include <algorithm>
+#include <limits>
+
+void VertexClusteringMesh::BeginTriangles(const glm::vec3& min, const glm::vec3& max) {
+    mPositions.clear();
+    mFaces.clear();
+    mVertAttribs.clear();
+    mFaceAttribs.clear();
+    mAdjacencyValid = false;
+    ReleaseBuildIndex();
+
+    mCellKeys.clear();
+    mCells.clear();
+    mCellIndex.clear();
+    mFaceIndex.clear();
+
+    const glm::vec3 extent = max - min;
+    const float longest = std::max(extent[0], std::max(extent[1], extent[2]));
+    mOrigin = min;
+    // A flat or empty box still needs cells of some size
+    mCellSize = longest > 0 ? longest / mResolution : 1.f;
+}
+
+size_t VertexClusteringMesh::findCell(const VertexKey& key) {
+    const std::pair<size_t, bool> cell = mCellIndex.insert(key, mCells.size());
+    if (cell.second) {
+        mCellKeys.push_back(key);
+        mCells.push_back(Cell());
+    }
+    return cell.first;
+}
+
+void VertexClusteringMesh::addClusterFace(size_t c0, size_t c1, size_t c2) {
+    if (c0 == c1 || c1 == c2 || c2 == c0) return;
+
+    size_t sorted[3] = {c0, c1, c2};
+    std::sort(sorted, sorted + 3);
+    const VertexKey key = {static_cast<int32_t>(sorted[0]), static_cast<int32_t>(sorted[1]),
+                           static_cast<int32_t>(sorted[2])};
+    if (mFaceIndex.insert(key, mFaces.size()).second) mFaces.push_back(Face(c0, c1, c2));
+}
+
+void VertexClusteringMesh::AddTriangle(const glm::vec3& p0, const glm::vec3& p1,
+                                       const glm::vec3& p2) {
+    const glm::vec3 p[3] = {p0, p1, p2};
+    size_t cells[3];
+    for (size_t i = 0; i < 3; i++) {
+        // Corners outside the box are clamped into the border cells
+        const glm::vec3 g = glm::clamp((p[i] - mOrigin) / mCellSize, glm::vec3(0.f),
+                                       glm::vec3(static_cast<float>(mResolution) - 0.5f));
+        cells[i] = findCell(MakeVertexKey(g, 1.f));
+    }
+
+    // The plane quadric, weighted by the area of the triangle
+    const glm::dvec3 q0(p0), q1(p1), q2(p2);
+    const glm::dvec3 n = glm::cross(q1 - q0, q2 - q0);
+    const double length = glm::length(n);
+    ErrorQuadricD quadric;
+    if (length > 0) {
+        quadric = ErrorQuadricD(n / length, -glm::dot(n / length, q0));
+        quadric *= 0.5 * length;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        Cell& cell = mCells[cells[i]];
+        cell.quadric += quadric;
+        cell.sum += glm::dvec3(p[i]);
+        cell.count++;
+    }
+
+    addClusterFace(cells[0], cells[1], cells[2]);
+}
+
+void VertexClusteringMesh::EndTriangles() {
+    // The output triangles are known to be unique from now on
+    mFaceIndex.clear();
+    placeVertices();
+}
+
+void VertexClusteringMesh::placeVertices() {
+    mPositions.resize(mCells.size());
+    ParallelFor(0, mCells.size(), [&](size_t i) {
+        const Cell& cell = mCells[i];
+        const glm::dvec3 mean = cell.sum / static_cast<double>(cell.count);
+
+        // The minimum of the quadric is only used if it lies in the cell,
+        // otherwise a flat or badly shaped cell would throw it far away
+        glm::dvec3 v;
+        const glm::dvec3 cellMin = glm::dvec3(mOrigin) + glm::dvec3(mCellKeys[i].x, mCellKeys[i].y,
+                                                                    mCellKeys[i].z) *
+                                                             double(mCellSize);
+        const glm::dvec3 cellMax = cellMin + glm::dvec3(mCellSize);
+        if (!cell.quadric.Minimize(v) || glm::any(glm::lessThan(v, cellMin)) ||
+            glm::any(glm::greaterThan(v, cellMax))) {
+            v = mean;
+        }
+        mPositions[i] = glm::vec3(v);
+    });
+
+    mAdjacencyValid = false;
+    mVertAttribs.resize(mPositions.size());
+    mFaceAttribs.resize(mFaces.size());
+    std::vector<glm::vec3>& faceNormals = mFaceAttribs.Normals();
+    ParallelFor(0, mFaces.size(), [&](size_t t) { faceNormals[t] = FaceNormal(t); });
+}
+
+/*!
+ * The corners are looked up in the vertex array one triangle at a time,
+ * nothing of the size of the input is allocated.
+ */
+bool VertexClusteringMesh::Build(const glm::vec3* verts, size_t numVerts,
+                                 const glm::uvec3* tris, size_t numTris) {
+    glm::vec3 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < numVerts; i++) {
+        min = glm::min(min, verts[i]);
+        max = glm::max(max, verts[i]);
+    }
+    BeginTriangles(min, max);
+
+    for (size_t t = 0; t < numTris; t++) {
+        if (tris[t][0] >= numVerts || tris[t][1] >= numVerts || tris[t][2] >= numVerts) {
+            std::cerr << "Error: triangle " << t << " refers to a missing vertex" << std::endl;
+            BeginTriangles(min, max);
+            return false;
+        }
+        AddTriangle(verts[tris[t][0]], verts[tris[t][1]], verts[tris[t][2]]);
+    }
+    EndTriangles();
+
+    std::cout << "Clustered " << numTris << " triangles into " << mFaces.size() << " faces"
+              << std::endl;
+    return true;
+}
+
+/*!
+ * A cell of the coarser grid sums the quadrics and corners of the eight
+ * cells it covers, so the result is the same as clustering the input on
+ * the coarser grid, apart from the triangles dropped on the finer one.
+ */
+bool VertexClusteringMesh::decimate() {
+    if (mCells.size() < 2 || mResolution < 2) return false;
+
+    std::vector<VertexKey> keys;
+    std::vector<Cell> cells;
+    keys.swap(mCellKeys);
+    cells.swap(mCells);
+    mCellIndex.clear();
+
+    std::vector<size_t> parent(cells.size());
+    for (size_t i = 0; i < cells.size(); i++) {
+        const VertexKey key = {keys[i].x / 2, keys[i].y / 2, keys[i].z / 2};
+        parent[i] = findCell(key);
+        Cell& cell = mCells[parent[i]];
+        cell.quadric += cells[i].quadric;
+        cell.sum += cells[i].sum;
+        cell.count += cells[i].count;
+    }
+
+    std::vector<Face> faces;
+    faces.swap(mFaces);
+    for (const Face& face : faces) {
+        addClusterFace(parent[face.v1], parent[face.v2], parent[face.v3]);
+    }
+    mFaceIndex.clear();
+
+    mResolution = (mResolution + 1) / 2;
+    mCellSize *= 2;
+    placeVertices();
+    return true;
+}
+
+bool VertexClusteringMesh::decimate(size_t targetFaces) {
+    while (mFaces.size() > targetFaces && decimate()) {
+    }
+    std::cout << "Clustered mesh to " << mFaces.size() << " faces" << std::endl;
+    return mFaces.size() <= targetFaces;
+}
+
+bool VertexClusteringMesh::BuildInto(Mesh* mesh) const {
+    std::vector<glm::uvec3> tris(mFaces.size());
+    for (size_t i = 0; i < mFaces.size(); i++) {
+        tris[i] = glm::uvec3(mFaces[i].v1, mFaces[i].v2, mFaces[i].v3);
+    }
+    return mesh->Build(mPositions.data(), mPositions.size(), tris.data(), tris.size());
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Decimation/DecimationInterface.h>
+#include <Decimation/ErrorQuadric.h>
+#include <Geometry/SimpleMesh.h>
+#include <Util/HashIndex.h>
+#include <Util/TriangleSink.h>
+
+/*! \brief Decimation by vertex clustering on a uniform grid, for meshes
+ * too large for the half-edge structure and the collapse heap.
+ *
+ * The triangles are streamed through once. Every corner falls into a grid
+ * cell, and each cell sums the area weighted plane quadrics of the
+ * triangles touching it. A triangle with its corners in three different
+ * cells becomes a triangle between those cells, the others vanish. Only
+ * the cells and the output triangles are kept, so the memory follows the
+ * size of the result, not of the input. When all triangles are in, every
+ * cell gets one vertex where its quadric is least. If that point lies
+ * outside the cell, the vertex goes to the mean of the corners in the cell
+ * instead.
+ *
+ * As a TriangleSink the mesh takes the triangles straight from
+ * ObjIO::Stream and PlyIO::Stream, without the triangle list of the file
+ * ever being built. Build takes them from the ordinary loaders. The result
+ * may be non-manifold where a cell pinches the surface, it can be handed
+ * to BuildInto a QuadricDecimationMesh for a final refinement.
+ */
+class VertexClusteringMesh : public DecimationInterface, public SimpleMesh, public TriangleSink {
+public:
+    VertexClusteringMesh() : mResolution(256), mCellSize(0) {}
+    virtual ~VertexClusteringMesh() {}
+
+    //! Number of grid cells along the longest side of the bounding box
+    void SetGridResolution(size_t cells) { mResolution = cells > 0 ? cells : 1; }
+
+    /*! Starts clustering the triangles inside the box from min to max,
+     * dropping the current mesh
+     */
+    virtual void BeginTriangles(const glm::vec3& min, const glm::vec3& max) override;
+
+    //! Adds one triangle, with its corners counter clockwise
+    virtual void AddTriangle(const glm::vec3& p0, const glm::vec3& p1,
+                             const glm::vec3& p2) override;
+
+    //! Places the cell vertices once all triangles are added
+    virtual void EndTriangles() override;
+
+    //! Clusters the triangles in one pass instead of storing them
+    virtual bool Build(const glm::vec3* verts, size_t numVerts, const glm::uvec3* tris,
+                       size_t numTris) override;
+    using Mesh::Build;
+
+    //! Merges the cells two by two along each axis, halving the grid resolution
+    virtual bool decimate();
+
+    //! Halves the grid resolution until at most targetFaces are left
+    virtual bool decimate(size_t targetFaces);
+
+    //! Builds mesh from the clustered triangles, e.g. to refine them further
+    bool BuildInto(Mesh* mesh) const;
+
+    virtual const char* GetTypeName() { return typeid(VertexClusteringMesh).name(); }
+
+protected:
+    //! What a cell collects from the triangles touching it
+    struct Cell {
+        Cell() : sum(0, 0, 0), count(0) {}
+        ErrorQuadricD quadric;
+        //! Sum and number of the corners in the cell, the fallback vertex is their mean
+        glm::dvec3 sum;
+        size_t count;
+    };
+
+    //! Index of the cell at key, created if it is new
+    size_t findCell(const VertexKey& key);
+
+    //! Adds the triangle between cells c0, c1 and c2 unless it is degenerate or known
+    void addClusterFace(size_t c0, size_t c1, size_t c2);
+
+    //! Sets the vertex of every cell and sizes the attribute streams to the result
+    void placeVertices();
+
+    size_t mResolution;
+    glm::vec3 mOrigin;
+    float mCellSize;
+
+    //! Grid coordinates and data of the cells, the index of a cell is its vertex
+    std::vector<VertexKey> mCellKeys;
+    std::vector<Cell> mCells;
+    HashIndex<VertexKey, size_t, VertexKeyHash> mCellIndex;
+    //! The output triangles by their sorted cells, to add each only once
+    HashIndex<VertexKey, size_t, VertexKeyHash> mFaceIndex;
+};
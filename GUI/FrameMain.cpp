@@ -329,11 +329,16 @@ void FrameMain::SaveMesh(wxCommandEvent& event) {
                 this,
                 _T("Save mesh '") + wxString(mesh->GetName().c_str(), wxConvUTF8) + _T("' as"),
                 _T("."), wxString(mesh->GetName().c_str(), wxConvUTF8) + _T(".obj"),
-                _T("OBJ (*.obj)|*.obj"), wxFD_SAVE, wxDefaultPosition);
+                _T("OBJ (*.obj)|*.obj|Binary PLY (*.ply)|*.ply|Binary STL (*.stl)|*.stl|"
+                  "Half-edge mesh (*.hem)|*.hem"),
+                wxFD_SAVE, wxDefaultPosition);
             if (dialog->ShowModal() == wxID_OK) {
-                wxString filename = dialog->GetPath();
-                std::ofstream out(filename.mb_str());
-                mesh->save(out);
+                const std::string filename(dialog->GetPath().mb_str());
+                const MeshFormat format = MeshFormatFromFilename(filename);
+                std::ios::openmode mode = std::ios::out;
+                if (format != MeshFormat::Obj) mode |= std::ios::binary;
+                std::ofstream out(filename.c_str(), mode);
+                mesh->Save(out, format);
             }
         }
     }
@@ -491,7 +496,22 @@ void FrameMain::AddObjectHalfEdgeMesh(wxCommandEvent& event) {
     wxFileDialog* dialog = new wxFileDialog(this);
     if (dialog->ShowModal() == wxID_OK) {
         wxString path = dialog->GetPath();
-        AddMesh<HalfEdgeMesh>(path);
+        if (path.AfterLast('.') == _T("hem")) {
+            // Native files already hold the half-edges and attributes
+            HalfEdgeMesh* mesh = new HalfEdgeMesh();
+            wxString filename = path.AfterLast('/');
+            if (filename == path)  // If we're on Windows
+                filename = path.AfterLast('\\');
+            mesh->SetName(std::string(filename.mb_str()));
+            if (mesh->LoadBinary(std::string(path.mb_str()))) {
+                mesh->Update();
+                AddUniqueObject(mesh);
+            } else {
+                delete mesh;
+            }
+        } else {
+            AddMesh<HalfEdgeMesh>(path);
+        }
     }
     delete dialog;
     mGLViewer->Render();
@@ -521,6 +541,53 @@ void FrameMain::AddObjectQuadricDecimationMesh(wxCommandEvent& event) {
     mGLViewer->Render();
 }
 
+void FrameMain::AddObjectMemorylessDecimationMesh(wxCommandEvent& event) {
+    wxFileDialog* dialog = new wxFileDialog(this);
+    if (dialog->ShowModal() == wxID_OK) {
+        wxString path = dialog->GetPath();
+        AddMesh<MemorylessDecimationMesh>(path);
+    }
+    delete dialog;
+    mGLViewer->Render();
+}
+
+void FrameMain::AddObjectVertexClusteringMesh(wxCommandEvent& event) {
+    wxFileDialog* dialog = new wxFileDialog(this);
+    if (dialog->ShowModal() == wxID_OK) {
+        wxString path = dialog->GetPath();
+        wxString suffix = path.AfterLast('.');
+        suffix.MakeLower();
+        if (suffix == _T("obj") || suffix == _T("ply")) {
+            // Stream the triangles into the grid instead of loading the whole mesh first
+            VertexClusteringMesh* mesh = new VertexClusteringMesh();
+            wxString filename = path.AfterLast('/');
+            if (filename == path)  // If we're on Windows
+                filename = path.AfterLast('\\');
+            mesh->SetName(std::string(filename.mb_str()));
+
+            const std::string file(path.mb_str());
+            bool loaded;
+            if (suffix == _T("ply")) {
+                PlyIO plyIO;
+                loaded = plyIO.Stream(mesh, file);
+            } else {
+                ObjIO objIO;
+                loaded = objIO.Stream(mesh, file);
+            }
+            if (loaded) {
+                mesh->Initialize();
+                AddUniqueObject(mesh);
+            } else {
+                delete mesh;
+            }
+        } else {
+            AddMesh<VertexClusteringMesh>(path);
+        }
+    }
+    delete dialog;
+    mGLViewer->Render();
+}
+
 void FrameMain::DecimateObjects(wxCommandEvent& event) {
     std::list<GLObject*> objects = mGLViewer->GetSelectedObjects();
     for (GLObject* object : objects) {
@@ -653,10 +720,8 @@ void FrameMain::AddObjectImplicitMesh(wxCommandEvent& event) {
             SimpleMesh* mesh = new SimpleMesh();
 
             // Load mesh
-            std::ifstream infile;
             ObjIO objIO;
-            infile.open(path.mb_str());
-            objIO.Load(mesh, infile);
+            objIO.Load(mesh, std::string(path.mb_str()));
 
             // Create new implicit mesh with loaded mesh as argument
             ImplicitMesh* implicitMesh = new ImplicitMesh(mesh);
@@ -1462,7 +1527,6 @@ void FrameMain::SaveSimulationFrames(wxCommandEvent& event) {
             s.width(4);
             s.fill('0');
             s << i;
-            i++;
             auto pos = tmpfilename.rfind(".", tmpfilename.length());
             tmpfilename.insert(pos, s.str());
 
@@ -11,6 +11,8 @@
 #include "GUI.h"
 #include "Util/ColorMapFactory.h"
 #include "Util/ObjIO.h"
+#include "Util/PlyIO.h"
+#include "Util/StlIO.h"
 
 #include <fstream>
 #include <list>
@@ -24,8 +26,10 @@
 #endif  // Lab1
 
 #ifdef LAB2
+#include "Decimation/MemorylessDecimationMesh.h"
 #include "Decimation/QuadricDecimationMesh.h"
 #include "Decimation/SimpleDecimationMesh.h"
+#include "Decimation/VertexClusteringMesh.h"
 #endif  // Lab2
 
 #ifdef LAB3
@@ -132,6 +136,8 @@ protected:
 #ifdef LAB2
     void AddObjectSimpleDecimationMesh(wxCommandEvent& event);
     void AddObjectQuadricDecimationMesh(wxCommandEvent& event);
+    void AddObjectMemorylessDecimationMesh(wxCommandEvent& event);
+    void AddObjectVertexClusteringMesh(wxCommandEvent& event);
     void DecimateObjects(wxCommandEvent& event);
 #endif  // Lab2
 
@@ -209,16 +215,25 @@ MeshType* FrameMain::AddMesh(const wxString& path) {
         filename = path.AfterLast('\\');
     wxString suffix = path.AfterLast('.');
 
-    if (suffix == _T("obj")) {
+    suffix.MakeLower();
+
+    if (suffix == _T("obj") || suffix == _T("ply") || suffix == _T("stl")) {
         // Create new mesh
         MeshType* mesh = new MeshType();
         mesh->SetName(std::string(filename.mb_str()));
 
         // Load mesh and add to geometry list
-        std::ifstream infile;
-        ObjIO objIO;
-        infile.open(path.mb_str());
-        objIO.Load(mesh, infile);
+        const std::string file(path.mb_str());
+        if (suffix == _T("ply")) {
+            PlyIO plyIO;
+            plyIO.Load(mesh, file);
+        } else if (suffix == _T("stl")) {
+            StlIO stlIO;
+            stlIO.Load(mesh, file);
+        } else {
+            ObjIO objIO;
+            objIO.Load(mesh, file);
+        }
         mesh->Initialize();
 
         // Add mesh to scene
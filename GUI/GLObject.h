@@ -25,7 +25,7 @@ public:
         inline size_t GetID() const { return mID; }
         inline const std::string& GetName() const { return mName; }
 
-        bool operator==(const VisualizationMode& mode) { return mID == mode.mID; }
+        bool operator==(const VisualizationMode& mode) const { return mID == mode.mID; }
 
     protected:
         VisualizationMode(size_t ID = 0, const std::string& name = "<not set>")
@@ -41,6 +41,18 @@ BaseFrameMain::BaseFrameMain(wxWindow* parent, wxWindowID id, const wxString& ti
                        wxEmptyString, wxITEM_NORMAL);
     mMenuAddObject->Append(mAddObjectQuadricDecimationMesh);
 
+    wxMenuItem* mAddObjectMemorylessDecimationMesh;
+    mAddObjectMemorylessDecimationMesh =
+        new wxMenuItem(mMenuAddObject, wxID_ANY, wxString(wxT("Memoryless decimation mesh")),
+                       wxEmptyString, wxITEM_NORMAL);
+    mMenuAddObject->Append(mAddObjectMemorylessDecimationMesh);
+
+    wxMenuItem* mAddObjectVertexClusteringMesh;
+    mAddObjectVertexClusteringMesh =
+        new wxMenuItem(mMenuAddObject, wxID_ANY, wxString(wxT("Vertex clustering mesh")),
+                       wxEmptyString, wxITEM_NORMAL);
+    mMenuAddObject->Append(mAddObjectVertexClusteringMesh);
+
     wxMenuItem* m_separator1;
     m_separator1 = mMenuAddObject->AppendSeparator();
 
@@ -788,6 +800,10 @@ BaseFrameMain::BaseFrameMain(wxWindow* parent, wxWindowID id, const wxString& ti
                   wxCommandEventHandler(BaseFrameMain::AddObjectSimpleDecimationMesh));
     this->Connect(mAddObjectQuadricDecimationMesh->GetId(), wxEVT_COMMAND_MENU_SELECTED,
                   wxCommandEventHandler(BaseFrameMain::AddObjectQuadricDecimationMesh));
+    this->Connect(mAddObjectMemorylessDecimationMesh->GetId(), wxEVT_COMMAND_MENU_SELECTED,
+                  wxCommandEventHandler(BaseFrameMain::AddObjectMemorylessDecimationMesh));
+    this->Connect(mAddObjectVertexClusteringMesh->GetId(), wxEVT_COMMAND_MENU_SELECTED,
+                  wxCommandEventHandler(BaseFrameMain::AddObjectVertexClusteringMesh));
     this->Connect(mAddObjectCubicSpline->GetId(), wxEVT_COMMAND_MENU_SELECTED,
                   wxCommandEventHandler(BaseFrameMain::AddObjectCubicSpline));
     this->Connect(mAddObjectSubdivisionCurve->GetId(), wxEVT_COMMAND_MENU_SELECTED,
@@ -1021,6 +1037,10 @@ BaseFrameMain::~BaseFrameMain() {
                      wxCommandEventHandler(BaseFrameMain::AddObjectSimpleDecimationMesh));
     this->Disconnect(wxID_ANY, wxEVT_COMMAND_MENU_SELECTED,
                      wxCommandEventHandler(BaseFrameMain::AddObjectQuadricDecimationMesh));
+    this->Disconnect(wxID_ANY, wxEVT_COMMAND_MENU_SELECTED,
+                     wxCommandEventHandler(BaseFrameMain::AddObjectMemorylessDecimationMesh));
+    this->Disconnect(wxID_ANY, wxEVT_COMMAND_MENU_SELECTED,
+                     wxCommandEventHandler(BaseFrameMain::AddObjectVertexClusteringMesh));
     this->Disconnect(wxID_ANY, wxEVT_COMMAND_MENU_SELECTED,
                      wxCommandEventHandler(BaseFrameMain::AddObjectCubicSpline));
     this->Disconnect(wxID_ANY, wxEVT_COMMAND_MENU_SELECTED,
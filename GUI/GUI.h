@@ -144,6 +144,8 @@ protected:
     virtual void AddObjectHalfEdgeMesh(wxCommandEvent& event) { event.Skip(); }
     virtual void AddObjectSimpleDecimationMesh(wxCommandEvent& event) { event.Skip(); }
     virtual void AddObjectQuadricDecimationMesh(wxCommandEvent& event) { event.Skip(); }
+    virtual void AddObjectMemorylessDecimationMesh(wxCommandEvent& event) { event.Skip(); }
+    virtual void AddObjectVertexClusteringMesh(wxCommandEvent& event) { event.Skip(); }
     virtual void AddObjectCubicSpline(wxCommandEvent& event) { event.Skip(); }
     virtual void AddObjectSubdivisionCurve(wxCommandEvent& event) { event.Skip(); }
     virtual void AddObjectLoopSubdivisionMesh(wxCommandEvent& event) { event.Skip(); }
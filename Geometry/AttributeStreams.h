@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm.hpp>
+
+/*! \brief Normals, colors and curvature of the vertices or the faces of a
+ * mesh, each kept in its own array.
+ *
+ * A kernel that only needs one attribute streams through that array
+ * alone instead of pulling whole per element structs through the cache.
+ * Streams are allocated the first time they are requested through the
+ * non-const accessors and from then on follow every resize, so a mesh
+ * that is never colored holds no colors. The const accessors return a
+ * default for a stream that was never requested. Requesting allocates,
+ * so it must not be done from inside a parallel loop.
+ */
+class AttributeStreams {
+public:
+    //! Color of elements that have not been colored
+    static glm::vec3 DefaultColor() { return glm::vec3(0.5f, 0.1f, 0.7f); }
+
+    AttributeStreams()
+        : mSize(0), mHasNormals(false), mHasColors(false), mHasCurvature(false) {}
+
+    size_t size() const { return mSize; }
+
+    //! Sets the number of elements, only the allocated streams are resized
+    void resize(size_t n) {
+        mSize = n;
+        if (mHasNormals) mNormals.resize(n, glm::vec3(0.f));
+        if (mHasColors) mColors.resize(n, DefaultColor());
+        if (mHasCurvature) mCurvature.resize(n, 0.f);
+    }
+
+    //! Removes all elements and releases every stream
+    void clear() {
+        mSize = 0;
+        Release(mNormals, mHasNormals);
+        Release(mColors, mHasColors);
+        Release(mCurvature, mHasCurvature);
+    }
+
+    //! Keeps only the elements at indices, in that order, in every allocated stream
+    void Select(const std::vector<uint32_t>& indices) {
+        mSize = indices.size();
+        SelectStream(mNormals, mHasNormals, indices);
+        SelectStream(mColors, mHasColors, indices);
+        SelectStream(mCurvature, mHasCurvature, indices);
+    }
+
+    bool HasNormals() const { return mHasNormals; }
+    bool HasColors() const { return mHasColors; }
+    bool HasCurvature() const { return mHasCurvature; }
+
+    //! The normals, allocated as zero vectors on first request
+    std::vector<glm::vec3>& Normals() { return Request(mNormals, mHasNormals, glm::vec3(0.f)); }
+    //! The colors, allocated as DefaultColor on first request
+    std::vector<glm::vec3>& Colors() { return Request(mColors, mHasColors, DefaultColor()); }
+    //! The curvature, allocated as zero on first request
+    std::vector<float>& Curvature() { return Request(mCurvature, mHasCurvature, 0.f); }
+
+    glm::vec3 Normal(size_t i) const { return mHasNormals ? mNormals[i] : glm::vec3(0.f); }
+    glm::vec3 Color(size_t i) const { return mHasColors ? mColors[i] : DefaultColor(); }
+    float Curvature(size_t i) const { return mHasCurvature ? mCurvature[i] : 0.f; }
+
+    void ReleaseNormals() { Release(mNormals, mHasNormals); }
+    void ReleaseColors() { Release(mColors, mHasColors); }
+    void ReleaseCurvature() { Release(mCurvature, mHasCurvature); }
+
+    //! Number of bytes held by the streams
+    size_t MemoryUsage() const {
+        return sizeof(glm::vec3) * (mNormals.capacity() + mColors.capacity()) +
+               sizeof(float) * mCurvature.capacity();
+    }
+
+protected:
+    template <typename T>
+    std::vector<T>& Request(std::vector<T>& stream, bool& allocated, const T& init) {
+        if (!allocated) {
+            stream.assign(mSize, init);
+            allocated = true;
+        }
+        return stream;
+    }
+
+    template <typename T>
+    static void Release(std::vector<T>& stream, bool& allocated) {
+        std::vector<T>().swap(stream);
+        allocated = false;
+    }
+
+    template <typename T>
+    static void SelectStream(std::vector<T>& stream, bool allocated,
+                             const std::vector<uint32_t>& indices) {
+        if (!allocated) return;
+        std::vector<T> selected(indices.size());
+        for (size_t i = 0; i < indices.size(); i++) selected[i] = stream[indices[i]];
+        stream.swap(selected);
+    }
+
+    size_t mSize;
+    std::vector<glm::vec3> mNormals;
+    std::vector<glm::vec3> mColors;
+    std::vector<float> mCurvature;
+    bool mHasNormals, mHasColors, mHasCurvature;
+};
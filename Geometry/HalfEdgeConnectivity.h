@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+/*! \brief Compact connectivity of a half-edge triangle mesh.
+ *
+ * The links are kept in separate arrays (structure of arrays) of IndexT,
+ * 32 bit by default, instead of one struct of size_t per half-edge. The
+ * inner half-edges of face f are stored at 3f, 3f+1 and 3f+2, so their
+ * face, next and prev are implicit and only the origin vertex and pair
+ * are stored. Boundary half-edges (face Border) follow after the inner
+ * ones and keep their next/prev in two small side arrays. The boundary is
+ * derived data: it is dropped when a face is added and rebuilt by
+ * BuildBoundary().
+ */
+template <typename IndexT = uint32_t>
+class HalfEdgeConnectivity {
+public:
+    typedef IndexT Index;
+
+    //! Marks a link that has not been set yet
+    static constexpr size_t Uninitialized = (std::numeric_limits<IndexT>::max)() - 1;
+    //! The face of a boundary half-edge
+    static constexpr size_t Border = (std::numeric_limits<IndexT>::max)();
+    //! Largest number of half-edges that can be addressed
+    static constexpr size_t MaxHalfEdges = Uninitialized;
+
+    HalfEdgeConnectivity() : mNumInner(0), mBoundaryBuilt(true) {}
+
+    size_t NumVerts() const { return mVertEdge.size(); }
+    size_t NumFaces() const { return mNumInner / 3; }
+    size_t NumHalfEdges() const { return mVert.size(); }
+    //! Number of half-edges belonging to a face
+    size_t NumInner() const { return mNumInner; }
+
+    bool IsBoundary(size_t h) const { return h >= mNumInner; }
+
+    size_t Vert(size_t h) const {
+        assert(h < mVert.size());
+        return mVert[h];
+    }
+    size_t Pair(size_t h) const {
+        assert(h < mPair.size());
+        return mPair[h];
+    }
+    size_t Face(size_t h) const {
+        assert(h < mVert.size());
+        return h < mNumInner ? h / 3 : Border;
+    }
+    size_t Next(size_t h) const {
+        if (h < mNumInner) return h % 3 == 2 ? h - 2 : h + 1;
+        return mBoundaryNext[h - mNumInner];
+    }
+    size_t Prev(size_t h) const {
+        if (h < mNumInner) return h % 3 == 0 ? h + 2 : h - 1;
+        return mBoundaryPrev[h - mNumInner];
+    }
+    //! One outgoing half-edge of vertex v
+    size_t VertEdge(size_t v) const {
+        assert(v < mVertEdge.size());
+        return mVertEdge[v];
+    }
+    //! The first inner half-edge of face f
+    static size_t FaceEdge(size_t f) { return 3 * f; }
+
+    void SetVert(size_t h, size_t v) { mVert[h] = static_cast<IndexT>(v); }
+    void SetPair(size_t h, size_t p) { mPair[h] = static_cast<IndexT>(p); }
+    void SetVertEdge(size_t v, size_t h) { mVertEdge[v] = static_cast<IndexT>(h); }
+
+    void Clear() {
+        mVert.clear();
+        mPair.clear();
+        mVertEdge.clear();
+        mBoundaryNext.clear();
+        mBoundaryPrev.clear();
+        mNumInner = 0;
+        mBoundaryBuilt = true;
+    }
+
+    void Reserve(size_t numVerts, size_t numFaces) {
+        mVertEdge.reserve(numVerts);
+        mVert.reserve(3 * numFaces);
+        mPair.reserve(3 * numFaces);
+    }
+
+    //! Resize to numVerts vertices and numFaces faces with unset links
+    void Resize(size_t numVerts, size_t numFaces) {
+        DropBoundary();
+        mVertEdge.assign(numVerts, static_cast<IndexT>(Uninitialized));
+        mVert.assign(3 * numFaces, static_cast<IndexT>(Uninitialized));
+        mPair.assign(3 * numFaces, static_cast<IndexT>(Uninitialized));
+        mNumInner = 3 * numFaces;
+        mBoundaryBuilt = false;
+    }
+
+    size_t AddVertex() {
+        mVertEdge.push_back(static_cast<IndexT>(Uninitialized));
+        return mVertEdge.size() - 1;
+    }
+
+    /*! Appends a face with corners v1, v2, v3. The new half-edges are left
+     * unpaired and become the outgoing edge of their origin vertex.
+     * \return the index of the face
+     */
+    size_t AddFace(size_t v1, size_t v2, size_t v3) {
+        DropBoundary();
+        const size_t corners[3] = {v1, v2, v3};
+        for (size_t i = 0; i < 3; i++) {
+            mVert.push_back(static_cast<IndexT>(corners[i]));
+            mPair.push_back(static_cast<IndexT>(Uninitialized));
+            mVertEdge[corners[i]] = static_cast<IndexT>(mNumInner + i);
+        }
+        mNumInner += 3;
+        mBoundaryBuilt = false;
+        return mNumInner / 3 - 1;
+    }
+
+    /*! Creates a boundary half-edge for every inner half-edge without a
+     * pair and links them into loops. Does nothing if the boundary is
+     * already up to date.
+     */
+    void BuildBoundary() {
+        if (mBoundaryBuilt) return;
+        mBoundaryBuilt = true;
+
+        for (size_t h = 0; h < mNumInner; h++) {
+            if (mPair[h] != static_cast<IndexT>(Uninitialized)) continue;
+            const size_t b = mVert.size();
+            mVert.push_back(mVert[Next(h)]);
+            mPair.push_back(static_cast<IndexT>(h));
+            mPair[h] = static_cast<IndexT>(b);
+        }
+        const size_t numBoundary = mVert.size() - mNumInner;
+        if (numBoundary == 0) return;
+
+        /* A boundary half-edge continues with the boundary half-edge leaving
+         * the vertex it points to. That one is found by turning around the
+         * vertex from the inner pair, through the fan of faces the pair
+         * belongs to. A vertex shared by several fans, e.g. a bowtie, has
+         * one outgoing boundary half-edge per fan, and the walk picks the
+         * one of the right loop.
+         */
+        mBoundaryNext.assign(numBoundary, static_cast<IndexT>(Uninitialized));
+        mBoundaryPrev.assign(numBoundary, static_cast<IndexT>(Uninitialized));
+        for (size_t b = mNumInner; b < mVert.size(); b++) {
+            size_t next = mPair[b];
+            do {
+                next = mPair[Prev(next)];
+            } while (next < mNumInner);
+            mBoundaryNext[b - mNumInner] = static_cast<IndexT>(next);
+            mBoundaryPrev[next - mNumInner] = static_cast<IndexT>(b);
+        }
+    }
+
+    //! Removes all boundary half-edges, the inner ones become unpaired again
+    void DropBoundary() {
+        if (mVert.size() == mNumInner) return;
+        for (size_t h = 0; h < mNumInner; h++) {
+            if (mPair[h] >= mNumInner) mPair[h] = static_cast<IndexT>(Uninitialized);
+        }
+        mVert.resize(mNumInner);
+        mPair.resize(mNumInner);
+        mBoundaryNext.clear();
+        mBoundaryPrev.clear();
+    }
+
+    //! The link arrays, e.g. for writing them to a file
+    const std::vector<IndexT>& VertArray() const { return mVert; }
+    const std::vector<IndexT>& PairArray() const { return mPair; }
+    const std::vector<IndexT>& VertEdgeArray() const { return mVertEdge; }
+    const std::vector<IndexT>& BoundaryNextArray() const { return mBoundaryNext; }
+    const std::vector<IndexT>& BoundaryPrevArray() const { return mBoundaryPrev; }
+
+    /*! Replaces the connectivity with numVerts vertices, numFaces faces and
+     * numHalfEdges half-edges, the ones after the inner 3 * numFaces being
+     * the boundary. The links are left for the caller to fill in through
+     * the mutable arrays passed to fill(vert, pair, vertEdge, boundaryNext,
+     * boundaryPrev), which lets a loader copy them in one go.
+     */
+    template <typename Fill>
+    void Assign(size_t numVerts, size_t numFaces, size_t numHalfEdges, Fill fill) {
+        mNumInner = 3 * numFaces;
+        mVert.resize(numHalfEdges);
+        mPair.resize(numHalfEdges);
+        mVertEdge.resize(numVerts);
+        mBoundaryNext.resize(numHalfEdges - mNumInner);
+        mBoundaryPrev.resize(numHalfEdges - mNumInner);
+        fill(mVert.data(), mPair.data(), mVertEdge.data(), mBoundaryNext.data(),
+             mBoundaryPrev.data());
+        mBoundaryBuilt = true;
+    }
+
+    //! Number of bytes used by the connectivity arrays
+    size_t MemoryUsage() const {
+        return sizeof(IndexT) * (mVert.capacity() + mPair.capacity() + mVertEdge.capacity() +
+                                 mBoundaryNext.capacity() + mBoundaryPrev.capacity());
+    }
+
+protected:
+    //! Origin vertex of each half-edge
+    std::vector<IndexT> mVert;
+    //! Opposite half-edge of each half-edge
+    std::vector<IndexT> mPair;
+    //! One outgoing half-edge of each vertex
+    std::vector<IndexT> mVertEdge;
+    //! next/prev of the boundary half-edges, indexed from mNumInner
+    std::vector<IndexT> mBoundaryNext;
+    std::vector<IndexT> mBoundaryPrev;
+    //! Number of inner half-edges, three per face
+    size_t mNumInner;
+    //! False while inner half-edges may lack a boundary pair
+    bool mBoundaryBuilt;
+};
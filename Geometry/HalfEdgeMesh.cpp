@@ -1,9 +1,12 @@
 #include <Geometry/HalfEdgeMesh.h>
+#include <Util/MappedFile.h>
+#include <Util/ThreadPool.h>
 #include <gtc/type_ptr.hpp>
-#include <iterator>
-#include <queue>
+#include <atomic>
+#include <cstring>
+#include <memory>
 
-HalfEdgeMesh::HalfEdgeMesh() {}
+HalfEdgeMesh::HalfEdgeMesh() : mWeldTolerance(0.f), mAllDirty(true) {}
 
 HalfEdgeMesh::~HalfEdgeMesh() {}
 
@@ -16,200 +19,554 @@ HalfEdgeMesh::~HalfEdgeMesh() {}
 bool HalfEdgeMesh::AddFace(const std::vector<glm::vec3>& verts) {
     // Add your code here std::cerr << "ADD TRIANGLE NOT IMPLEMENTED. ";
 
+    // Fill the lookup tables if they were released after the last build
+    if (mUniqueEdgePairs.empty() && GetNumFaces() > 0) {
+        RebuildBuildIndex();
+    }
+
     const size_t ind1 = AddVertex(verts.at(0));
     const size_t ind2 = AddVertex(verts.at(1));
     const size_t ind3 = AddVertex(verts.at(2));
 
-    std::pair<size_t, size_t> pair1 = AddHalfEdgePair(ind1, ind2);
-    std::pair<size_t, size_t> pair2 = AddHalfEdgePair(ind2, ind3);
-    std::pair<size_t, size_t> pair3 = AddHalfEdgePair(ind3, ind1);
+    if (mConn.NumInner() + 3 > Connectivity::MaxHalfEdges) {
+        std::cerr << "Error: too many faces for the half-edge index type" << std::endl;
+        return false;
+    }
 
-    HalfEdge& halfEdge1 = e(pair1.first);
-    HalfEdge& halfEdge2 = e(pair2.first);
-    HalfEdge& halfEdge3 = e(pair3.first);
+    // The three inner half-edges are implicitly linked to the face and each other
+    const size_t face = mConn.AddFace(ind1, ind2, ind3);
+    for (size_t i = 0; i < 3; i++) {
+        PairHalfEdge(FaceEdge(face) + i);
+    }
 
-    halfEdge1.next = pair2.first;
-    halfEdge1.prev = pair3.first;
+    mFaceAttribs.resize(face + 1);
+    mFaceAttribs.Normals()[face] = FaceNormal(face);
+    MarkAllDirty();
 
-    halfEdge2.next = pair3.first;
-    halfEdge2.prev = pair1.first;
+    // The outer boundary half-edges are created by Initialize/Update
+    return true;
+}
 
-    halfEdge3.next = pair1.first;
-    halfEdge3.prev = pair2.first;
+/*!
+ * Builds all half-edges at once instead of going through AddFace. Corner i
+ * of face f is inner half-edge 3f+i, so only the pairs have to be found.
+ * The directed edges of all triangles are sorted on their (unordered)
+ * vertex pair, which puts the two halves of every edge next to each other.
+ * Edges used by one triangle only get an outer half-edge that is linked
+ * into its boundary loop.
+ * Fails, leaving the mesh empty, on invalid indices, degenerate triangles,
+ * edges shared by more than two triangles or inconsistent orientation.
+ * Vertices where several fans of triangles meet, e.g. the tip of a bowtie,
+ * are kept: every fan gets its own boundary loop through the vertex, but
+ * the circulators around the vertex only visit the fan of its VertEdge.
+ * \param[in] verts vertex positions, assumed to be unique
+ * \param[in] numVerts number of vertices
+ * \param[in] tris triangles as three indices into verts
+ * \param[in] numTris number of triangles
+ * \return true if the mesh was built
+ */
+bool HalfEdgeMesh::Build(const glm::vec3* verts, size_t numVerts, const glm::uvec3* tris,
+                         size_t numTris) {
+    mConn.Clear();
+    mPositions.clear();
+    mVertAttribs.clear();
+    mFaceAttribs.clear();
+    ReleaseBuildIndex();
+    MarkAllDirty();
+
+    // Every corner can at most add one boundary half-edge
+    if (6 * numTris > Connectivity::MaxHalfEdges || numVerts > Connectivity::MaxHalfEdges) {
+        std::cerr << "Error: mesh too large for the half-edge index type" << std::endl;
+        return false;
+    }
 
-    Face halfEdgeFace{};
-    halfEdgeFace.edge = pair1.first;
+    std::atomic<bool> badIndex(false);
+    ParallelFor(0, numTris, [&](size_t f) {
+        const glm::uvec3& t = tris[f];
+        if (t[0] >= numVerts || t[1] >= numVerts || t[2] >= numVerts || t[0] == t[1] ||
+            t[1] == t[2] || t[2] == t[0]) {
+            badIndex = true;
+        }
+    });
+    if (badIndex) {
+        std::cerr << "Error: invalid or degenerate triangle, can't build half-edge mesh"
+                  << std::endl;
+        return false;
+    }
 
-    mFaces.push_back(halfEdgeFace);
-    mFaces.back().normal = FaceNormal(mFaces.size() - 1);
-    halfEdge1.face = mFaces.size() - 1;
-    halfEdge2.face = mFaces.size() - 1;
-    halfEdge3.face = mFaces.size() - 1;
+    // Collect and sort the directed edges, entry c is half-edge c
+    struct DirectedEdge {
+        uint64_t key;
+        size_t corner;
+    };
+    const size_t numCorners = 3 * numTris;
+    std::vector<DirectedEdge> directed(numCorners);
+    ParallelFor(0, numTris, [&](size_t f) {
+        for (size_t i = 0; i < 3; i++) {
+            directed[3 * f + i] = {MakeEdgeKey(tris[f][i], tris[f][(i + 1) % 3]), 3 * f + i};
+        }
+    });
+    ParallelSort(directed.begin(), directed.end(),
+                 [](const DirectedEdge& a, const DirectedEdge& b) {
+                     return a.key < b.key || (a.key == b.key && a.corner < b.corner);
+                 });
+
+    mConn.Resize(numVerts, numTris);
+
+    // Every run of equal keys is one edge
+    for (size_t j = 0; j < numCorners;) {
+        size_t run = 1;
+        while (j + run < numCorners && directed[j + run].key == directed[j].key) run++;
+        if (run > 2) {
+            std::cerr << "Error: non-manifold edge, can't build half-edge mesh" << std::endl;
+            mConn.Clear();
+            return false;
+        }
+        if (run == 2) {
+            const size_t c1 = directed[j].corner, c2 = directed[j + 1].corner;
+            if (tris[c1 / 3][c1 % 3] == tris[c2 / 3][c2 % 3]) {
+                std::cerr << "Error: inconsistent face orientation, can't build half-edge mesh"
+                          << std::endl;
+                mConn.Clear();
+                return false;
+            }
+            mConn.SetPair(c1, c2);
+            mConn.SetPair(c2, c1);
+        }
+        j += run;
+    }
+    std::vector<DirectedEdge>().swap(directed);
+
+    mPositions.assign(verts, verts + numVerts);
+    mVertAttribs.resize(numVerts);
+    mFaceAttribs.resize(numTris);
+    ParallelFor(0, numCorners, [&](size_t c) { mConn.SetVert(c, tris[c / 3][c % 3]); });
+
+    // Vertices point to one of their outgoing half-edges
+    for (size_t c = 0; c < numCorners; c++) {
+        mConn.SetVertEdge(tris[c / 3][c % 3], c);
+    }
+
+    mConn.BuildBoundary();
+
+    std::vector<glm::vec3>& faceNormals = mFaceAttribs.Normals();
+    ParallelFor(0, numTris, [&](size_t f) { faceNormals[f] = FaceNormal(f); });
 
-    // Optionally, track the (outer) boundary half-edges
-    // to represent non-closed surfaces
     return true;
 }
 
 /*!
- * \param [in] v the vertex to add, glm::vec3
- * \return the index to the vertex
+ * The whole file is assembled in memory first, since the checksum in the
+ * header covers the sections after it. Sections are filled in host byte
+ * order and swapped to little endian on big endian machines.
+ * \param[out] os binary stream to write to
+ * \param[in] attributes also store the vertex and face normals and curvature
+ * \return false if the stream failed
  */
-size_t HalfEdgeMesh::AddVertex(const glm::vec3& v) {
-    std::map<glm::vec3, size_t>::iterator it = mUniqueVerts.find(v);
-    if (it != mUniqueVerts.end()) {
-        return (*it).second;  // get the index of the already existing vertex
+bool HalfEdgeMesh::SaveBinary(std::ostream& os, bool attributes) {
+    mConn.BuildBoundary();
+    // Stored attributes have to be up to date, the curvature is computed even if unused
+    if (attributes && (mAllDirty || !mDirtyVerts.empty() || !mDirtyFaces.empty() ||
+                       !mVertAttribs.HasCurvature())) {
+        mVertAttribs.Curvature();
+        Update();
     }
 
-    const auto indx = GetNumVerts();
-    mUniqueVerts[v] = indx;  // op. [ ] constructs a new entry in map
-    Vertex vert;
-    vert.pos = v;
-    mVerts.push_back(vert);  // add it to the vertex list
+    typedef MeshFileLayout Layout;
+    MeshFileHeader header = MeshFileHeader::Make(GetNumVerts(), GetNumFaces(), GetNumEdges(),
+                                                 attributes ? MeshFileHeader::HasAttributes : 0);
+    const Layout layout(header);
+    std::vector<char> file(layout.FileSize(), 0);
+    char* data = file.data();
+
+    const auto copyArray = [&](Layout::Section s, const std::vector<Connectivity::Index>& a) {
+        if (!a.empty()) std::memcpy(data + layout.Offset(s), a.data(), 4 * a.size());
+    };
+    copyArray(Layout::EdgeVerts, mConn.VertArray());
+    copyArray(Layout::EdgePairs, mConn.PairArray());
+    copyArray(Layout::VertEdges, mConn.VertEdgeArray());
+    copyArray(Layout::BoundaryNext, mConn.BoundaryNextArray());
+    copyArray(Layout::BoundaryPrev, mConn.BoundaryPrevArray());
+
+    // The attribute streams have the layout of the sections already
+    const auto copyStream = [&](Layout::Section s, const void* src) {
+        const size_t count = layout.Count(s);
+        if (count != 0) std::memcpy(data + layout.Offset(s), src, 4 * count);
+    };
+    copyStream(Layout::Positions, mPositions.data());
+    if (attributes) {
+        copyStream(Layout::VertNormals, mVertAttribs.Normals().data());
+        copyStream(Layout::VertCurvature, mVertAttribs.Curvature().data());
+        copyStream(Layout::FaceNormals, mFaceAttribs.Normals().data());
+        copyStream(Layout::FaceCurvature, mFaceAttribs.Curvature().data());
+    }
 
-    return indx;
+    // Every section holds 32 bit values
+    const size_t size = file.size() - sizeof(MeshFileHeader);
+    if (IsBigEndian()) EndianSwap(reinterpret_cast<uint32_t*>(data + sizeof(header)), size / 4);
+    header.SetChecksum(MeshFileChecksum(data + sizeof(header), size));
+    header.SwapToHost();
+    std::memcpy(data, &header, sizeof(header));
+
+    os.write(data, file.size());
+    return os.good();
 }
 
 /*!
- * Inserts a half edge pair between HalfEdgeMesh::Vertex pointed to by v1 and
- * v2. The first HalfEdgeMesh::HalfEdge (v1->v2) is the inner one, and the
- * second (v2->v1) is the outer.
- * \param [in] v1 size_t index of vertex 1
- * \param [in] v2 size_t index of vertex 2
- * \return a pair the indices to the half-edges
+ * The file is mapped and, after the header, size and checksum are checked,
+ * every section is copied in one go into the mesh. Nothing is parsed or
+ * rebuilt, the links are only checked to be in range so that a bad file
+ * can't make the mesh read outside its arrays. Every link has to be set,
+ * except the outgoing half-edge of an isolated vertex. If the file has no
+ * attributes the next Update computes them.
+ * \param[in] filename .hem file written by SaveBinary
+ * \return false, leaving the mesh empty, if the file could not be read
  */
-std::pair<size_t, size_t> HalfEdgeMesh::AddHalfEdgePair(size_t v1, size_t v2) {
-    std::map<OrderedPair, size_t>::iterator it = mUniqueEdgePairs.find(OrderedPair(v1, v2));
-    if (it != mUniqueEdgePairs.end()) {
-        auto indx1 = it->second;
-        auto indx2 = e(it->second).pair;
-        if (v1 != e(indx1).vert) {
-            std::swap(indx1, indx2);  // sort correctly
-        }
-        return {indx1, indx2};
+bool HalfEdgeMesh::LoadBinary(const std::string& filename) {
+    typedef MeshFileLayout Layout;
+    mConn.Clear();
+    mPositions.clear();
+    mVertAttribs.clear();
+    mFaceAttribs.clear();
+    ReleaseBuildIndex();
+    MarkAllDirty();
+
+    MappedFile file;
+    if (!file.Open(filename)) return false;
+
+    MeshFileHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << "Error: " << filename << " is not a half-edge mesh file" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    header.SwapToHost();
+    if (!header.IsSupported()) {
+        std::cerr << "Error: " << filename << " is not a half-edge mesh file of version "
+                  << MeshFileHeader::Version << std::endl;
+        return false;
+    }
+    const size_t numVerts = header.numVerts, numFaces = header.numFaces;
+    const size_t numEdges = header.numHalfEdges, numInner = 3 * numFaces;
+    const Layout layout(header);
+    if (numEdges < numInner || numEdges > Connectivity::MaxHalfEdges ||
+        file.size() != layout.FileSize()) {
+        std::cerr << "Error: " << filename << " is truncated or has a bad header" << std::endl;
+        return false;
+    }
+    const char* data = file.data();
+    if (MeshFileChecksum(data + sizeof(header), file.size() - sizeof(header)) !=
+        header.Checksum()) {
+        std::cerr << "Error: checksum mismatch, " << filename << " is corrupted" << std::endl;
+        return false;
     }
 
-    // If not found, calculate both half-edges indices
-    const auto indx1 = mEdges.size();
-    const auto indx2 = indx1 + 1;
+    const auto copySection = [&](Layout::Section s, void* dst) {
+        const size_t count = layout.Count(s);
+        if (count == 0) return;
+        std::memcpy(dst, data + layout.Offset(s), 4 * count);
+        if (IsBigEndian()) EndianSwap(static_cast<uint32_t*>(dst), count);
+    };
+    mConn.Assign(numVerts, numFaces, numEdges,
+                 [&](Connectivity::Index* vert, Connectivity::Index* pair,
+                     Connectivity::Index* vertEdge, Connectivity::Index* boundaryNext,
+                     Connectivity::Index* boundaryPrev) {
+                     copySection(Layout::EdgeVerts, vert);
+                     copySection(Layout::EdgePairs, pair);
+                     copySection(Layout::VertEdges, vertEdge);
+                     copySection(Layout::BoundaryNext, boundaryNext);
+                     copySection(Layout::BoundaryPrev, boundaryPrev);
+                 });
+
+    // A saved mesh has its boundary built, so every half-edge link is set.
+    // Only isolated vertices may lack an outgoing half-edge
+    std::atomic<bool> badLink(false);
+    ParallelFor(0, numEdges, [&](size_t i) {
+        if (EdgeVert(i) >= numVerts || EdgePair(i) >= numEdges) {
+            badLink = true;
+        } else if (i >= numInner &&
+                   (EdgePair(i) >= numInner || EdgeNext(i) < numInner ||
+                    EdgeNext(i) >= numEdges || EdgePrev(i) < numInner ||
+                    EdgePrev(i) >= numEdges)) {
+            badLink = true;
+        }
+    });
+    std::vector<uint8_t> isolated(numVerts, 1);
+    if (!badLink) {
+        for (size_t i = 0; i < numInner; i++) isolated[EdgeVert(i)] = 0;
+    }
+    ParallelFor(0, numVerts, [&](size_t i) {
+        if (VertEdge(i) == EdgeState::Uninitialized) {
+            if (!isolated[i]) badLink = true;
+        } else if (VertEdge(i) >= numEdges || EdgeVert(VertEdge(i)) != i) {
+            badLink = true;
+        }
+    });
+    if (badLink) {
+        std::cerr << "Error: " << filename << " has links out of range" << std::endl;
+        mConn.Clear();
+        return false;
+    }
 
-    // Create edges and set pair index
-    HalfEdge edge1, edge2;
-    edge1.pair = indx2;
-    edge2.pair = indx1;
+    const bool attributes = (header.flags & MeshFileHeader::HasAttributes) != 0;
+    mPositions.resize(numVerts);
+    mVertAttribs.resize(numVerts);
+    mFaceAttribs.resize(numFaces);
+    copySection(Layout::Positions, mPositions.data());
+    if (attributes) {
+        copySection(Layout::VertNormals, mVertAttribs.Normals().data());
+        copySection(Layout::FaceNormals, mFaceAttribs.Normals().data());
+        // The curvature is only kept if something is going to use it
+        if (NeedsCurvature()) {
+            copySection(Layout::VertCurvature, mVertAttribs.Curvature().data());
+            copySection(Layout::FaceCurvature, mFaceAttribs.Curvature().data());
+        }
+    } else {
+        std::vector<glm::vec3>& faceNormals = mFaceAttribs.Normals();
+        ParallelFor(0, numFaces, [&](size_t i) { faceNormals[i] = FaceNormal(i); });
+    }
 
-    // Connect the edges to the verts
-    edge1.vert = v1;
-    edge2.vert = v2;
+    // With the attributes loaded only the colors are left for Update
+    if (attributes) ClearDirty();
+    mColorsDirty = true;
+    return true;
+}
 
-    // Connect the verts to the edges
-    v(v1).edge = indx1;
-    v(v2).edge = indx2;
+/*!
+ * \param [in] v the vertex to add, glm::vec3
+ * \return the index to the vertex
+ */
+size_t HalfEdgeMesh::AddVertex(const glm::vec3& v) {
+    if (mUniqueVerts.empty() && !mPositions.empty()) {
+        RebuildBuildIndex();
+    }
 
-    // Store the edges in mEdges
-    mEdges.push_back(edge1);
-    mEdges.push_back(edge2);
+    const auto indx = GetNumVerts();
+    std::pair<size_t, bool> found = mUniqueVerts.insert(MakeVertexKey(v, mWeldTolerance), indx);
+    if (!found.second) {
+        return found.first;  // get the index of the already existing vertex
+    }
 
-    // Store the first edge in the map as an OrderedPair
-    OrderedPair op(v1, v2);
-    mUniqueEdgePairs[op] = indx1;  // op. [ ] constructs a new entry in map, ordering not important
-    // sorting done when retrieving
+    mPositions.push_back(v);  // add it to the vertex list
+    mVertAttribs.resize(mPositions.size());
+    mConn.AddVertex();
 
-    return {indx1, indx2};
+    return indx;
 }
 
-/*! \lab1 HalfEdgeMesh Implement the MergeAdjacentBoundaryEdge */
 /*!
- * Merges the outer UNINITIALIZED/BORDER to an already set inner half-edge.
- * \param [in] indx the index of the INNER half-edge, size_t
+ * Looks up the edge of a freshly added inner half-edge. The first face to
+ * use an edge registers its half-edge, the second one is paired with it.
+ * A third face on the same edge, or a second one with the same direction,
+ * is left unpaired and ends up on the boundary.
+ * \param [in] edge index of the inner half-edge, size_t
  */
-void HalfEdgeMesh::MergeOuterBoundaryEdge(size_t innerEdge) {
-    // Add your code here
-    // 1. Merge first loop (around innerEdge->vert)
-    // 2. Find leftmost edge, last edge counter clock-wise
-    // 3. Test if there's anything to merge
-    // 3a. If so merge the gap
-    // 3b. And set border flags
-    // 4. Merge second loop (around innerEdge->pair->vert)
+void HalfEdgeMesh::PairHalfEdge(size_t edge) {
+    const size_t v1 = EdgeVert(edge);
+    const size_t v2 = EdgeVert(EdgeNext(edge));
+
+    std::pair<size_t, bool> found = mUniqueEdgePairs.insert(MakeEdgeKey(v1, v2), edge);
+    if (found.second) {
+        return;
+    }
+
+    const size_t other = found.first;
+    if (EdgePair(other) != EdgeState::Uninitialized || EdgeVert(other) == v1) {
+        std::cerr << "Warning: edge " << v1 << "-" << v2
+                  << " is non-manifold or inconsistently oriented" << std::endl;
+        return;
+    }
+    SetEdgePair(edge, other);
+    SetEdgePair(other, edge);
 }
 
-/*! Proceeds to check if the mesh is valid. All indices are inspected and
- * checked to see that they are initialized. The method checks: mEdges, mFaces
- * and mVerts. Also checks to see if all verts have a neighborhood using the
- * findNeighbourFaces method.
+/*!
+ * Changing the tolerance re-welds nothing that is already in the mesh, it
+ * only affects vertices added afterwards.
+ * \param [in] tolerance the cell size used to quantize positions
  */
-void HalfEdgeMesh::Validate() {
-    std::vector<HalfEdge>::iterator iterEdge = mEdges.begin();
-    std::vector<HalfEdge>::iterator iterEdgeEnd = mEdges.end();
-    while (iterEdge != iterEdgeEnd) {
-        if ((*iterEdge).face == EdgeState::Uninitialized ||
-            (*iterEdge).next == EdgeState::Uninitialized ||
-            (*iterEdge).pair == EdgeState::Uninitialized ||
-            (*iterEdge).prev == EdgeState::Uninitialized ||
-            (*iterEdge).vert == EdgeState::Uninitialized) {
-            std::cerr << "HalfEdge " << iterEdge - mEdges.begin() << " not properly initialized"
-                      << std::endl;
-        }
+void HalfEdgeMesh::SetWeldTolerance(float tolerance) {
+    mWeldTolerance = tolerance;
+    mUniqueVerts.clear();
+}
+
+void HalfEdgeMesh::ReleaseBuildIndex() {
+    mUniqueVerts.clear();
+    mUniqueEdgePairs.clear();
+}
 
-        iterEdge++;
+void HalfEdgeMesh::RebuildBuildIndex() {
+    mUniqueVerts.clear();
+    mUniqueVerts.reserve(mPositions.size());
+    for (size_t i = 0; i < mPositions.size(); i++) {
+        mUniqueVerts.insert(MakeVertexKey(mPositions[i], mWeldTolerance), i);
     }
-    std::cerr << "Done with edge check (checked " << GetNumEdges() << " edges)" << std::endl;
 
-    std::vector<Face>::iterator iterTri = mFaces.begin();
-    std::vector<Face>::iterator iterTriEnd = mFaces.end();
-    while (iterTri != iterTriEnd) {
-        if ((*iterTri).edge == EdgeState::Uninitialized) {
-            std::cerr << "Tri " << iterTri - mFaces.begin() << " not properly initialized"
-                      << std::endl;
+    // One inner half-edge per edge is enough to find it again
+    mUniqueEdgePairs.clear();
+    mUniqueEdgePairs.reserve(mConn.NumInner() / 2);
+    for (size_t i = 0; i < mConn.NumInner(); i++) {
+        const size_t pair = EdgePair(i);
+        if (pair == EdgeState::Uninitialized || mConn.IsBoundary(pair) || i < pair) {
+            mUniqueEdgePairs.insert(MakeEdgeKey(EdgeVert(i), EdgeVert(EdgeNext(i))), i);
         }
-
-        iterTri++;
     }
-    std::cerr << "Done with face check (checked " << GetNumFaces() << " faces)" << std::endl;
+}
 
-    std::vector<Vertex>::iterator iterVertex = mVerts.begin();
-    std::vector<Vertex>::iterator iterVertexEnd = mVerts.end();
-    while (iterVertex != iterVertexEnd) {
-        if ((*iterVertex).edge == EdgeState::Uninitialized) {
-            std::cerr << "Vertex " << iterVertex - mVerts.begin() << " not properly initialized"
-                      << std::endl;
-        }
+/*! Proceeds to check if the mesh is valid. All indices are inspected and
+ * checked to see that they are initialized. The method checks: mConn,
+ * mFaceAttribs and mPositions. Also checks to see if all verts have a neighborhood using the
+ * findNeighbourFaces method.
+ */
+/*!
+ * Every half-edge, face and vertex is checked against its direct neighbors
+ * only, so each pass runs in parallel and nothing but the report is
+ * allocated. The edge pass counts the outgoing half-edges of every vertex
+ * in a flat array. Walking around a vertex must reach exactly that many,
+ * fewer means several fans meet at the vertex. The count also bounds the
+ * walk, so broken links can't make it loop forever.
+ */
+ValidationReport HalfEdgeMesh::CheckConnectivity() const {
+    typedef ValidationReport::Problem Problem;
+    const size_t numEdges = GetNumEdges();
+    const size_t numVerts = GetNumVerts();
+
+    ValidationReport report;
+    report.numEdges = numEdges;
+    report.numFaces = GetNumFaces();
+    report.numVerts = numVerts;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> outgoing(new std::atomic<uint32_t>[numVerts]());
+
+    struct EdgeProblems {
+        Problem uninitialized, pairs, loops;
+    };
+    const EdgeProblems edges = ParallelReduce(
+        0, numEdges, EdgeProblems(),
+        [&](size_t b, size_t e) {
+            EdgeProblems p;
+            for (size_t i = b; i < e; i++) {
+                const size_t vert = EdgeVert(i);
+                const size_t pair = EdgePair(i);
+                if (vert >= numVerts || pair >= numEdges) {
+                    p.uninitialized.Add(i);
+                    continue;
+                }
+                outgoing[vert].fetch_add(1, std::memory_order_relaxed);
+
+                const size_t next = EdgeNext(i);
+                const size_t prev = EdgePrev(i);
+                const bool loop = next < numEdges && prev < numEdges && EdgePrev(next) == i &&
+                                  EdgeNext(prev) == i && EdgeFace(next) == EdgeFace(i);
+                if (!loop) p.loops.Add(i);
+                // The pair runs the other way, from the end of this half-edge
+                if (pair == i || EdgePair(pair) != i ||
+                    (loop && EdgeVert(pair) != EdgeVert(next))) {
+                    p.pairs.Add(i);
+                }
+            }
+            return p;
+        },
+        [](EdgeProblems a, const EdgeProblems& b) {
+            a.uninitialized.Merge(b.uninitialized);
+            a.pairs.Merge(b.pairs);
+            a.loops.Merge(b.loops);
+            return a;
+        });
+    report.uninitializedEdges = edges.uninitialized;
+    report.badPairs = edges.pairs;
+    report.badLoops = edges.loops;
+
+    report.degenerateFaces = ParallelReduce(
+        0, GetNumFaces(), Problem(),
+        [&](size_t b, size_t e) {
+            Problem p;
+            for (size_t i = b; i < e; i++) {
+                const size_t edge = FaceEdge(i);
+                const size_t v1 = EdgeVert(edge), v2 = EdgeVert(edge + 1), v3 = EdgeVert(edge + 2);
+                if (v1 == v2 || v2 == v3 || v3 == v1) p.Add(i);
+            }
+            return p;
+        },
+        [](Problem a, const Problem& b) {
+            a.Merge(b);
+            return a;
+        });
+
+    struct VertProblems {
+        Problem isolated, vertEdges, nonManifold;
+    };
+    const VertProblems verts = ParallelReduce(
+        0, numVerts, VertProblems(),
+        [&](size_t b, size_t e) {
+            VertProblems p;
+            for (size_t i = b; i < e; i++) {
+                const size_t start = VertEdge(i);
+                const size_t expected = outgoing[i].load(std::memory_order_relaxed);
+                if (start == EdgeState::Uninitialized && expected == 0) {
+                    p.isolated.Add(i);
+                    continue;
+                }
+                if (start >= numEdges || EdgeVert(start) != i) {
+                    p.vertEdges.Add(i);
+                    continue;
+                }
+
+                bool manifold = true;
+                size_t count = 0;
+                size_t edge = start;
+                do {
+                    const size_t pair = EdgePair(edge);
+                    const size_t prev = EdgePrev(edge);
+                    if (count == expected || EdgeVert(edge) != i || pair >= numEdges ||
+                        prev >= numEdges) {
+                        manifold = false;
+                        break;
+                    }
+                    // A neighbor seen before means two edges between the same vertices
+                    for (size_t seen = start; seen != edge; seen = EdgePair(EdgePrev(seen))) {
+                        if (EdgeVert(EdgePair(seen)) == EdgeVert(pair)) manifold = false;
+                    }
+                    count++;
+                    edge = EdgePair(prev);
+                } while (edge != start && edge < numEdges);
+
+                if (!manifold || edge != start || count != expected) p.nonManifold.Add(i);
+            }
+            return p;
+        },
+        [](VertProblems a, const VertProblems& b) {
+            a.isolated.Merge(b.isolated);
+            a.vertEdges.Merge(b.vertEdges);
+            a.nonManifold.Merge(b.nonManifold);
+            return a;
+        });
+    report.isolatedVerts = verts.isolated;
+    report.badVertEdges = verts.vertEdges;
+    report.nonManifoldVerts = verts.nonManifold;
+
+    return report;
+}
 
-        iterVertex++;
-    }
-    std::cerr << "Done with vertex check (checked " << GetNumVerts() << " vertices)" << std::endl;
-
-    std::cerr << "Looping through triangle neighborhood of each vertex... ";
-    iterVertex = mVerts.begin();
-    iterVertexEnd = mVerts.end();
-    int emptyCount = 0;
-    std::vector<size_t> problemVerts;
-    while (iterVertex != iterVertexEnd) {
-        std::vector<size_t> foundFaces = FindNeighborFaces(iterVertex - mVerts.begin());
-        std::vector<size_t> foundVerts = FindNeighborVertices(iterVertex - mVerts.begin());
-        if (foundFaces.empty() || foundVerts.empty()) emptyCount++;
-        std::set<size_t> uniqueFaces(foundFaces.begin(), foundFaces.end());
-        std::set<size_t> uniqueVerts(foundVerts.begin(), foundVerts.end());
-        if (foundFaces.size() != uniqueFaces.size() || foundVerts.size() != uniqueVerts.size()) {
-            problemVerts.push_back(iterVertex - mVerts.begin());
-        }
-        iterVertex++;
-    }
-    std::cerr << std::endl << "Done: " << emptyCount << " isolated vertices found" << std::endl;
-    if (problemVerts.size()) {
-        std::cerr << std::endl
-                  << "Found " << problemVerts.size() << " duplicate faces in vertices: ";
-        std::copy(problemVerts.begin(), problemVerts.end(),
-                  std::ostream_iterator<size_t>(std::cerr, ", "));
-        std::cerr << "\n";
+ValidationReport HalfEdgeMesh::Validate() {
+    const ValidationReport report = CheckConnectivity();
+    report.Print(std::cerr);
+
+    // Faces own their half-edges at 3f..3f+2, there are no face links to check
+    if (mConn.NumFaces() != GetNumFaces()) {
+        std::cerr << "Face count " << GetNumFaces() << " does not match connectivity ("
+                  << mConn.NumFaces() << ")" << std::endl;
     }
+
+    const size_t numShells = Shells();
     std::cerr << std::endl
-              << "The mesh has genus " << Genus() << ", and consists of " << Shells()
+              << "The mesh has genus " << Genus(numShells) << ", and consists of " << numShells
               << " shells.\n";
 
-    std::cerr << "# Faces: " << std::to_string(mFaces.size()) << std::endl;
-    std::cerr << "# Edges: " << std::to_string(mEdges.size() / 2) << std::endl;
-    std::cerr << "# Vertices: " << std::to_string(mVerts.size()) << std::endl;
+    std::cerr << "# Faces: " << std::to_string(GetNumFaces()) << std::endl;
+    std::cerr << "# Edges: " << std::to_string(CountEdges()) << std::endl;
+    std::cerr << "# Vertices: " << std::to_string(GetNumVerts()) << std::endl;
+    return report;
 }
 
 /*! \lab1 Implement the FindNeighborVertices */
@@ -220,17 +577,9 @@ void HalfEdgeMesh::Validate() {
 std::vector<size_t> HalfEdgeMesh::FindNeighborVertices(size_t vertexIndex) const {
     // Collected vertices, sorted counter clockwise!
     std::vector<size_t> oneRing;
-
-    HalfEdge curr_edge = e(v(vertexIndex).edge);
-    size_t end = e(curr_edge.prev).pair;
-    oneRing.push_back(e(curr_edge.next).vert);
-    curr_edge = e(end);
-
-    while (e(curr_edge.prev).pair != end) {
-        oneRing.push_back(e(curr_edge.next).vert);
-        curr_edge = e(e(curr_edge.prev).pair);
+    for (size_t vert : VerticesAroundVertex(vertexIndex)) {
+        oneRing.push_back(vert);
     }
-
     return oneRing;
 }
 
@@ -242,17 +591,9 @@ std::vector<size_t> HalfEdgeMesh::FindNeighborVertices(size_t vertexIndex) const
 std::vector<size_t> HalfEdgeMesh::FindNeighborFaces(size_t vertexIndex) const {
     // Collected faces, sorted counter clockwise!
     std::vector<size_t> foundFaces;
-
-	HalfEdge curr_edge = e(v(vertexIndex).edge);
-    size_t end = e(curr_edge.prev).pair;
-    foundFaces.push_back(e(curr_edge.next).face);
-    curr_edge = e(end);
-
-    while (e(curr_edge.prev).pair != end) {
-        foundFaces.push_back(e(curr_edge.next).face);
-        curr_edge = e(e(curr_edge.prev).pair);
+    for (size_t face : FacesAroundVertex(vertexIndex)) {
+        foundFaces.push_back(face);
     }
-
     return foundFaces;
 }
 
@@ -263,7 +604,7 @@ float HalfEdgeMesh::VertexCurvature(size_t vertexIndex) const {
     assert(oneRing.size() != 0);
 
     size_t curr, next;
-    const glm::vec3& vi = mVerts.at(vertexIndex).pos;
+    const glm::vec3& vi = mPositions.at(vertexIndex);
     float angleSum = 0.f;
     float area = 0.f;
     for (size_t i = 0; i < oneRing.size(); i++) {
@@ -277,8 +618,8 @@ float HalfEdgeMesh::VertexCurvature(size_t vertexIndex) const {
 
         // find vertices in 1-ring according to figure 5 in lab text
         // next - beta
-        const glm::vec3& nextPos = mVerts.at(next).pos;
-        const glm::vec3& vj = mVerts.at(curr).pos;
+        const glm::vec3& nextPos = mPositions.at(next);
+        const glm::vec3& vj = mPositions.at(curr);
 
         // compute angle and area
         angleSum += acos(glm::dot(vj - vi, nextPos - vi) /
@@ -287,33 +628,25 @@ float HalfEdgeMesh::VertexCurvature(size_t vertexIndex) const {
     }
     return (2.f * static_cast<float>(M_PI) - angleSum) / area;*/
     
-    std::vector<size_t> oneRing = FindNeighborVertices(vertexIndex);
-    assert(oneRing.size() != 0);
+    assert(!EdgesAroundVertex(vertexIndex).empty());
     size_t curr, next, prev;
 
     glm::vec3 sum = {0, 0, 0};
     float area = 0;
 
-    for (size_t i = 0; i < oneRing.size(); i++) {
-        curr = oneRing.at(i);
+    // For each outgoing half-edge the neighbors before and after it in the
+    // one-ring are the opposite corners of the two faces sharing the edge
+    for (size_t edge : EdgesAroundVertex(vertexIndex)) {
+        curr = EdgeVert(EdgeNext(edge));
+        next = EdgeVert(EdgePrev(edge));
+        prev = EdgeVert(EdgePrev(EdgePair(edge)));
 
-        if (i == 0) {
-            prev = oneRing.back();
-        } else {
-            prev = oneRing.at(i - 1);
-        }
-
-        if (i < oneRing.size() - 1) {
-            next = oneRing.at(i + 1);
-        } else {
-            next = oneRing.front();
-        }
-
-        float cotangentAlpha = Cotangent(v(curr).pos, v(prev).pos, v(vertexIndex).pos);
-        float cotangentBeta = Cotangent(v(curr).pos, v(next).pos, v(vertexIndex).pos);
+        float cotangentAlpha = Cotangent(Position(curr), Position(prev), Position(vertexIndex));
+        float cotangentBeta = Cotangent(Position(curr), Position(next), Position(vertexIndex));
 
-        sum += (cotangentAlpha + cotangentBeta) * (v(vertexIndex).pos - v(curr).pos);
-        area += ((cotangentAlpha + cotangentBeta) * pow(glm::length(v(vertexIndex).pos - v(curr).pos), 2.0f));
+        sum += (cotangentAlpha + cotangentBeta) * (Position(vertexIndex) - Position(curr));
+        area += ((cotangentAlpha + cotangentBeta) *
+                 pow(glm::length(Position(vertexIndex) - Position(curr)), 2.0f));
     }
     area = area / 8.0f;
 
@@ -322,23 +655,23 @@ float HalfEdgeMesh::VertexCurvature(size_t vertexIndex) const {
 
 float HalfEdgeMesh::FaceCurvature(size_t faceIndex) const {
     // NB Assumes vertex curvature already computed
-    size_t indx = f(faceIndex).edge;
+    size_t indx = FaceEdge(faceIndex);
     const EdgeIterator it = GetEdgeIterator(indx);
 
-    const auto& v1 = v(it.GetEdgeVertexIndex());
-    const auto& v2 = v(it.Next().GetEdgeVertexIndex());
-    const auto& v3 = v(it.Next().GetEdgeVertexIndex());
+    const float c1 = mVertAttribs.Curvature(it.GetEdgeVertexIndex());
+    const float c2 = mVertAttribs.Curvature(it.Next().GetEdgeVertexIndex());
+    const float c3 = mVertAttribs.Curvature(it.Next().GetEdgeVertexIndex());
 
-    return (v1.curvature + v2.curvature + v3.curvature) / 3.f;
+    return (c1 + c2 + c3) / 3.f;
 }
 
 glm::vec3 HalfEdgeMesh::FaceNormal(size_t faceIndex) const {
-    size_t indx = f(faceIndex).edge;
+    size_t indx = FaceEdge(faceIndex);
     const EdgeIterator it = GetEdgeIterator(indx);
 
-    const auto& p1 = v(it.GetEdgeVertexIndex()).pos;
-    const auto& p2 = v(it.Next().GetEdgeVertexIndex()).pos;
-    const auto& p3 = v(it.Next().GetEdgeVertexIndex()).pos;
+    const auto& p1 = Position(it.GetEdgeVertexIndex());
+    const auto& p2 = Position(it.Next().GetEdgeVertexIndex());
+    const auto& p3 = Position(it.Next().GetEdgeVertexIndex());
 
     const auto e1 = p2 - p1;
     const auto e2 = p3 - p1;
@@ -349,209 +682,378 @@ glm::vec3 HalfEdgeMesh::VertexNormal(size_t vertexIndex) const {
     glm::vec3 n(0.f, 0.f, 0.f);
 
     // Add your code here
-    std::vector<size_t> face_neighbours = FindNeighborFaces(vertexIndex);
-
-    for (auto face : face_neighbours) {
-        n += f(face).normal;
+    for (size_t face : FacesAroundVertex(vertexIndex)) {
+        if (face != EdgeState::Border) n += mFaceAttribs.Normal(face);
     }
 
     return glm::normalize(n);
 }
 
 void HalfEdgeMesh::Initialize() {
+    // The mesh is complete, the lookup tables are only needed if faces are added later
+    ReleaseBuildIndex();
+    mConn.BuildBoundary();
     Validate();
+    MarkAllDirty();
     Update();
 }
 
 void HalfEdgeMesh::Update() {
-    // Calculate and store all differentials and area
+    // Faces may have been added since the boundary was last built
+    mConn.BuildBoundary();
+
+    // After a local edit only the neighborhood of the edit is redone
+    if (UpdateDirtyRegion()) return;
+
+    // Calculate and store all differentials and area. Every pass only
+    // writes its own element, so they run in parallel
 
     // First update all face normals and triangle areas
-    for (size_t i = 0; i < GetNumFaces(); i++) {
-        f(i).normal = FaceNormal(i);
-    }
-    // Then update all vertex normals and curvature
-    for (size_t i = 0; i < GetNumVerts(); i++) {
+    std::vector<glm::vec3>& faceNormals = mFaceAttribs.Normals();
+    ParallelFor(0, GetNumFaces(), [&](size_t i) { faceNormals[i] = FaceNormal(i); });
+
+    // Then update all vertex normals
+    std::vector<glm::vec3>& vertNormals = mVertAttribs.Normals();
+    ParallelFor(0, GetNumVerts(), [&](size_t i) {
         // Vertex normals are just weighted averages
-        mVerts.at(i).normal = VertexNormal(i);
-    }
+        vertNormals[i] = VertexNormal(i);
+    });
 
-    // Then update vertex curvature
-    for (size_t i = 0; i < GetNumVerts(); i++) {
-        mVerts.at(i).curvature = VertexCurvature(i);
-        //    std::cerr <<   mVerts.at(i).curvature << "\n";
-    }
+    // The curvature is skipped, and not even allocated, unless it is used
+    if (NeedsCurvature()) UpdateCurvature();
+    ClearDirty();
 
-    // Finally update face curvature
-    for (size_t i = 0; i < GetNumFaces(); i++) {
-        f(i).curvature = FaceCurvature(i);
-    }
-
-    std::cerr << "Area: " << Area() << ".\n";
-    std::cerr << "Volume: " << Volume() << ".\n";
+    // Area and volume come out of the same pass over the faces
+    MeshStats stats;
+    AddFaceStats(stats);
+    std::cerr << "Area: " << stats.area << ".\n";
+    std::cerr << "Volume: " << stats.volume << ".\n";
 
     // Update vertex and face colors
-    if (!mColorMap) {
-        return;
-    }
+    MapCurvatureColors(mVertAttribs, mFaceAttribs);
+}
 
-    float minCurvature = std::numeric_limits<float>::max();
-    float maxCurvature = -std::numeric_limits<float>::max();
+void HalfEdgeMesh::UpdateCurvature() {
+    // Vertex curvature first, the face curvature averages it
+    std::vector<float>& vertCurvature = mVertAttribs.Curvature();
+    ParallelFor(0, GetNumVerts(), [&](size_t i) { vertCurvature[i] = VertexCurvature(i); });
 
-    if (!mAutoMinMax) {
-        minCurvature = mMinCMap;
-        maxCurvature = mMaxCMap;
-    }
-
-    if (mVisualizationMode == CurvatureVertex) {
-        if (!mAutoMinMax) {
-            std::cerr << "Mapping color based on vertex curvature with range [" << mMinCMap << ","
-                      << mMaxCMap << "]" << std::endl;
-        } else {
-            // Compute range from vertices
-            for (auto& vert : mVerts) {
-                if (minCurvature > vert.curvature) minCurvature = vert.curvature;
-                if (maxCurvature < vert.curvature) maxCurvature = vert.curvature;
-            }
-            std::cerr << "Automatic mapping of color based on vertex curvature with range ["
-                      << minCurvature << "," << maxCurvature << "]" << std::endl;
-            mMinCMap = minCurvature;
-            mMaxCMap = maxCurvature;
-        }
-        for (auto& vert : mVerts) {
-            vert.color = mColorMap->Map(vert.curvature, minCurvature, maxCurvature);
-        }
-    } else if (mVisualizationMode == CurvatureFace) {
-        if (!mAutoMinMax) {
-            std::cerr << "Mapping color based on face curvature with range [" << mMinCMap << ","
-                      << mMaxCMap << "]" << std::endl;
-        } else {
-            // Compute range from faces
-            for (auto& face : mFaces) {
-                if (minCurvature > face.curvature) minCurvature = face.curvature;
-                if (maxCurvature < face.curvature) maxCurvature = face.curvature;
-            }
-            std::cerr << "Automatic mapping of color based on face curvature with range ["
-                      << minCurvature << "," << maxCurvature << "]" << std::endl;
-            mMinCMap = minCurvature;
-            mMaxCMap = maxCurvature;
-        }
-        for (auto& face : mFaces) {
-            face.color = mColorMap->Map(face.curvature, minCurvature, maxCurvature);
-        }
-    }
+    std::vector<float>& faceCurvature = mFaceAttribs.Curvature();
+    ParallelFor(0, GetNumFaces(), [&](size_t i) { faceCurvature[i] = FaceCurvature(i); });
 }
 
 /*! \lab1 Implement the area */
 float HalfEdgeMesh::Area() const {
-    float area = 0;
     // Add code here
-    // std::cerr << "Area calculation not implemented for half-edge mesh!\n";
+    MeshStats stats;
+    AddFaceStats(stats);
+    return static_cast<float>(stats.area);
+}
 
-    for (auto face : mFaces) {
-        size_t indx = face.edge;
-        const EdgeIterator it = GetEdgeIterator(indx);
+/*! \lab1 Implement the volume */
+float HalfEdgeMesh::Volume() const {
+    // Add code here
+    MeshStats stats;
+    AddFaceStats(stats);
+    return static_cast<float>(stats.volume);
+}
 
-        const auto& p1 = v(it.GetEdgeVertexIndex()).pos;
-        const auto& p2 = v(it.Next().GetEdgeVertexIndex()).pos;
-        const auto& p3 = v(it.Next().GetEdgeVertexIndex()).pos;
+/*!
+ * Inner half-edges paired with each other make one edge per two, those
+ * paired with a boundary half-edge or not paired at all one edge each, so
+ * the count does not depend on whether the boundary has been built.
+ */
+size_t HalfEdgeMesh::CountEdges() const {
+    const size_t numInner = mConn.NumInner();
+    const size_t numOpen = ParallelReduce(
+        0, numInner, size_t(0),
+        [&](size_t begin, size_t end) {
+            size_t n = 0;
+            for (size_t h = begin; h < end; h++) n += EdgePair(h) >= numInner;
+            return n;
+        },
+        [](size_t a, size_t b) { return a + b; });
+    return (numInner + numOpen) / 2;
+}
 
-        const auto e1 = p2 - p1;
-        const auto e2 = p3 - p1;
+MeshStats HalfEdgeMesh::ComputeStats() const {
+    MeshStats stats;
+    AddFaceStats(stats);
+    AddVertexStats(stats);
+    stats.eulerCharacteristic = static_cast<long>(GetNumVerts()) -
+                                static_cast<long>(CountEdges()) +
+                                static_cast<long>(GetNumFaces());
+    stats.shells = Shells();
+    return stats;
+}
 
-        area += glm::length(glm::cross(e1, e2)) / 2;
-    }
+/*!
+ * The triangles are summed in double precision per chunk and the chunk
+ * sums are merged in chunk order, so the result does not depend on the
+ * number of threads. The volume sums the signed tetrahedra spanned by the
+ * origin and each face, which is exact for closed meshes and does not
+ * depend on the stored face normals.
+ */
+void HalfEdgeMesh::AddFaceStats(MeshStats& stats) const {
+    struct Sums {
+        CompensatedSum area, volume;
+        float minCurvature, maxCurvature;
+    };
+    Sums init;
+    init.minCurvature = stats.minFaceCurvature;
+    init.maxCurvature = stats.maxFaceCurvature;
+
+    const bool hasCurvature = mFaceAttribs.HasCurvature();
+    const Sums sums = ParallelReduce(
+        0, GetNumFaces(), init,
+        [&](size_t b, size_t e) {
+            Sums s = init;
+            for (size_t i = b; i < e; i++) {
+                const size_t edge = FaceEdge(i);
+                const glm::dvec3 p1(mPositions[EdgeVert(edge)]);
+                const glm::dvec3 p2(mPositions[EdgeVert(EdgeNext(edge))]);
+                const glm::dvec3 p3(mPositions[EdgeVert(EdgePrev(edge))]);
+
+                s.area.Add(0.5 * glm::length(glm::cross(p2 - p1, p3 - p1)));
+                s.volume.Add(glm::dot(p1, glm::cross(p2, p3)) / 6.0);
+
+                if (!hasCurvature) continue;
+                const float curvature = mFaceAttribs.Curvature(i);
+                if (s.minCurvature > curvature) s.minCurvature = curvature;
+                if (s.maxCurvature < curvature) s.maxCurvature = curvature;
+            }
+            return s;
+        },
+        [](Sums a, const Sums& b) {
+            a.area += b.area;
+            a.volume += b.volume;
+            a.minCurvature = std::min(a.minCurvature, b.minCurvature);
+            a.maxCurvature = std::max(a.maxCurvature, b.maxCurvature);
+            return a;
+        });
+
+    stats.area = sums.area.Value();
+    stats.volume = sums.volume.Value();
+    stats.minFaceCurvature = sums.minCurvature;
+    stats.maxFaceCurvature = sums.maxCurvature;
+}
 
-    return area;
+void HalfEdgeMesh::AddVertexStats(MeshStats& stats) const {
+    struct Ranges {
+        glm::vec3 boundsMin, boundsMax;
+        float minCurvature, maxCurvature;
+    };
+    const Ranges init = {stats.boundsMin, stats.boundsMax, stats.minVertexCurvature,
+                         stats.maxVertexCurvature};
+
+    const bool hasCurvature = mVertAttribs.HasCurvature();
+    const Ranges ranges = ParallelReduce(
+        0, GetNumVerts(), init,
+        [&](size_t b, size_t e) {
+            Ranges r = init;
+            for (size_t i = b; i < e; i++) {
+                r.boundsMin = glm::min(r.boundsMin, mPositions[i]);
+                r.boundsMax = glm::max(r.boundsMax, mPositions[i]);
+                if (!hasCurvature) continue;
+                const float curvature = mVertAttribs.Curvature(i);
+                if (r.minCurvature > curvature) r.minCurvature = curvature;
+                if (r.maxCurvature < curvature) r.maxCurvature = curvature;
+            }
+            return r;
+        },
+        [](Ranges a, const Ranges& b) {
+            a.boundsMin = glm::min(a.boundsMin, b.boundsMin);
+            a.boundsMax = glm::max(a.boundsMax, b.boundsMax);
+            a.minCurvature = std::min(a.minCurvature, b.minCurvature);
+            a.maxCurvature = std::max(a.maxCurvature, b.maxCurvature);
+            return a;
+        });
+
+    stats.boundsMin = ranges.boundsMin;
+    stats.boundsMax = ranges.boundsMax;
+    stats.minVertexCurvature = ranges.minCurvature;
+    stats.maxVertexCurvature = ranges.maxCurvature;
 }
 
-/*! \lab1 Implement the volume */
-float HalfEdgeMesh::Volume() const {
-    float volume = 0;
-    // Add code here
-    // std::cerr << "Volume calculation not implemented for half-edge mesh!\n";
+/*! \lab1 Calculate the number of shells  */
+/*!
+ * Every edge joins the shells of its two vertices. The union-find is lock
+ * free, so the edges are united in parallel and each edge is only visited
+ * from its lower half-edge.
+ */
+void HalfEdgeMesh::UniteEdges(UnionFind<>& shells) const {
+    ParallelFor(0, mConn.NumInner(), [&](size_t i) {
+        if (EdgePair(i) > i) shells.Unite(EdgeVert(i), EdgeVert(EdgeNext(i)));
+    });
+}
 
-    for (auto face : mFaces) {
-        size_t indx = face.edge;
-        const EdgeIterator it = GetEdgeIterator(indx);
+size_t HalfEdgeMesh::Shells() const {
+    UnionFind<> shells(GetNumVerts());
+    UniteEdges(shells);
+
+    // Every shell has exactly one root
+    return ParallelReduce(
+        0, GetNumVerts(), size_t(0),
+        [&](size_t b, size_t e) {
+            size_t roots = 0;
+            for (size_t i = b; i < e; i++) {
+                if (shells.Find(i) == i) roots++;
+            }
+            return roots;
+        },
+        [](size_t a, size_t b) { return a + b; });
+}
 
-        const auto& p1 = v(it.GetEdgeVertexIndex()).pos;
-        const auto& p2 = v(it.Next().GetEdgeVertexIndex()).pos;
-        const auto& p3 = v(it.Next().GetEdgeVertexIndex()).pos;
+size_t HalfEdgeMesh::LabelShells(std::vector<size_t>& shellIds) const {
+    UnionFind<> shells(GetNumVerts());
+    UniteEdges(shells);
 
-        const auto e1 = p2 - p1;
-        const auto e2 = p3 - p1;
+    shellIds.resize(GetNumVerts());
+    ParallelFor(0, GetNumVerts(), [&](size_t i) { shellIds[i] = shells.Find(i); });
 
-        volume += *glm::value_ptr(((p1 + p2 + p3) / 3.0f) * face.normal *
-                                  (glm::length(glm::cross(e1, e2)) / 2));
+    // The root is the lowest vertex of its shell, so it is numbered before the rest
+    size_t numShells = 0;
+    for (size_t i = 0; i < shellIds.size(); i++) {
+        shellIds[i] = shellIds[i] == i ? numShells++ : shellIds[shellIds[i]];
     }
-
-    return volume;
+    return numShells;
 }
 
-/*! \lab1 Calculate the number of shells  */
-size_t HalfEdgeMesh::Shells() const { 
-	std::queue<size_t> vertexQueue;
-    std::set<size_t> vertexTaggedSet;
-
-	int n_shells = 1;
-
-	vertexQueue.push(0);
-    vertexTaggedSet.insert(0);
-
-	while (mVerts.size() != vertexTaggedSet.size()) {
-        if (mVerts.size() <= vertexTaggedSet.size()) break;
-		while (!vertexQueue.empty()) {
-			size_t curr = vertexQueue.front();
-			vertexQueue.pop();
-            std::vector<size_t> n_verts = FindNeighborVertices(curr);
-			for (size_t neighbour : n_verts) {
-				if (vertexTaggedSet.find(neighbour) == vertexTaggedSet.end()) {
-					vertexQueue.push(neighbour);
-                    vertexTaggedSet.insert(neighbour);
-				}
-			}
-        
-		}
-        for (int i = 0; i < mVerts.size(); i++) {
-            if (vertexTaggedSet.find(i) == vertexTaggedSet.end()) {
-				n_shells++;
-				vertexQueue.push(i);
-                vertexTaggedSet.insert(i);
-                break;
-			}
-		}
-	}
-    return n_shells;
-}
-
-/*! \lab1 Implement the genus */
-size_t HalfEdgeMesh::Genus() const {
+size_t HalfEdgeMesh::Genus() const { return Genus(Shells()); }
+
+size_t HalfEdgeMesh::Genus(size_t numShells) const {
     // Add code here
-    return (mEdges.size()/2 - mVerts.size() - mFaces.size() + 2*Shells()) / 2;
+    return (CountEdges() - GetNumVerts() - GetNumFaces() + 2 * numShells) / 2;
+}
+
+void HalfEdgeMesh::ClearDirty() {
+    mDirtyVerts.clear();
+    mDirtyFaces.clear();
+    mVertFlags.assign(GetNumVerts(), 0);
+    mFaceFlags.assign(GetNumFaces(), 0);
+    mAllDirty = false;
+}
+
+/*!
+ * A moved vertex changes the normal of its faces. The vertex normals and
+ * curvature depend on the faces and positions in the one-ring, so all
+ * corners of those faces are redone, and the face curvature averages the
+ * corners, which takes in the faces around them. The region is small, the
+ * lists are collected serially with the flags as visited marks.
+ */
+bool HalfEdgeMesh::UpdateDirtyRegion() {
+    if (mAllDirty || mVertFlags.size() != GetNumVerts() || mFaceFlags.size() != GetNumFaces()) {
+        return false;
+    }
+    // Curvature that was not kept so far has to be computed everywhere
+    const bool curvature = NeedsCurvature();
+    if (curvature && !mVertAttribs.HasCurvature()) return false;
+    // A large region is faster to redo in one sweep over the mesh
+    if (8 * (mDirtyVerts.size() + mDirtyFaces.size()) > GetNumVerts()) {
+        return false;
+    }
+
+    // Bit 0 is the dirty mark set by MarkVertexDirty/MarkFaceDirty
+    const uint8_t NewNormal = 2, NewCurvature = 4;
+    std::vector<size_t> faces, verts, ringFaces;
+
+    for (size_t i : mDirtyFaces) {
+        mFaceFlags[i] |= NewNormal;
+        faces.push_back(i);
+    }
+    for (size_t vert : mDirtyVerts) {
+        for (size_t i : FacesAroundVertex(vert)) {
+            if (i == EdgeState::Border || (mFaceFlags[i] & NewNormal)) continue;
+            mFaceFlags[i] |= NewNormal;
+            faces.push_back(i);
+        }
+    }
+    for (size_t face : faces) {
+        for (size_t i : VerticesAroundFace(face)) {
+            if (mVertFlags[i] & NewNormal) continue;
+            mVertFlags[i] |= NewNormal;
+            verts.push_back(i);
+        }
+    }
+    for (size_t vert : verts) {
+        for (size_t i : FacesAroundVertex(vert)) {
+            if (i == EdgeState::Border || (mFaceFlags[i] & NewCurvature)) continue;
+            mFaceFlags[i] |= NewCurvature;
+            ringFaces.push_back(i);
+        }
+    }
+
+    // Same passes as the full update, restricted to the region
+    std::vector<glm::vec3>& faceNormals = mFaceAttribs.Normals();
+    std::vector<glm::vec3>& vertNormals = mVertAttribs.Normals();
+    ParallelFor(0, faces.size(), [&](size_t k) { faceNormals[faces[k]] = FaceNormal(faces[k]); });
+    ParallelFor(0, verts.size(), [&](size_t k) { vertNormals[verts[k]] = VertexNormal(verts[k]); });
+
+    // The color range is kept up to date from the values that changed
+    std::vector<float> oldVertCurvature, oldFaceCurvature;
+    if (curvature) {
+        std::vector<float>& vertCurvature = mVertAttribs.Curvature();
+        std::vector<float>& faceCurvature = mFaceAttribs.Curvature();
+        oldVertCurvature.resize(verts.size());
+        oldFaceCurvature.resize(ringFaces.size());
+        for (size_t k = 0; k < verts.size(); k++) oldVertCurvature[k] = vertCurvature[verts[k]];
+        for (size_t k = 0; k < ringFaces.size(); k++) {
+            oldFaceCurvature[k] = faceCurvature[ringFaces[k]];
+        }
+        ParallelFor(0, verts.size(),
+                    [&](size_t k) { vertCurvature[verts[k]] = VertexCurvature(verts[k]); });
+        ParallelFor(0, ringFaces.size(),
+                    [&](size_t k) { faceCurvature[ringFaces[k]] = FaceCurvature(ringFaces[k]); });
+    }
+
+    for (size_t i : verts) mVertFlags[i] = 0;
+    for (size_t i : mDirtyVerts) mVertFlags[i] = 0;
+    for (size_t i : ringFaces) mFaceFlags[i] = 0;
+    for (size_t i : faces) mFaceFlags[i] = 0;
+    mDirtyVerts.clear();
+    mDirtyFaces.clear();
+
+    if (curvature) {
+        MapCurvatureColors(mVertAttribs, verts, oldVertCurvature, mFaceAttribs, ringFaces,
+                           oldFaceCurvature);
+    }
+    return true;
 }
 
 void HalfEdgeMesh::Dilate(float amount) {
-    for (Vertex& v : mVerts) {
-        v.pos += amount * v.normal;
+    const std::vector<glm::vec3>& normals = mVertAttribs.Normals();
+    for (size_t i = 0; i < GetNumVerts(); i++) {
+        mPositions[i] += amount * normals[i];
     }
-    Initialize();
+    // Every vertex moved, the connectivity is unchanged
+    MarkAllDirty();
     Update();
 }
 
 void HalfEdgeMesh::Erode(float amount) {
-    for (Vertex& v : mVerts) {
-        v.pos -= amount * v.normal;
+    const std::vector<glm::vec3>& normals = mVertAttribs.Normals();
+    for (size_t i = 0; i < GetNumVerts(); i++) {
+        mPositions[i] -= amount * normals[i];
     }
-    Initialize();
+    // Every vertex moved, the connectivity is unchanged
+    MarkAllDirty();
     Update();
 }
 
 void HalfEdgeMesh::Smooth(float amount) {
-    for (Vertex& v : mVerts) {
-        v.pos -= amount * v.normal * v.curvature;
+    // Smoothing needs the curvature even if it is not shown
+    if (!mVertAttribs.HasCurvature()) {
+        mVertAttribs.Curvature();
+        MarkAllDirty();
+        Update();
+    }
+    const std::vector<glm::vec3>& normals = mVertAttribs.Normals();
+    const std::vector<float>& curvature = mVertAttribs.Curvature();
+    for (size_t i = 0; i < GetNumVerts(); i++) {
+        mPositions[i] -= amount * normals[i] * curvature[i];
     }
-    Initialize();
+    // Every vertex moved, the connectivity is unchanged
+    MarkAllDirty();
     Update();
 }
 
@@ -574,17 +1076,18 @@ void HalfEdgeMesh::Render() {
     glBegin(GL_TRIANGLES);
     const auto numTriangles = GetNumFaces();
     for (size_t i = 0; i < numTriangles; i++) {
-        auto& face = f(i);
+        const glm::vec3 faceColor = mFaceAttribs.Color(i);
+        const glm::vec3 faceNormal = mFaceAttribs.Normal(i);
 
-        auto* edge = &e(face.edge);
+        size_t edge = FaceEdge(i);
 
-        auto& v1 = v(edge->vert);
-        edge = &e(edge->next);
+        const Vertex v1 = GetVertex(EdgeVert(edge));
+        edge = EdgeNext(edge);
 
-        auto& v2 = v(edge->vert);
-        edge = &e(edge->next);
+        const Vertex v2 = GetVertex(EdgeVert(edge));
+        edge = EdgeNext(edge);
 
-        auto& v3 = v(edge->vert);
+        const Vertex v3 = GetVertex(EdgeVert(edge));
 
         if (mVisualizationMode == CurvatureVertex) {
             glColor3fv(glm::value_ptr(v1.color));
@@ -599,8 +1102,8 @@ void HalfEdgeMesh::Render() {
             glNormal3fv(glm::value_ptr(v3.normal));
             glVertex3fv(glm::value_ptr(v3.pos));
         } else {
-            glColor3fv(glm::value_ptr(face.color));
-            glNormal3fv(glm::value_ptr(face.normal));
+            glColor3fv(glm::value_ptr(faceColor));
+            glNormal3fv(glm::value_ptr(faceNormal));
 
             glVertex3fv(glm::value_ptr(v1.pos));
             glVertex3fv(glm::value_ptr(v2.pos));
@@ -615,20 +1118,20 @@ void HalfEdgeMesh::Render() {
         glBegin(GL_LINES);
         const auto numTriangles = GetNumFaces();
         for (size_t i = 0; i < numTriangles; i++) {
-            auto& face = f(i);
+            const glm::vec3 faceNormal = mFaceAttribs.Normal(i);
 
-            auto* edge = &e(face.edge);
+            size_t edge = FaceEdge(i);
 
-            auto& v1 = v(edge->vert);
-            edge = &e(edge->next);
+            const Vertex v1 = GetVertex(EdgeVert(edge));
+            edge = EdgeNext(edge);
 
-            auto& v2 = v(edge->vert);
-            edge = &e(edge->next);
+            const Vertex v2 = GetVertex(EdgeVert(edge));
+            edge = EdgeNext(edge);
 
-            auto& v3 = v(edge->vert);
+            const Vertex v3 = GetVertex(EdgeVert(edge));
 
             auto faceStart = (v1.pos + v2.pos + v3.pos) / 3.f;
-            auto faceEnd = faceStart + face.normal * 0.1f;
+            auto faceEnd = faceStart + faceNormal * 0.1f;
 
             glColor3f(1.f, 0.f, 0.f);  // Red for face normal
             glVertex3fv(glm::value_ptr(faceStart));
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <Geometry/HalfEdgeConnectivity.h>
 #include <Geometry/Mesh.h>
+#include <Geometry/MeshFile.h>
+#include <Geometry/MeshStats.h>
+#include <Geometry/ValidationReport.h>
+#include <Util/HashIndex.h>
 #include <Util/ObjIO.h>
+#include <Util/UnionFind.h>
 #include <Util/Util.h>
 #include <cassert>
 #include <limits>
-#include <map>
 #include <set>
 
 /*! \brief A half edge triangle mesh class.
@@ -16,6 +21,11 @@ class HalfEdgeMesh : public Mesh {
 public:
     HalfEdgeMesh();
     ~HalfEdgeMesh();
+    HalfEdgeMesh(const HalfEdgeMesh&) = default;
+    //! Takes over the arrays, e.g. to hand out a mesh built by a derived class
+    HalfEdgeMesh(HalfEdgeMesh&&) = default;
+    HalfEdgeMesh& operator=(const HalfEdgeMesh&) = default;
+    HalfEdgeMesh& operator=(HalfEdgeMesh&&) = default;
     virtual void Update();
     virtual void Initialize();
 
@@ -34,32 +44,32 @@ public:
 
     public:
         EdgeIterator& Next() {
-            mIndex = mHem->e(mIndex).next;
+            mIndex = mHem->EdgeNext(mIndex);
             return *this;
         }
         EdgeIterator& Prev() {
-            mIndex = mHem->e(mIndex).prev;
+            mIndex = mHem->EdgePrev(mIndex);
             return *this;
         }
         EdgeIterator& Pair() {
-            mIndex = mHem->e(mIndex).pair;
+            mIndex = mHem->EdgePair(mIndex);
             return *this;
         }
         const EdgeIterator& Next() const {
-            mIndex = mHem->e(mIndex).next;
+            mIndex = mHem->EdgeNext(mIndex);
             return *this;
         }
         const EdgeIterator& Prev() const {
-            mIndex = mHem->e(mIndex).prev;
+            mIndex = mHem->EdgePrev(mIndex);
             return *this;
         }
         const EdgeIterator& Pair() const {
-            mIndex = mHem->e(mIndex).pair;
+            mIndex = mHem->EdgePair(mIndex);
             return *this;
         }
         size_t GetEdgeIndex() const { return mIndex; }
-        size_t GetEdgeVertexIndex() const { return mHem->e(mIndex).vert; }
-        size_t GetEdgeFaceIndex() const { return mHem->e(mIndex).face; }
+        size_t GetEdgeVertexIndex() const { return mHem->EdgeVert(mIndex); }
+        size_t GetEdgeFaceIndex() const { return mHem->EdgeFace(mIndex); }
         const bool operator==(const EdgeIterator& eit) { return this->mIndex == eit.mIndex; }
         const bool operator!=(const EdgeIterator& eit) { return this->mIndex != eit.mIndex; }
     };
@@ -67,9 +77,106 @@ public:
     EdgeIterator GetEdgeIterator(size_t i) { return EdgeIterator(this, i); }
     const EdgeIterator GetEdgeIterator(size_t i) const { return EdgeIterator(this, i); }
 
+    //! What a Circulator walks around and what it returns
+    enum class Around {
+        VertexEdges,     //!< outgoing half-edges of a vertex
+        VertexVertices,  //!< one-ring vertices of a vertex
+        VertexFaces,     //!< faces around a vertex (Border on a boundary)
+        FaceEdges,       //!< half-edges of a face
+        FaceVertices     //!< corners of a face
+    };
+
+    /*! \brief Range over the neighborhood of a vertex or a face.
+     * Follows the half-edge links in place, nothing is allocated. Vertex
+     * neighborhoods are visited counter clockwise in the same order as
+     * FindNeighborVertices/FindNeighborFaces, e.g.
+     * \code
+     * for (size_t nb : VerticesAroundVertex(i)) { ... }
+     * \endcode
+     */
+    template <Around K>
+    class Circulator {
+    public:
+        class Iterator {
+        public:
+            Iterator(HalfEdgeMesh const* hem, size_t start) : mHem(hem), mStart(start), mCurr(start) {}
+
+            size_t operator*() const {
+                if constexpr (K == Around::VertexVertices) {
+                    return mHem->EdgeVert(mHem->EdgeNext(mCurr));
+                } else if constexpr (K == Around::VertexFaces) {
+                    return mHem->EdgeFace(mCurr);
+                } else if constexpr (K == Around::FaceVertices) {
+                    return mHem->EdgeVert(mCurr);
+                } else {
+                    return mCurr;
+                }
+            }
+            //! The half-edge the iterator is at
+            size_t Edge() const { return mCurr; }
+
+            Iterator& operator++() {
+                if constexpr (K == Around::FaceEdges || K == Around::FaceVertices) {
+                    mCurr = mHem->EdgeNext(mCurr);
+                } else {
+                    mCurr = mHem->EdgePair(mHem->EdgePrev(mCurr));
+                }
+                if (mCurr == mStart) mCurr = EdgeState::Uninitialized;
+                return *this;
+            }
+            bool operator==(const Iterator& it) const { return mCurr == it.mCurr; }
+            bool operator!=(const Iterator& it) const { return mCurr != it.mCurr; }
+
+        protected:
+            HalfEdgeMesh const* mHem;
+            size_t mStart, mCurr;
+        };
+
+        Circulator(HalfEdgeMesh const* hem, size_t start) : mHem(hem), mStart(start) {}
+        Iterator begin() const { return Iterator(mHem, mStart); }
+        Iterator end() const { return Iterator(mHem, EdgeState::Uninitialized); }
+        bool empty() const { return mStart == EdgeState::Uninitialized; }
+
+        //! Number of elements, walks the neighborhood once
+        size_t size() const {
+            size_t n = 0;
+            for (Iterator it = begin(); it != end(); ++it) n++;
+            return n;
+        }
+
+    protected:
+        HalfEdgeMesh const* mHem;
+        size_t mStart;
+    };
+
+    Circulator<Around::VertexEdges> EdgesAroundVertex(size_t vertexIndex) const {
+        return Circulator<Around::VertexEdges>(this, VertEdge(vertexIndex));
+    }
+    Circulator<Around::VertexVertices> VerticesAroundVertex(size_t vertexIndex) const {
+        return Circulator<Around::VertexVertices>(this, VertEdge(vertexIndex));
+    }
+    Circulator<Around::VertexFaces> FacesAroundVertex(size_t vertexIndex) const {
+        return Circulator<Around::VertexFaces>(this, VertEdge(vertexIndex));
+    }
+    Circulator<Around::FaceEdges> EdgesAroundFace(size_t faceIndex) const {
+        return Circulator<Around::FaceEdges>(this, FaceEdge(faceIndex));
+    }
+    Circulator<Around::FaceVertices> VerticesAroundFace(size_t faceIndex) const {
+        return Circulator<Around::FaceVertices>(this, FaceEdge(faceIndex));
+    }
+
     //! Adds a triangle to the mesh
     virtual bool AddFace(const std::vector<glm::vec3>& verts);
 
+    //! Builds the mesh from an indexed triangle list, replacing the current content
+    virtual bool Build(const glm::vec3* verts, size_t numVerts, const glm::uvec3* tris,
+                       size_t numTris) override;
+    using Mesh::Build;
+
+    virtual void SetVertexAttributes(const glm::vec3* normals, const glm::vec3* colors) override {
+        CopyVertexAttributes(mVertAttribs, normals, colors);
+    }
+
     //! Calculates the area of the mesh
     virtual float Area() const;
 
@@ -82,6 +189,17 @@ public:
     //! Calculates the number of shells
     virtual size_t Shells() const;
 
+    /*! Computes area, volume, bounds, Euler characteristic, shells and the
+     * curvature ranges together, with parallel compensated reductions
+     */
+    MeshStats ComputeStats() const;
+
+    /*! Finds the shell of every vertex. Shells are numbered from zero in
+     * the order of their lowest vertex index.
+     * \return the number of shells
+     */
+    size_t LabelShells(std::vector<size_t>& shellIds) const;
+
     //! Calculates the curvature at a vertex
     virtual float VertexCurvature(size_t vertexIndex) const;
 
@@ -94,86 +212,128 @@ public:
     //! Calculates the normal at a vertex
     virtual glm::vec3 VertexNormal(size_t vertexIndex) const;
 
-    //! Checks to see if the mesh is valid
-    void Validate();
+    /*! Checks the half-edge links, faces and vertex fans of the mesh
+     * without printing anything
+     */
+    ValidationReport CheckConnectivity() const;
+
+    //! Checks to see if the mesh is valid and prints the report
+    ValidationReport Validate();
+
+    /*! Writes the mesh, half-edges included, in the native binary format
+     * (.hem) that LoadBinary reopens without any parsing or rebuilding.
+     * The normals and curvature are stored too if attributes is set.
+     */
+    bool SaveBinary(std::ostream& os, bool attributes = true);
+
+    //! Replaces the mesh with a .hem file read through a memory mapping
+    bool LoadBinary(const std::string& filename);
+
+    /*! Sets the cell size of the grid that vertex positions are snapped to
+     * when faces are added; vertices falling in the same cell are welded.
+     * Nearby points in neighbouring cells are not welded, while points up to
+     * tolerance * sqrt(3) apart in one cell are. Zero (default) only welds
+     * vertices at identical positions.
+     */
+    void SetWeldTolerance(float tolerance);
+
+    //! Frees the lookup tables used while adding faces, they are rebuilt on demand
+    void ReleaseBuildIndex();
 
     virtual void Render() override;
 
 protected:
-    enum EdgeState : size_t {
-        Uninitialized = std::numeric_limits<size_t>::max() - 1,
-        Border = std::numeric_limits<size_t>::max()
-    };
-
-    /*! \brief The core half-edge struct
-     *  Implements the linked data structure edge type
+    /*! Index type of the connectivity. 32 bit indices limit a mesh to
+     * about four billion half-edges but halve the memory of every link.
      */
-    struct HalfEdge {
-        HalfEdge()
-            : vert(EdgeState::Uninitialized)
-            , face(EdgeState::Uninitialized)
-            , next(EdgeState::Uninitialized)
-            , prev(EdgeState::Uninitialized)
-            , pair(EdgeState::Uninitialized) {}
-        size_t vert;  //!< index into mVerts (the origin vertex)
-        size_t face;  //!< index into mFaces
-        size_t next;  //!< index into mEdges
-        size_t prev;  //!< index into mEdges
-        size_t pair;  //!< index into mEdges
+    typedef HalfEdgeConnectivity<uint32_t> Connectivity;
+
+    enum EdgeState : size_t {
+        Uninitialized = Connectivity::Uninitialized,
+        Border = Connectivity::Border
     };
 
-    /*! \brief A vertex is a point and an edge index
+    //! The half-edge links of the mesh
+    Connectivity mConn;
+    //! The vertex positions, the only per vertex data every mesh has
+    std::vector<glm::vec3> mPositions;
+    /*! Normals, curvature and colors of the vertices and faces. Curvature
+     * and colors are only allocated while they are visualized or used.
      */
-    struct Vertex : public Mesh::Vertex {
-        Vertex() : edge(EdgeState::Uninitialized) {}
-        size_t edge;  //!< index into mEdges
-    };
+    AttributeStreams mVertAttribs, mFaceAttribs;
 
-    /*! \brief A face has a normal and an index to an edge
+    /*! True if Update has to compute the curvature, i.e. when it is
+     * visualized or was requested by an algorithm such as Smooth
      */
-    struct Face : public Mesh::Face {
-        Face() : edge(EdgeState::Uninitialized) {}
-        size_t edge;  //!< index into mEdges
-    };
+    bool NeedsCurvature() const { return VisualizesCurvature() || mVertAttribs.HasCurvature(); }
 
-    //! The edges of the mesh
-    std::vector<HalfEdge> mEdges;
-    //! The vertices in the mesh
-    std::vector<Vertex> mVerts;
-    //! The faces in the mesh
-    std::vector<Face> mFaces;
+    //! Gathers all attributes of vertex i, e.g. for the file writers
+    Vertex GetVertex(size_t i) const {
+        return Vertex(mPositions[i], mVertAttribs.Normal(i), mVertAttribs.Color(i),
+                      mVertAttribs.Curvature(i));
+    }
 
     //! A utility data structure to speed up removal of redundant vertices
-    std::map<glm::vec3, size_t, glm_vec3_comparator<float>> mUniqueVerts;
-
-    struct OrderedPair {
-        size_t p1, p2;
-        OrderedPair(size_t i1, size_t i2) {
-            p1 = std::min(i1, i2);
-            p2 = std::max(i1, i2);
-        }
-        bool operator<(const OrderedPair& rhs) const {
-            if (this->p1 < rhs.p1) {
-                return true;
-            } else if (this->p1 == rhs.p1) {
-                if (this->p2 < rhs.p2) {
-                    return true;
-                }
-            }
-            return false;
-        }
-    };
+    HashIndex<VertexKey, size_t, VertexKeyHash> mUniqueVerts;
     //! A utility data structure to speed up removal of redundant edges
-    std::map<OrderedPair, size_t> mUniqueEdgePairs;
+    HashIndex<uint64_t, size_t, EdgeKeyHash> mUniqueEdgePairs;
+    //! Cell size used to quantize vertex positions for welding
+    float mWeldTolerance;
+
+    //! Re-creates mUniqueVerts and mUniqueEdgePairs from the current mesh
+    void RebuildBuildIndex();
+
+    //! Vertices moved and faces relinked since the last Update
+    std::vector<size_t> mDirtyVerts, mDirtyFaces;
+    //! Per vertex/face flags, set while listed as dirty, scratch bits in Update
+    std::vector<uint8_t> mVertFlags, mFaceFlags;
+    //! Set when the next Update has to recompute the whole mesh
+    bool mAllDirty;
+
+    //! Marks a vertex that moved, Update refreshes it and its one-ring
+    void MarkVertexDirty(size_t i) {
+        if (mAllDirty || mVertFlags[i]) return;
+        mVertFlags[i] = 1;
+        mDirtyVerts.push_back(i);
+    }
+    //! Marks a face whose corners changed
+    void MarkFaceDirty(size_t i) {
+        if (mAllDirty || mFaceFlags[i]) return;
+        mFaceFlags[i] = 1;
+        mDirtyFaces.push_back(i);
+    }
+    //! Makes the next Update recompute every normal and curvature
+    void MarkAllDirty() { mAllDirty = true; }
+    //! Forgets all dirty marks, to be called after a full update
+    void ClearDirty();
+
+    /*! Refreshes the normals, curvature and colors around the dirty
+     * vertices and faces only.
+     * \return false, without doing anything, if the whole mesh is dirty
+     * or the dirty region is too large to be worth it
+     */
+    bool UpdateDirtyRegion();
+
+    //! Computes the curvature of all vertices and faces, allocating the streams
+    void UpdateCurvature();
 
     //! Adds a vertex to the mesh
     virtual size_t AddVertex(const glm::vec3& v) override;
 
-    //! Adds a half edge pair, from vertex 1 to vertex 2, to the mesh
-    std::pair<size_t, size_t> AddHalfEdgePair(size_t v1, size_t v2);
+    //! Pairs a new inner half-edge with the matching half-edge of an earlier face
+    void PairHalfEdge(size_t edge);
+
+    //! Merges the vertices at the ends of every edge into one set
+    void UniteEdges(UnionFind<>& shells) const;
+
+    //! Genus from the Euler characteristic, given the number of shells
+    size_t Genus(size_t numShells) const;
+
+    //! Fills in area, volume and the face curvature range of stats
+    void AddFaceStats(MeshStats& stats) const;
 
-    //! Merges the outer (uninitialized) edge for a newly created triangle
-    void MergeOuterBoundaryEdge(size_t innerEdge);
+    //! Fills in the bounds and the vertex curvature range of stats
+    void AddVertexStats(MeshStats& stats) const;
 
     //! Finds all triangles that includes a given vertex.
     virtual std::vector<size_t> FindNeighborFaces(size_t vertexIndex) const;
@@ -181,42 +341,51 @@ protected:
     //! Finds all vertices that includes a given vertex.
     virtual std::vector<size_t> FindNeighborVertices(size_t vertexIndex) const;
 
-    //! Return the edge at index i
-    HalfEdge& e(size_t i) { return mEdges.at(i); }
-    const HalfEdge& e(size_t i) const { return mEdges.at(i); }
-    //! Return the face at index i
-    Face& f(size_t i) { return mFaces.at(i); }
-    const Face& f(size_t i) const { return mFaces.at(i); }
-    //! Return the Vertex at index i
-    Vertex& v(size_t i) { return mVerts.at(i); }
-    const Vertex v(size_t i) const { return mVerts.at(i); }
+    //! Origin vertex of half-edge i
+    size_t EdgeVert(size_t i) const { return mConn.Vert(i); }
+    //! Face of half-edge i, Border for boundary half-edges
+    size_t EdgeFace(size_t i) const { return mConn.Face(i); }
+    //! Next half-edge around the face (or boundary loop) of half-edge i
+    size_t EdgeNext(size_t i) const { return mConn.Next(i); }
+    //! Previous half-edge around the face (or boundary loop) of half-edge i
+    size_t EdgePrev(size_t i) const { return mConn.Prev(i); }
+    //! Opposite half-edge of half-edge i
+    size_t EdgePair(size_t i) const { return mConn.Pair(i); }
+    //! One outgoing half-edge of vertex i
+    size_t VertEdge(size_t i) const { return mConn.VertEdge(i); }
+    //! First half-edge of face i
+    size_t FaceEdge(size_t i) const { return mConn.FaceEdge(i); }
+
+    void SetEdgeVert(size_t i, size_t vert) { mConn.SetVert(i, vert); }
+    void SetEdgePair(size_t i, size_t pair) { mConn.SetPair(i, pair); }
+    void SetVertEdge(size_t i, size_t edge) { mConn.SetVertEdge(i, edge); }
+
+    //! Return the position of vertex i
+    glm::vec3& Position(size_t i) { return mPositions.at(i); }
+    const glm::vec3& Position(size_t i) const { return mPositions.at(i); }
     //! Return number of vertices
-    size_t GetNumVerts() const { return mVerts.size(); }
+    size_t GetNumVerts() const { return mPositions.size(); }
     //! Return number of faces
-    size_t GetNumFaces() const { return mFaces.size(); }
+    size_t GetNumFaces() const { return mFaceAttribs.size(); }
     //! Return number of edges
-    size_t GetNumEdges() const { return mEdges.size(); }
+    size_t GetNumEdges() const { return mConn.NumHalfEdges(); }
+    //! Number of edges, counted once each whether or not the boundary is built
+    size_t CountEdges() const;
 
     virtual void Dilate(float amount);
     virtual void Erode(float amount);
     virtual void Smooth(float amount);
 
-    virtual bool save(std::ostream& os) {
-        os << "# HalfEdgeMesh obj streamer\n# M&A 2008\n\n";
-        os << "# Vertices\n";
-        for (size_t i = 0; i < GetNumVerts(); i++) {
-            os << "v " << v(i).pos[0] << " " << v(i).pos[1] << " " << v(i).pos[2] << "\n";
-        }
-        os << "\n# Faces\n";
-        for (size_t i = 0; i < GetNumFaces(); i++) {
-            size_t ind = f(i).edge;
-            os << "f ";
-            os << e(ind).vert + 1 << " ";
-            ind = e(ind).next;
-            os << e(ind).vert + 1 << " ";
-            ind = e(ind).next;
-            os << e(ind).vert + 1 << "\n";
-        }
-        return os.good();
+    virtual bool Save(std::ostream& os, MeshFormat format) override {
+        if (format == MeshFormat::HalfEdge) return SaveBinary(os);
+        return WriteMesh(
+            os, format, "HalfEdgeMesh", mVertAttribs.HasNormals(), mVertAttribs.HasColors(),
+            GetNumVerts(),
+            [this](size_t i) { return GetVertex(i); }, GetNumFaces(),
+            [this](size_t i) {
+                const size_t edge = FaceEdge(i);
+                return glm::uvec3(EdgeVert(edge), EdgeVert(EdgeNext(edge)),
+                                  EdgeVert(EdgePrev(edge)));
+            });
     }
 };
@@ -24,28 +24,30 @@ void Implicit::Update() {
     if (mVisualizationMode == Curvature) {
         if (typeid(*mMesh) == typeid(SimpleMesh)) {
             SimpleMesh* ptr = static_cast<SimpleMesh*>(mMesh);
-            std::vector<SimpleMesh::Vertex>& verts = ptr->GetVerts();
+            const std::vector<glm::vec3>& verts = ptr->GetPositions();
+            std::vector<float>& curvature = ptr->GetVertAttribs().Curvature();
+            std::vector<glm::vec3>& normals = ptr->GetVertAttribs().Normals();
 
             glm::mat4 M = glm::transpose(GetTransform());
 
             // Compute curvature of implicit geometry and assign to the vertex
             // property
             for (size_t i = 0; i < verts.size(); i++) {
-                const glm::vec3 vObject = verts.at(i).pos;
+                const glm::vec3 vObject = verts.at(i);
 
                 // Transform vertex position to world space
                 glm::vec4 vWorld =
                     GetTransform() * glm::vec4(vObject[0], vObject[1], vObject[2], 1);
 
                 // Get curvature in world space
-                verts.at(i).curvature = GetCurvature(vWorld[0], vWorld[1], vWorld[2]);
+                curvature.at(i) = GetCurvature(vWorld[0], vWorld[1], vWorld[2]);
 
                 // Get gradient in world space (used for lighting)
                 glm::vec3 nWorld = GetGradient(vWorld[0], vWorld[1], vWorld[2]);
 
                 // Transform gradient to object space
                 glm::vec4 nObject = M * glm::vec4(nWorld[0], nWorld[1], nWorld[2], 0);
-                verts.at(i).normal = glm::normalize(glm::vec3(nObject[0], nObject[1], nObject[2]));
+                normals.at(i) = glm::normalize(glm::vec3(nObject[0], nObject[1], nObject[2]));
             }
 
             ptr->mAutoMinMax = mAutoMinMax;
@@ -222,7 +224,7 @@ void Implicit::Render() {
     if (mVisualizationMode == Gradients) {
         if (typeid(*mMesh) == typeid(SimpleMesh)) {
             SimpleMesh* ptr = static_cast<SimpleMesh*>(mMesh);
-            const std::vector<SimpleMesh::Vertex>& verts = ptr->GetVerts();
+            const std::vector<glm::vec3>& verts = ptr->GetPositions();
 
             glDisable(GL_LIGHTING);
 
@@ -231,7 +233,7 @@ void Implicit::Render() {
             glColor3f(0, 0, 1);
             glBegin(GL_LINES);
             for (size_t i = 0; i < verts.size(); i++) {
-                const glm::vec3 vObject = verts.at(i).pos;
+                const glm::vec3 vObject = verts.at(i);
 
                 // Transform vertex position to world space
                 glm::vec4 vWorld =
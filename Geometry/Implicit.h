@@ -18,6 +18,7 @@
 #include <Geometry/Geometry.h>
 #include <Geometry/Mesh.h>
 #include <Geometry/SimpleMesh.h>
+#include <Util/HashIndex.h>
 #include <Util/MarchingCubes.h>
 
 /*!  \brief Implicit base class */
@@ -136,6 +137,9 @@ void Implicit::Triangulate() {
     size_t currentSample = 0;
     size_t reportFreq = totalSamples / 30;
 
+    // All triangles are collected first and handed to the mesh in one go
+    std::vector<glm::vec3> soup;
+
     // Loop over bounding box
     std::cerr << "Triangulating [";
     for (float i = pmin[0]; i < pmax[0] - 0.5f * mMeshSampling; i += mMeshSampling) {
@@ -151,16 +155,10 @@ void Implicit::Triangulate() {
                     GetValue(i + mMeshSampling, j + mMeshSampling, k + mMeshSampling),
                     GetValue(i, j + mMeshSampling, k + mMeshSampling)};
                 std::vector<glm::vec3> tris = ::Triangulate(voxelValues, i, j, k, mMeshSampling);
-                for (size_t n = 0; n < tris.size(); n += 3) {
-                    std::vector<glm::vec3> verts;
-                    std::copy(tris.begin() + n, tris.begin() + n + 3, std::back_inserter(verts));
-
+                for (glm::vec3& p : tris) {
                     // Transform to local coordinates
-                    for (size_t v = 0; v < 3; v++) {
-                        TransformW2O(verts[v][0], verts[v][1], verts[v][2]);
-                    }
-
-                    mMesh->AddFace(verts);
+                    TransformW2O(p[0], p[1], p[2]);
+                    soup.push_back(p);
                 }
 
                 currentSample++;
@@ -171,4 +169,14 @@ void Implicit::Triangulate() {
         }
     }
     std::cerr << "] done" << std::endl;
+
+    // Marching cubes emits shared vertices once per triangle, weld them
+    std::vector<glm::uvec3> indices(soup.size() / 3);
+    for (size_t t = 0; t < indices.size(); t++) {
+        indices[t] = glm::uvec3(3 * t, 3 * t + 1, 3 * t + 2);
+    }
+    WeldVertices(soup, indices);
+    if (!mMesh->Build(soup, indices)) {
+        mMesh->Mesh::Build(soup.data(), soup.size(), indices.data(), indices.size());
+    }
 }
@@ -11,12 +11,12 @@ ImplicitMesh::ImplicitMesh(SimpleMesh* mesh) : mSourceMesh(mesh), mData(NULL) {
                    std::numeric_limits<float>::max());
     glm::vec3 pMax(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
                    -std::numeric_limits<float>::max());
-    const std::vector<SimpleMesh::Vertex>& verts = mSourceMesh->GetVerts();
+    const std::vector<glm::vec3>& verts = mSourceMesh->GetPositions();
     for (size_t i = 0; i < verts.size(); i++) {
-        const SimpleMesh::Vertex& v = verts.at(i);
+        const glm::vec3& v = verts.at(i);
         for (int j = 0; j < 3; j++) {
-            if (pMin[j] > v.pos[j]) pMin[j] = v.pos[j];
-            if (pMax[j] < v.pos[j]) pMax[j] = v.pos[j];
+            if (pMin[j] > v[j]) pMin[j] = v[j];
+            if (pMax[j] < v[j]) pMax[j] = v[j];
         }
     }
 
@@ -107,15 +107,15 @@ float ImplicitMesh::DistanceToPoint(float x, float y, float z, const SimpleMesh&
     // just loop over all faces and take the min distance.
     // uses normals to determine direction and resulting sign (negative inside)
     std::pair<float, bool> pr((std::numeric_limits<float>::max)(), true);
-    const std::vector<SimpleMesh::Vertex>& verts = mesh.GetVerts();
+    const std::vector<glm::vec3>& verts = mesh.GetPositions();
     const std::vector<SimpleMesh::Face>& faces = mesh.GetFaces();
     glm::vec3 p(x, y, z);
     for (size_t i = 0; i < faces.size(); i++) {
-        const SimpleMesh::Vertex& v1 = verts.at(faces.at(i).v1);
-        const SimpleMesh::Vertex& v2 = verts.at(faces.at(i).v2);
-        const SimpleMesh::Vertex& v3 = verts.at(faces.at(i).v3);
+        const glm::vec3& v1 = verts.at(faces.at(i).v1);
+        const glm::vec3& v2 = verts.at(faces.at(i).v2);
+        const glm::vec3& v3 = verts.at(faces.at(i).v3);
 
-        std::pair<float, bool> pt = DistanceSquared(p, v1.pos, v2.pos, v3.pos);
+        std::pair<float, bool> pt = DistanceSquared(p, v1, v2, v3);
         if (pt.first < pr.first) pr = pt;
     }
     pr.first = std::sqrt(pr.first);
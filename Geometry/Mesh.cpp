@@ -13,11 +13,30 @@
  *
  *************************************************************************************************/
 #include <Geometry/Mesh.h>
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 const Mesh::VisualizationMode Mesh::CurvatureVertex = NewVisualizationMode("Vertex curvature");
 const Mesh::VisualizationMode Mesh::CurvatureFace = NewVisualizationMode("Face curvature");
 
+bool Mesh::Build(const glm::vec3* verts, size_t numVerts, const glm::uvec3* tris,
+                 size_t numTris) {
+    std::vector<glm::vec3> face(3);
+    for (size_t t = 0; t < numTris; t++) {
+        for (int k = 0; k < 3; k++) {
+            if (tris[t][k] >= numVerts) {
+                std::cerr << "Error: triangle " << t << " refers to missing vertex " << tris[t][k]
+                          << std::endl;
+                return false;
+            }
+            face[k] = verts[tris[t][k]];
+        }
+        AddFace(face);
+    }
+    return true;
+}
+
 float Mesh::Area() const {
     std::cerr << "Error: area() not implemented for this Mesh" << std::endl;
     return -1;
@@ -32,3 +51,99 @@ size_t Mesh::Genus() const {
     std::cerr << "Error: genus() not implemented for this Mesh" << std::endl;
     return -1;
 }
+
+void Mesh::CopyVertexAttributes(AttributeStreams& verts, const glm::vec3* normals,
+                                const glm::vec3* colors) {
+    if (normals) std::copy(normals, normals + verts.size(), verts.Normals().begin());
+    if (colors) std::copy(colors, colors + verts.size(), verts.Colors().begin());
+}
+
+void Mesh::MapCurvatureColors(AttributeStreams& verts, AttributeStreams& faces) {
+    if (!mColorMap) {
+        return;
+    }
+    if (mVisualizationMode == CurvatureVertex) {
+        MapCurvatureColors(verts, "vertex");
+    } else if (mVisualizationMode == CurvatureFace) {
+        MapCurvatureColors(faces, "face");
+    }
+    mColorsDirty = false;
+}
+
+void Mesh::MapCurvatureColors(AttributeStreams& verts, const std::vector<size_t>& changedVerts,
+                              const std::vector<float>& oldVertCurvature, AttributeStreams& faces,
+                              const std::vector<size_t>& changedFaces,
+                              const std::vector<float>& oldFaceCurvature) {
+    if (mColorsDirty) {
+        MapCurvatureColors(verts, faces);
+    } else if (!mColorMap) {
+        return;
+    } else if (mVisualizationMode == CurvatureVertex) {
+        MapCurvatureColors(verts, changedVerts, oldVertCurvature, "vertex");
+    } else if (mVisualizationMode == CurvatureFace) {
+        MapCurvatureColors(faces, changedFaces, oldFaceCurvature, "face");
+    }
+}
+
+void Mesh::MapCurvatureColors(AttributeStreams& elems, const std::vector<size_t>& changed,
+                              const std::vector<float>& oldCurvature, const char* name) {
+    const std::vector<float>& curvature = elems.Curvature();
+    std::vector<glm::vec3>& colors = elems.Colors();
+    if (mAutoMinMax) {
+        float minCurvature = mMinCMap, maxCurvature = mMaxCMap;
+        for (size_t k = 0; k < changed.size(); k++) {
+            const float c = curvature[changed[k]];
+            const float old = oldCurvature[k];
+            if (c != old && (old == mMinCMap || old == mMaxCMap)) {
+                MapCurvatureColors(elems, name);
+                return;
+            }
+            if (minCurvature > c) minCurvature = c;
+            if (maxCurvature < c) maxCurvature = c;
+        }
+        if (minCurvature != mMinCMap || maxCurvature != mMaxCMap) {
+            mMinCMap = minCurvature;
+            mMaxCMap = maxCurvature;
+            ParallelFor(0, elems.size(), [&](size_t i) {
+                colors[i] = mColorMap->Map(curvature[i], minCurvature, maxCurvature);
+            });
+            return;
+        }
+    }
+    for (size_t i : changed) {
+        colors[i] = mColorMap->Map(curvature[i], mMinCMap, mMaxCMap);
+    }
+}
+
+void Mesh::MapCurvatureColors(AttributeStreams& elems, const char* name) {
+    const std::vector<float>& curvature = elems.Curvature();
+    std::vector<glm::vec3>& colors = elems.Colors();
+    if (!mAutoMinMax) {
+        std::cerr << "Mapping color based on " << name << " curvature with range [" << mMinCMap
+                  << "," << mMaxCMap << "]" << std::endl;
+    } else {
+        typedef std::pair<float, float> Range;
+        const Range range = ParallelReduce(
+            0, elems.size(),
+            Range(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max()),
+            [&curvature](size_t b, size_t e) {
+                Range r(std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+                for (size_t i = b; i < e; i++) {
+                    if (r.first > curvature[i]) r.first = curvature[i];
+                    if (r.second < curvature[i]) r.second = curvature[i];
+                }
+                return r;
+            },
+            [](const Range& a, const Range& b) {
+                return Range(std::min(a.first, b.first), std::max(a.second, b.second));
+            });
+        std::cerr << "Automatic mapping of color based on " << name << " curvature with range ["
+                  << range.first << "," << range.second << "]" << std::endl;
+        mMinCMap = range.first;
+        mMaxCMap = range.second;
+    }
+    const float minCurvature = mMinCMap, maxCurvature = mMaxCMap;
+    ParallelFor(0, elems.size(), [&](size_t i) {
+        colors[i] = mColorMap->Map(curvature[i], minCurvature, maxCurvature);
+    });
+}
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <limits>
+#include <utility>
 #include <vector>
+#include <Geometry/AttributeStreams.h>
 #include <Geometry/Geometry.h>
+#include <Util/ColorMap.h>
+#include <Util/MeshWriter.h>
+#include <Util/ThreadPool.h>
 
 class Mesh : public Geometry {
 public:
@@ -15,7 +21,11 @@ public:
         return L;
     }
 
-    virtual bool save(std::ostream& os) = 0;
+    //! Writes the mesh as an obj file
+    virtual bool save(std::ostream& os) { return Save(os, MeshFormat::Obj); }
+
+    //! Writes the mesh in the given format
+    virtual bool Save(std::ostream& os, MeshFormat format) = 0;
 
 protected:
     //! Adds a vertex to the mesh
@@ -43,21 +53,53 @@ protected:
 
     bool mVisualizeNormals;
 
+    //! Set when the color map or visualization mode changed since colors were last mapped
+    bool mColorsDirty;
+
+    //! Copies the normals and colors that are not NULL into the vertex streams
+    static void CopyVertexAttributes(AttributeStreams& verts, const glm::vec3* normals,
+                                     const glm::vec3* colors);
+
+    //! True if the visualization mode shows the curvature, which then has to be kept
+    bool VisualizesCurvature() const {
+        return mVisualizationMode == CurvatureVertex || mVisualizationMode == CurvatureFace;
+    }
+
+    /*! Colors the vertices or the faces, depending on the visualization
+     * mode, by their curvature. With automatic range the min/max is found
+     * by a parallel reduction and stored in mMinCMap/mMaxCMap. The color
+     * stream is only allocated if there is something to color.
+     */
+    void MapCurvatureColors(AttributeStreams& verts, AttributeStreams& faces);
+
+    /*! Recolors after only some vertices and faces got a new curvature.
+     * The changed lists hold their indices and the old lists their
+     * curvature before the change. Falls back to MapCurvatureColors over
+     * all elements if the color settings changed in between.
+     */
+    void MapCurvatureColors(AttributeStreams& verts, const std::vector<size_t>& changedVerts,
+                            const std::vector<float>& oldVertCurvature, AttributeStreams& faces,
+                            const std::vector<size_t>& changedFaces,
+                            const std::vector<float>& oldFaceCurvature);
+
+    /*! An automatic range is widened by the new values. It only has to be
+     * reduced over all elements again if an element that was on the old
+     * min or max changed. Everything is recolored when the range moved,
+     * otherwise only the changed elements.
+     */
+    void MapCurvatureColors(AttributeStreams& elems, const std::vector<size_t>& changed,
+                            const std::vector<float>& oldCurvature, const char* name);
+
+    void MapCurvatureColors(AttributeStreams& elems, const char* name);
+
 public:
-    //! Minimal requirements for all meshes, inherited
-    struct Face {
-        Face(const glm::vec3& n = glm::vec3(0.f, 0.f, 0.f),
-             const glm::vec3& c = glm::vec3(0.5f, 0.1f, 0.7f), float u = 0)
-            : normal(n), color(c), curvature(u) {}
-        glm::vec3 normal;
-        glm::vec3 color;
-        float curvature;
-    };
-    //! Minimal requirements for all meshes, inherited
+    /*! All attributes of one vertex. Meshes keep them in separate streams,
+     * this only hands a whole vertex around, e.g. to the file writers.
+     */
     struct Vertex {
         Vertex(const glm::vec3& p = glm::vec3(0.f, 0.f, 0.f),
                const glm::vec3& n = glm::vec3(0.f, 0.f, 0.f),
-               const glm::vec3& c = glm::vec3(0.5f, 0.1f, 0.7f), float u = 0)
+               const glm::vec3& c = AttributeStreams::DefaultColor(), float u = 0)
             : pos(p), normal(n), color(c), curvature(u) {}
         glm::vec3 pos;
         glm::vec3 normal;
@@ -65,12 +107,29 @@ public:
         float curvature;
     };
 
-    Mesh() : mVisualizeNormals(false) { mVisualizationMode = CurvatureFace; }
+    Mesh() : mVisualizeNormals(false), mColorsDirty(true) { mVisualizationMode = CurvatureFace; }
     virtual ~Mesh() {}
 
     //! Adds a face to the mesh.
     virtual bool AddFace(const std::vector<glm::vec3>& verts) = 0;
 
+    /*! Builds the mesh from an indexed triangle list. Vertices are assumed to
+     * be unique already, no welding is done. Meshes without a bulk path fall
+     * back to adding the triangles one by one through AddFace.
+     */
+    virtual bool Build(const glm::vec3* verts, size_t numVerts, const glm::uvec3* tris,
+                       size_t numTris);
+
+    bool Build(const std::vector<glm::vec3>& verts, const std::vector<glm::uvec3>& tris) {
+        return Build(verts.data(), verts.size(), tris.data(), tris.size());
+    }
+
+    /*! Sets the normals and colors of the vertices given to the last Build,
+     * e.g. when they were read from a file. Either may be NULL. Meshes that
+     * don't keep them per vertex ignore them.
+     */
+    virtual void SetVertexAttributes(const glm::vec3* normals, const glm::vec3* colors) {}
+
     //! Compute area of mesh
     virtual float Area() const;
     //! Compute volume of mesh
@@ -83,6 +142,7 @@ public:
 
     virtual void SetColorMap(ColorMap* colormap) {
         GLObject::SetColorMap(colormap);
+        mColorsDirty = true;
         Update();
     }
 
@@ -90,6 +150,7 @@ public:
 
     virtual void SetVisualizationMode(const VisualizationMode& mode) {
         GLObject::SetVisualizationMode(mode);
+        mColorsDirty = true;
         Update();
     }
 
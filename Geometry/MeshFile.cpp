@@ -0,0 +1,111 @@
+#include <Geometry/MeshFile.h>
+#include <Util/ThreadPool.h>
+#include <Util/Util.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const char Magic[8] = {'M', 'O', 'A', 'H', 'E', 'M', 0, 0};
+
+// Multipliers of the xxHash64 round
+const uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+const uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+
+inline uint64_t HashRound(uint64_t h, uint64_t word) {
+    h += word * Prime2;
+    h = (h << 31) | (h >> 33);
+    return h * Prime1;
+}
+
+// Reads 8 bytes as a little endian word
+inline uint64_t ReadWord(const char* p) {
+    if (IsBigEndian()) {
+        // half[0] holds the low word on disk
+        uint32_t half[2];
+        std::memcpy(half, p, 8);
+        return (uint64_t(EndianSwap(half[1])) << 32) | EndianSwap(half[0]);
+    }
+    uint64_t word;
+    std::memcpy(&word, p, 8);
+    return word;
+}
+
+inline size_t Align(size_t offset) {
+    return (offset + MeshFileLayout::Alignment - 1) / MeshFileLayout::Alignment *
+           MeshFileLayout::Alignment;
+}
+}  // namespace
+
+MeshFileHeader MeshFileHeader::Make(size_t numVerts, size_t numFaces, size_t numHalfEdges,
+                                    uint32_t flags) {
+    MeshFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.flags = flags;
+    header.indexSize = sizeof(uint32_t);
+    header.numVerts = static_cast<uint32_t>(numVerts);
+    header.numFaces = static_cast<uint32_t>(numFaces);
+    header.numHalfEdges = static_cast<uint32_t>(numHalfEdges);
+    return header;
+}
+
+bool MeshFileHeader::IsSupported() const {
+    return std::memcmp(magic, Magic, sizeof(Magic)) == 0 && version == Version &&
+           indexSize == sizeof(uint32_t);
+}
+
+void MeshFileHeader::SwapToHost() {
+    if (!IsBigEndian()) return;
+    // Everything after the magic is 32 bit words
+    EndianSwap(&version, (sizeof(MeshFileHeader) - sizeof(magic)) / sizeof(uint32_t));
+}
+
+MeshFileLayout::MeshFileLayout(const MeshFileHeader& header) {
+    const size_t numVerts = header.numVerts, numFaces = header.numFaces;
+    const size_t numHalfEdges = header.numHalfEdges;
+    const size_t numBoundary = numHalfEdges - std::min<size_t>(numHalfEdges, 3 * numFaces);
+    const bool attributes = (header.flags & MeshFileHeader::HasAttributes) != 0;
+
+    mCount[Positions] = 3 * numVerts;
+    mCount[EdgeVerts] = numHalfEdges;
+    mCount[EdgePairs] = numHalfEdges;
+    mCount[VertEdges] = numVerts;
+    mCount[BoundaryNext] = numBoundary;
+    mCount[BoundaryPrev] = numBoundary;
+    mCount[VertNormals] = attributes ? 3 * numVerts : 0;
+    mCount[VertCurvature] = attributes ? numVerts : 0;
+    mCount[FaceNormals] = attributes ? 3 * numFaces : 0;
+    mCount[FaceCurvature] = attributes ? numFaces : 0;
+
+    mOffset[0] = sizeof(MeshFileHeader);
+    for (size_t s = 0; s < NumSections; s++) {
+        mOffset[s + 1] = Align(mOffset[s] + 4 * mCount[s]);
+    }
+}
+
+/*!
+ * Every block of 1 MB is hashed with the xxHash64 round, one 8 byte word
+ * at a time, and the block hashes are fed through the same round in file
+ * order. Not a cryptographic hash, it catches truncated and corrupted
+ * files.
+ */
+uint64_t MeshFileChecksum(const char* data, size_t size) {
+    const size_t numWords = size / 8;
+    uint64_t h = ParallelReduce(
+        0, numWords, Prime1 ^ size,
+        [data](size_t b, size_t e) {
+            uint64_t block = Prime2 ^ b;
+            for (size_t i = b; i < e; i++) block = HashRound(block, ReadWord(data + 8 * i));
+            return block;
+        },
+        HashRound, size_t(1) << 17);
+
+    // Final mix so that every input bit affects every output bit
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime1;
+    h ^= h >> 32;
+    return h;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*! \brief Header of the native binary half-edge mesh file (.hem).
+ *
+ * The file is the 64 byte header followed by the sections listed in
+ * MeshFileLayout, each starting on a 64 byte boundary and padded with
+ * zeros. All numbers are little endian 32 bit values, so the sections can
+ * be copied straight out of a memory mapping into the mesh arrays. The
+ * checksum covers everything after the header.
+ */
+struct MeshFileHeader {
+    //! Current version of the layout, files of other versions are refused
+    static constexpr uint32_t Version = 1;
+    //! flags bit set when the vertex and face attributes are stored
+    static constexpr uint32_t HasAttributes = 1;
+
+    char magic[8];  //!< "MOAHEM" padded with zeros
+    uint32_t version;
+    uint32_t flags;
+    //! Size in bytes of a connectivity index
+    uint32_t indexSize;
+    uint32_t numVerts;
+    uint32_t numFaces;
+    //! Inner half-edges (three per face) followed by the boundary ones
+    uint32_t numHalfEdges;
+    //! Low and high word of MeshFileChecksum over the sections
+    uint32_t checksum[2];
+    uint32_t reserved[6];
+
+    //! Header for a mesh of the given size, checksum left at zero
+    static MeshFileHeader Make(size_t numVerts, size_t numFaces, size_t numHalfEdges,
+                               uint32_t flags);
+
+    //! True if magic, version and index size are the ones this code writes
+    bool IsSupported() const;
+
+    uint64_t Checksum() const { return checksum[0] | (uint64_t(checksum[1]) << 32); }
+    void SetChecksum(uint64_t sum) {
+        checksum[0] = static_cast<uint32_t>(sum);
+        checksum[1] = static_cast<uint32_t>(sum >> 32);
+    }
+
+    //! Converts between file (little endian) and host byte order
+    void SwapToHost();
+};
+static_assert(sizeof(MeshFileHeader) == 64, "MeshFileHeader must stay 64 bytes");
+
+//! Where the sections of a mesh file start, as byte offsets from the file start
+struct MeshFileLayout {
+    //! Boundary every section starts on
+    static constexpr size_t Alignment = 64;
+
+    enum Section {
+        Positions,      //!< float x, y, z per vertex
+        EdgeVerts,      //!< origin vertex per half-edge
+        EdgePairs,      //!< opposite half-edge per half-edge
+        VertEdges,      //!< outgoing half-edge per vertex
+        BoundaryNext,   //!< next per boundary half-edge
+        BoundaryPrev,   //!< prev per boundary half-edge
+        VertNormals,    //!< float x, y, z per vertex, if HasAttributes
+        VertCurvature,  //!< float per vertex, if HasAttributes
+        FaceNormals,    //!< float x, y, z per face, if HasAttributes
+        FaceCurvature,  //!< float per face, if HasAttributes
+        NumSections
+    };
+
+    explicit MeshFileLayout(const MeshFileHeader& header);
+
+    //! Start of section s, the end is the start of the next one
+    size_t Offset(Section s) const { return mOffset[s]; }
+    //! Number of 32 bit values in section s
+    size_t Count(Section s) const { return mCount[s]; }
+    //! Total size of the file
+    size_t FileSize() const { return mOffset[NumSections]; }
+
+protected:
+    size_t mOffset[NumSections + 1];
+    size_t mCount[NumSections];
+};
+
+/*! 64 bit checksum of size bytes, size a multiple of 8. The data is
+ * hashed in independent blocks in parallel and the block hashes are
+ * combined in order, so the result does not depend on the thread count.
+ */
+uint64_t MeshFileChecksum(const char* data, size_t size);
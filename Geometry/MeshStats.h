@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <glm.hpp>
+
+/*! \brief Sum of doubles with Neumaier's compensation.
+ * The rounding error of every addition is collected separately, so adding
+ * millions of small terms (triangle areas, volume contributions) to a large
+ * total does not lose their low bits. Partial sums from several threads
+ * are merged with +=.
+ */
+struct CompensatedSum {
+    CompensatedSum() : sum(0), compensation(0) {}
+
+    void Add(double x) {
+        const double t = sum + x;
+        if (std::abs(sum) >= std::abs(x)) {
+            compensation += (sum - t) + x;
+        } else {
+            compensation += (x - t) + sum;
+        }
+        sum = t;
+    }
+
+    CompensatedSum& operator+=(const CompensatedSum& s) {
+        Add(s.sum);
+        Add(s.compensation);
+        return *this;
+    }
+
+    double Value() const { return sum + compensation; }
+
+    double sum;
+    double compensation;
+};
+
+/*! \brief Global measures of a mesh, gathered together by ComputeStats.
+ * Curvature ranges are taken from the stored vertex and face curvature,
+ * they are only meaningful after an Update and are left empty if the mesh
+ * does not keep its curvature.
+ */
+struct MeshStats {
+    MeshStats()
+        : area(0),
+          volume(0),
+          boundsMin((std::numeric_limits<float>::max)()),
+          boundsMax(-(std::numeric_limits<float>::max)()),
+          eulerCharacteristic(0),
+          shells(0),
+          minVertexCurvature((std::numeric_limits<float>::max)()),
+          maxVertexCurvature(-(std::numeric_limits<float>::max)()),
+          minFaceCurvature((std::numeric_limits<float>::max)()),
+          maxFaceCurvature(-(std::numeric_limits<float>::max)()) {}
+
+    //! Surface area
+    double area;
+    //! Signed volume, positive when the faces are oriented outwards
+    double volume;
+    //! Axis aligned bounding box of the vertices
+    glm::vec3 boundsMin, boundsMax;
+    //! V - E + F
+    long eulerCharacteristic;
+    //! Number of connected components
+    size_t shells;
+    float minVertexCurvature, maxVertexCurvature;
+    float minFaceCurvature, maxFaceCurvature;
+
+    //! Genus of a closed mesh, from the Euler characteristic of each shell
+    size_t Genus() const { return (2 * static_cast<long>(shells) - eulerCharacteristic) / 2; }
+};
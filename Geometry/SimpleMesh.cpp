@@ -14,11 +14,12 @@
  *************************************************************************************************/
 #include <Geometry/SimpleMesh.h>
 #include <Util/ColorMap.h>
+#include <Util/ThreadPool.h>
 #include <glm.hpp>
 #include <gtc/type_ptr.hpp>
 
 //-----------------------------------------------------------------------------
-SimpleMesh::SimpleMesh() {}
+SimpleMesh::SimpleMesh() : mAdjacencyValid(false) {}
 
 //-----------------------------------------------------------------------------
 SimpleMesh::~SimpleMesh() {}
@@ -31,25 +32,92 @@ bool SimpleMesh::AddFace(const std::vector<glm::vec3>& verts) {
 
     Face tri(ind1, ind2, ind3);
     mFaces.push_back(tri);
+    mFaceAttribs.resize(mFaces.size());
+    mAdjacencyValid = false;
     // Compute and assign a normal
-    mFaces.back().normal = FaceNormal(mFaces.size() - 1);
+    mFaceAttribs.Normals().back() = FaceNormal(mFaces.size() - 1);
 
     return true;
 }
 
+//-----------------------------------------------------------------------------
+bool SimpleMesh::Build(const glm::vec3* verts, size_t numVerts, const glm::uvec3* tris,
+                       size_t numTris) {
+    mPositions.clear();
+    mFaces.clear();
+    mVertAttribs.clear();
+    mFaceAttribs.clear();
+    mAdjacencyValid = false;
+    ReleaseBuildIndex();
+
+    for (size_t t = 0; t < numTris; t++) {
+        if (tris[t][0] >= numVerts || tris[t][1] >= numVerts || tris[t][2] >= numVerts) {
+            std::cerr << "Error: triangle " << t << " refers to a missing vertex" << std::endl;
+            return false;
+        }
+    }
+
+    mPositions.assign(verts, verts + numVerts);
+    mVertAttribs.resize(numVerts);
+
+    mFaces.reserve(numTris);
+    for (size_t t = 0; t < numTris; t++) {
+        mFaces.push_back(Face(tris[t][0], tris[t][1], tris[t][2]));
+    }
+    mFaceAttribs.resize(numTris);
+    std::vector<glm::vec3>& faceNormals = mFaceAttribs.Normals();
+    ParallelFor(0, numTris, [&](size_t t) { faceNormals[t] = FaceNormal(t); });
+
+    UpdateAdjacency();
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void SimpleMesh::UpdateAdjacency() const {
+    if (mAdjacencyValid && mVertFaceStart.size() == mPositions.size() + 1) {
+        return;
+    }
+
+    // Count the faces of each vertex, then turn the counts into offsets
+    mVertFaceStart.assign(mPositions.size() + 1, 0);
+    for (const Face& face : mFaces) {
+        mVertFaceStart[face.v1 + 1]++;
+        mVertFaceStart[face.v2 + 1]++;
+        mVertFaceStart[face.v3 + 1]++;
+    }
+    for (size_t i = 0; i < mPositions.size(); i++) {
+        mVertFaceStart[i + 1] += mVertFaceStart[i];
+    }
+
+    // Fill in the face indices, each list ends up sorted by face index
+    std::vector<size_t> fill(mVertFaceStart.begin(), mVertFaceStart.end() - 1);
+    mVertFaces.resize(3 * mFaces.size());
+    for (size_t i = 0; i < mFaces.size(); i++) {
+        mVertFaces[fill[mFaces[i].v1]++] = i;
+        mVertFaces[fill[mFaces[i].v2]++] = i;
+        mVertFaces[fill[mFaces[i].v3]++] = i;
+    }
+    mAdjacencyValid = true;
+}
+
 //-----------------------------------------------------------------------------
 size_t SimpleMesh::AddVertex(const glm::vec3& v) {
-    std::map<glm::vec3, size_t>::iterator it = mUniqueVerts.find(v);
-    if (it != mUniqueVerts.end()) {
-        const auto indx = it->second;
-        return indx;
+    if (mUniqueVerts.empty() && !mPositions.empty()) {
+        mUniqueVerts.reserve(mPositions.size());
+        for (size_t i = 0; i < mPositions.size(); i++) {
+            mUniqueVerts.insert(MakeVertexKey(mPositions[i]), i);
+        }
+    }
+
+    const auto indx = mPositions.size();
+    std::pair<size_t, bool> found = mUniqueVerts.insert(MakeVertexKey(v), indx);
+    if (!found.second) {
+        return found.first;
     }
 
-    const auto indx = mVerts.size();
-    mUniqueVerts[v] = indx;  // op. [ ] constructs a new entry in map
-    Vertex vert;
-    vert.pos = v;
-    mVerts.push_back(vert);
+    mPositions.push_back(v);
+    mVertAttribs.resize(mPositions.size());
 
     return indx;
 }
@@ -57,21 +125,17 @@ size_t SimpleMesh::AddVertex(const glm::vec3& v) {
 //-----------------------------------------------------------------------------
 glm::vec3 SimpleMesh::FaceNormal(size_t faceIndex) const {
     const Face& tri = mFaces.at(faceIndex);
-    glm::vec3 e1 = mVerts.at(tri.v2).pos - mVerts.at(tri.v1).pos;
-    glm::vec3 e2 = mVerts.at(tri.v3).pos - mVerts.at(tri.v1).pos;
+    glm::vec3 e1 = mPositions.at(tri.v2) - mPositions.at(tri.v1);
+    glm::vec3 e2 = mPositions.at(tri.v3) - mPositions.at(tri.v1);
     return glm::normalize(glm::cross(e1, e2));
 }
 //-----------------------------------------------------------------------------
 glm::vec3 SimpleMesh::VertexNormal(size_t vertexIndex) const {
-    std::vector<size_t> neighborFaces = FindNeighborFaces(vertexIndex);
-
     glm::vec3 n(0.f, 0.f, 0.f);
 
-    for (size_t i = 0; i < neighborFaces.size(); i++) {
-        const Face& triangle = mFaces.at(neighborFaces.at(i));
-
+    for (size_t face : FacesAroundVertex(vertexIndex)) {
         // NB Assumes face normals already calculated
-        n += triangle.normal;
+        n += mFaceAttribs.Normal(face);
     }
     n = glm::normalize(n);
     return n;
@@ -79,26 +143,23 @@ glm::vec3 SimpleMesh::VertexNormal(size_t vertexIndex) const {
 //-----------------------------------------------------------------------------
 float SimpleMesh::VertexCurvature(size_t vertexIndex) const {
 
-    std::vector<size_t> oneRing = FindNeighborVertices(vertexIndex);
-    assert(oneRing.size() != 0);
+    assert(!FacesAroundVertex(vertexIndex).empty());
 
-    size_t curr, next;
-    const glm::vec3& vi = mVerts.at(vertexIndex).pos;
+    const glm::vec3& vi = mPositions.at(vertexIndex);
     float angleSum = 0.f;
     float area = 0.f;
-    for (size_t i = 0; i < oneRing.size(); i++) {
-        // connections
-        curr = oneRing.at(i);
-        if (i < oneRing.size() - 1) {
-            next = oneRing.at(i + 1);
-        } else {
-            next = oneRing.front();
-        }
+    for (size_t face : FacesAroundVertex(vertexIndex)) {
+        // Consecutive one-ring vertices are the other two corners of a face,
+        // in counter clockwise order after vi
+        const Face& tri = mFaces[face];
+        const size_t curr =
+            tri.v1 == vertexIndex ? tri.v2 : (tri.v2 == vertexIndex ? tri.v3 : tri.v1);
+        const size_t next = tri.v1 == curr ? tri.v2 : (tri.v2 == curr ? tri.v3 : tri.v1);
 
         // find vertices in 1-ring according to figure 5 in lab text
         // next - beta
-        const glm::vec3& nextPos = mVerts.at(next).pos;
-        const glm::vec3& vj = mVerts.at(curr).pos;
+        const glm::vec3& nextPos = mPositions.at(next);
+        const glm::vec3& vj = mPositions.at(curr);
 
         // compute angle and area
         angleSum += acos(glm::dot(vj - vi, nextPos - vi) /
@@ -111,8 +172,8 @@ float SimpleMesh::VertexCurvature(size_t vertexIndex) const {
 float SimpleMesh::FaceCurvature(size_t faceIndex) const {
     // NB Assumes vertex curvature already computed
     const Face& tri = mFaces.at(faceIndex);
-    return (mVerts.at(tri.v1).curvature + mVerts.at(tri.v2).curvature +
-            mVerts.at(tri.v3).curvature) /
+    return (mVertAttribs.Curvature(tri.v1) + mVertAttribs.Curvature(tri.v2) +
+            mVertAttribs.Curvature(tri.v3)) /
            3.f;
 }
 
@@ -159,11 +220,8 @@ std::vector<size_t> SimpleMesh::FindNeighborFaces(size_t vertexIndex) const {
     std::vector<size_t> foundFaces;
 
     // Find other triangles that include this vertex
-    for (size_t i = 0; i < mFaces.size(); ++i) {
-        const Face& face = mFaces[i];
-        if (face.v1 == vertexIndex || face.v2 == vertexIndex || face.v3 == vertexIndex) {
-            foundFaces.push_back(i);
-        }
+    for (size_t face : FacesAroundVertex(vertexIndex)) {
+        foundFaces.push_back(face);
     }
 
     // Pick prev vertex
@@ -209,80 +267,47 @@ std::vector<size_t> SimpleMesh::FindNeighborFaces(size_t vertexIndex) const {
 
 //-----------------------------------------------------------------------------
 void SimpleMesh::Initialize() {
-    // Calculate and store all differentials and area
+    // The mesh is complete, the lookup table is only needed if faces are added later
+    ReleaseBuildIndex();
+    UpdateAdjacency();
+
+    // Calculate and store all differentials and area, in parallel since
+    // every pass only writes its own element
 
     // First update all face normals and triangle areas
-    for (size_t i = 0; i < mFaces.size(); i++) {
-        mFaces.at(i).normal = FaceNormal(i);
-    }
-    // Then update all vertex normals and curvature
-    for (size_t i = 0; i < mVerts.size(); i++) {
+    std::vector<glm::vec3>& faceNormals = mFaceAttribs.Normals();
+    ParallelFor(0, mFaces.size(), [&](size_t i) { faceNormals[i] = FaceNormal(i); });
+
+    // Then update all vertex normals
+    std::vector<glm::vec3>& vertNormals = mVertAttribs.Normals();
+    ParallelFor(0, mPositions.size(), [&](size_t i) {
         // Vertex normals are just weighted averages
-        mVerts.at(i).normal = VertexNormal(i);
-    }
+        vertNormals[i] = VertexNormal(i);
+    });
 
-    // Then update vertex curvature
-    for (size_t i = 0; i < mVerts.size(); i++) {
-        mVerts.at(i).curvature = VertexCurvature(i);
-        // std::cerr <<   mVerts.at(i).curvature << "\n";
-    }
+    // The curvature only if it is shown or kept, otherwise Update computes it on demand
+    if (VisualizesCurvature() || mVertAttribs.HasCurvature()) UpdateCurvature();
+}
 
-    // Finally update face curvature
-    for (size_t i = 0; i < mFaces.size(); i++) {
-        mFaces.at(i).curvature = FaceCurvature(i);
-    }
+void SimpleMesh::UpdateCurvature() {
+    // Faces may have been added since Initialize, rebuild before the workers circulate
+    UpdateAdjacency();
+
+    // Vertex curvature first, the face curvature averages it
+    std::vector<float>& vertCurvature = mVertAttribs.Curvature();
+    ParallelFor(0, mPositions.size(), [&](size_t i) { vertCurvature[i] = VertexCurvature(i); });
+
+    std::vector<float>& faceCurvature = mFaceAttribs.Curvature();
+    ParallelFor(0, mFaces.size(), [&](size_t i) { faceCurvature[i] = FaceCurvature(i); });
 }
 
 //-----------------------------------------------------------------------------
 void SimpleMesh::Update() {
-    if (!mColorMap) { return; }
+    // The curvature may not have been kept before it was visualized
+    if (VisualizesCurvature() && !mVertAttribs.HasCurvature()) UpdateCurvature();
 
     // Update vertex and face colors
-    float minCurvature = std::numeric_limits<float>::max();
-    float maxCurvature = -std::numeric_limits<float>::max();
-
-    if (!mAutoMinMax) {
-        minCurvature = mMinCMap;
-        maxCurvature = mMaxCMap;
-    }
-
-    if (mVisualizationMode == CurvatureVertex) {
-        if (!mAutoMinMax) {
-            std::cerr << "Mapping color based on vertex curvature with range [" << mMinCMap << ","
-                      << mMaxCMap << "]" << std::endl;
-        } else {
-            // Compute range from vertices
-            for (auto& vert : mVerts) {
-                if (minCurvature > vert.curvature) minCurvature = vert.curvature;
-                if (maxCurvature < vert.curvature) maxCurvature = vert.curvature;
-            }
-            std::cerr << "Automatic mapping of color based on vertex curvature with range ["
-                      << minCurvature << "," << maxCurvature << "]" << std::endl;
-            mMinCMap = minCurvature;
-            mMaxCMap = maxCurvature;
-        }
-        for (auto& vert : mVerts) {
-            vert.color = mColorMap->Map(vert.curvature, minCurvature, maxCurvature);
-        }
-    } else if (mVisualizationMode == CurvatureFace) {
-        if (!mAutoMinMax) {
-            std::cerr << "Mapping color based on face curvature with range [" << mMinCMap << ","
-                      << mMaxCMap << "]" << std::endl;
-        } else {
-            // Compute range from faces
-            for (auto& face : mFaces) {
-                if (minCurvature > face.curvature) minCurvature = face.curvature;
-                if (maxCurvature < face.curvature) maxCurvature = face.curvature;
-            }
-            std::cerr << "Automatic mapping of color based on face curvature with range ["
-                      << minCurvature << "," << maxCurvature << "]" << std::endl;
-            mMinCMap = minCurvature;
-            mMaxCMap = maxCurvature;
-        }
-        for (auto& face : mFaces) {
-            face.color = mColorMap->Map(face.curvature, minCurvature, maxCurvature);
-        }
-    }
+    MapCurvatureColors(mVertAttribs, mFaceAttribs);
 }
 
 size_t SimpleMesh::Genus() const {
@@ -293,7 +318,7 @@ size_t SimpleMesh::Genus() const {
         uniqueEdges.insert(MyEdge(face.v2, face.v3));
     }
     size_t E = uniqueEdges.size();
-    size_t V = mVerts.size();
+    size_t V = mPositions.size();
     size_t F = mFaces.size();
 
     std::cerr << "Number of edges: " << E << ", F: " << F << ", V: " << V << "\n";
@@ -301,24 +326,30 @@ size_t SimpleMesh::Genus() const {
 }
 
 void SimpleMesh::Dilate(float amount) {
-    for (Vertex& v : mVerts) {
-        v.pos += amount * v.normal;
+    const std::vector<glm::vec3>& normals = mVertAttribs.Normals();
+    for (size_t i = 0; i < mPositions.size(); i++) {
+        mPositions[i] += amount * normals[i];
     }
     Initialize();
     Update();
 }
 
 void SimpleMesh::Erode(float amount) {
-    for (Vertex& v : mVerts) {
-        v.pos -= amount * v.normal;
+    const std::vector<glm::vec3>& normals = mVertAttribs.Normals();
+    for (size_t i = 0; i < mPositions.size(); i++) {
+        mPositions[i] -= amount * normals[i];
     }
     Initialize();
     Update();
 }
 
 void SimpleMesh::Smooth(float amount) {
-    for (Vertex& v : mVerts) {
-        v.pos -= amount * v.normal * v.curvature;
+    // Smoothing needs the curvature even if it is not shown
+    if (!mVertAttribs.HasCurvature()) UpdateCurvature();
+    const std::vector<glm::vec3>& normals = mVertAttribs.Normals();
+    const std::vector<float>& curvature = mVertAttribs.Curvature();
+    for (size_t i = 0; i < mPositions.size(); i++) {
+        mPositions[i] -= amount * normals[i] * curvature[i];
     }
     Initialize();
     Update();
@@ -344,30 +375,31 @@ void SimpleMesh::Render() {
 
     // Draw geometry
     glBegin(GL_TRIANGLES);
-    for (const Face& triangle : mFaces) {
-        const glm::vec3& p0 = mVerts[triangle.v1].pos;
-        const glm::vec3& p1 = mVerts[triangle.v2].pos;
-        const glm::vec3& p2 = mVerts[triangle.v3].pos;
+    for (size_t i = 0; i < mFaces.size(); i++) {
+        const Face& triangle = mFaces[i];
+        const glm::vec3& p0 = mPositions[triangle.v1];
+        const glm::vec3& p1 = mPositions[triangle.v2];
+        const glm::vec3& p2 = mPositions[triangle.v3];
 
         if (mVisualizationMode == CurvatureVertex) {
-            const glm::vec3& c1 = mVerts.at(triangle.v1).color;
+            const glm::vec3 c1 = mVertAttribs.Color(triangle.v1);
             glColor4f(c1[0], c1[1], c1[2], mOpacity);
-            glNormal3fv(glm::value_ptr(mVerts.at(triangle.v1).normal));
+            glNormal3fv(glm::value_ptr(mVertAttribs.Normal(triangle.v1)));
             glVertex3fv(glm::value_ptr(p0));
 
-            const glm::vec3& c2 = mVerts.at(triangle.v2).color;
+            const glm::vec3 c2 = mVertAttribs.Color(triangle.v2);
             glColor4f(c2[0], c2[1], c2[2], mOpacity);
-            glNormal3fv(glm::value_ptr(mVerts.at(triangle.v2).normal));
+            glNormal3fv(glm::value_ptr(mVertAttribs.Normal(triangle.v2)));
             glVertex3fv(glm::value_ptr(p1));
 
-            const glm::vec3& c3 = mVerts.at(triangle.v3).color;
+            const glm::vec3 c3 = mVertAttribs.Color(triangle.v3);
             glColor4f(c3[0], c3[1], c3[2], mOpacity);
-            glNormal3fv(glm::value_ptr(mVerts.at(triangle.v3).normal));
+            glNormal3fv(glm::value_ptr(mVertAttribs.Normal(triangle.v3)));
             glVertex3fv(glm::value_ptr(p2));
         } else {
-            const glm::vec3& color = triangle.color;
+            const glm::vec3 color = mFaceAttribs.Color(i);
             glColor4f(color[0], color[1], color[2], mOpacity);
-            glNormal3fv(glm::value_ptr(triangle.normal));
+            glNormal3fv(glm::value_ptr(mFaceAttribs.Normal(i)));
 
             glVertex3fv(glm::value_ptr(p0));
             glVertex3fv(glm::value_ptr(p1));
@@ -380,13 +412,14 @@ void SimpleMesh::Render() {
     if (mShowNormals) {
         glDisable(GL_LIGHTING);
         glBegin(GL_LINES);
-        for (const Face& face : mFaces) {
-            const Vertex& v1 = mVerts.at(face.v1);
-            const Vertex& v2 = mVerts.at(face.v2);
-            const Vertex& v3 = mVerts.at(face.v3);
+        for (size_t i = 0; i < mFaces.size(); i++) {
+            const Face& face = mFaces[i];
+            const Vertex v1 = GetVertex(face.v1);
+            const Vertex v2 = GetVertex(face.v2);
+            const Vertex v3 = GetVertex(face.v3);
 
             glm::vec3 faceStart = (v1.pos + v2.pos + v3.pos) / 3.f;
-            glm::vec3 faceEnd = faceStart + face.normal * 0.1f;
+            glm::vec3 faceEnd = faceStart + mFaceAttribs.Normal(i) * 0.1f;
 
             glColor3f(1.f, 0.f, 0.f);  // Red for face normal
             glVertex3fv(glm::value_ptr(faceStart));
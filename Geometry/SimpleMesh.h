@@ -16,6 +16,7 @@
 #define __simplemesh_h__
 
 #include <Geometry/Mesh.h>
+#include <Util/HashIndex.h>
 #include <Util/Util.h>
 #include <algorithm>
 #include <cassert>
@@ -41,15 +42,72 @@ struct MyEdge {
 
 class SimpleMesh : public Mesh {
 public:
-    struct Face : public Mesh::Face {
-        Face(size_t v1, size_t v2, size_t v3) : Mesh::Face(), v1(v1), v2(v2), v3(v3) {}
+    //! The corners of a triangle, its attributes are in mFaceAttribs
+    struct Face {
+        Face(size_t v1, size_t v2, size_t v3) : v1(v1), v2(v2), v3(v3) {}
         size_t v1, v2, v3;
     };
 
-    struct Vertex : public Mesh::Vertex {
-        Vertex() : Mesh::Vertex() {}
+    /*! \brief Range over the faces or one-ring vertices around a vertex.
+     * Reads the vertex to face table, so a query costs O(valence) and
+     * nothing is allocated. The faces are visited in index order (not
+     * sorted counter clockwise). For vertices the corner following the
+     * center vertex in each face is returned, which visits every neighbor
+     * once on a closed surface.
+     */
+    template <bool OneRing>
+    class Circulator {
+    public:
+        class Iterator {
+        public:
+            Iterator(SimpleMesh const* mesh, size_t vertex, const size_t* face)
+                : mMesh(mesh), mVertex(vertex), mFace(face) {}
+            size_t operator*() const {
+                if constexpr (OneRing) {
+                    const Face& f = mMesh->mFaces[*mFace];
+                    return f.v1 == mVertex ? f.v2 : (f.v2 == mVertex ? f.v3 : f.v1);
+                } else {
+                    return *mFace;
+                }
+            }
+            Iterator& operator++() {
+                mFace++;
+                return *this;
+            }
+            bool operator==(const Iterator& it) const { return mFace == it.mFace; }
+            bool operator!=(const Iterator& it) const { return mFace != it.mFace; }
+
+        protected:
+            SimpleMesh const* mMesh;
+            size_t mVertex;
+            const size_t* mFace;
+        };
+
+        Circulator(SimpleMesh const* mesh, size_t vertex) : mMesh(mesh), mVertex(vertex) {
+            // Built up front by the callers, a lazy rebuild here would race in parallel passes
+            assert(mesh->mAdjacencyValid &&
+                   mesh->mVertFaceStart.size() == mesh->mPositions.size() + 1);
+            mFirst = mesh->mVertFaces.data() + mesh->mVertFaceStart[vertex];
+            mLast = mesh->mVertFaces.data() + mesh->mVertFaceStart[vertex + 1];
+        }
+        Iterator begin() const { return Iterator(mMesh, mVertex, mFirst); }
+        Iterator end() const { return Iterator(mMesh, mVertex, mLast); }
+        bool empty() const { return mFirst == mLast; }
+        size_t size() const { return mLast - mFirst; }
+
+    protected:
+        SimpleMesh const* mMesh;
+        size_t mVertex;
+        const size_t *mFirst, *mLast;
     };
 
+    Circulator<false> FacesAroundVertex(size_t vertexIndex) const {
+        return Circulator<false>(this, vertexIndex);
+    }
+    Circulator<true> VerticesAroundVertex(size_t vertexIndex) const {
+        return Circulator<true>(this, vertexIndex);
+    }
+
 protected:
     //! Computes a facenormal for a given face
     glm::vec3 FaceNormal(size_t faceindx) const;
@@ -57,10 +115,37 @@ protected:
     //! Computes a facenormal for a given face
     glm::vec3 VertexNormal(size_t vertexindx) const;
 
-    std::vector<Vertex> mVerts;
+    std::vector<glm::vec3> mPositions;
     std::vector<Face> mFaces;
+    //! Normals, curvature and colors, the latter two only while they are used
+    AttributeStreams mVertAttribs, mFaceAttribs;
+
+    //! Gathers all attributes of vertex i, e.g. for the file writers
+    Vertex GetVertex(size_t i) const {
+        return Vertex(mPositions[i], mVertAttribs.Normal(i), mVertAttribs.Color(i),
+                      mVertAttribs.Curvature(i));
+    }
+
+    //! Computes the vertex and face curvature, allocating the streams
+    void UpdateCurvature();
+
+    //! A utility data structure to speed up removal of redundant vertices
+    HashIndex<VertexKey, size_t, VertexKeyHash> mUniqueVerts;
 
-    std::map<glm::vec3, size_t, glm_vec3_comparator<float>> mUniqueVerts;
+    /*! Vertex to face adjacency in compressed row form. The faces of vertex
+     * v are mVertFaces[mVertFaceStart[v]] up to mVertFaces[mVertFaceStart[v + 1]].
+     * Dropped by AddFace, Initialize() and UpdateCurvature() rebuild it
+     * before they circulate.
+     */
+    mutable std::vector<size_t> mVertFaceStart;
+    mutable std::vector<size_t> mVertFaces;
+    mutable bool mAdjacencyValid;
+
+    /*! Rebuilds the vertex to face table if faces were added since it was
+     * last built. Not thread safe, call it before any parallel pass so the
+     * workers only read the table.
+     */
+    void UpdateAdjacency() const;
 
     //! Adds a vertex to the mesh
     virtual size_t AddVertex(const glm::vec3& v) override;
@@ -88,11 +173,25 @@ public:
     //! Adds a triangle to the mesh.
     virtual bool AddFace(const std::vector<glm::vec3>& verts);
 
+    //! Builds the mesh from an indexed triangle list, replacing the current content
+    virtual bool Build(const glm::vec3* verts, size_t numVerts, const glm::uvec3* tris,
+                       size_t numTris) override;
+    using Mesh::Build;
+
+    virtual void SetVertexAttributes(const glm::vec3* normals, const glm::vec3* colors) override {
+        CopyVertexAttributes(mVertAttribs, normals, colors);
+    }
+
+    //! Frees the vertex lookup table used while adding faces, it is rebuilt on demand
+    void ReleaseBuildIndex() { mUniqueVerts.clear(); }
+
     //! Access to internal vertex data
-    const std::vector<Vertex>& GetVerts() const { return mVerts; }
+    const std::vector<glm::vec3>& GetPositions() const { return mPositions; }
     const std::vector<Face>& GetFaces() const { return mFaces; }
-    std::vector<Vertex>& GetVerts() { return mVerts; }
+    std::vector<glm::vec3>& GetPositions() { return mPositions; }
     std::vector<Face>& GetFaces() { return mFaces; }
+    //! The normal, curvature and color streams of the vertices
+    AttributeStreams& GetVertAttribs() { return mVertAttribs; }
 
     virtual void Dilate(float amount);
     virtual void Erode(float amount);
@@ -102,19 +201,14 @@ public:
 
     virtual void Render();
 
-    virtual bool save(std::ostream& os) {
-        os << "# SimpleMesh obj streamer\n# M&A 2008\n\n";
-        os << "# Vertices\n";
-        for (size_t i = 0; i < mVerts.size(); i++) {
-            os << "v " << mVerts.at(i).pos[0] << " " << mVerts.at(i).pos[1] << " "
-               << mVerts.at(i).pos[2] << "\n";
-        }
-        os << "\n# Faces\n";
-        for (size_t i = 0; i < mFaces.size(); i++) {
-            os << "f " << mFaces.at(i).v1 + 1 << " " << mFaces.at(i).v2 + 1 << " "
-               << mFaces.at(i).v3 + 1 << "\n";
-        }
-        return os.good();
+    virtual bool Save(std::ostream& os, MeshFormat format) override {
+        return WriteMesh(
+            os, format, "SimpleMesh", mVertAttribs.HasNormals(), mVertAttribs.HasColors(),
+            mPositions.size(), [this](size_t i) { return GetVertex(i); },
+            mFaces.size(),
+            [this](size_t i) {
+                return glm::uvec3(mFaces[i].v1, mFaces[i].v2, mFaces[i].v3);
+            });
     }
 };
 
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+/*! \brief Outcome of checking the connectivity of a mesh.
+ * Every kind of problem keeps the number of offending elements and the
+ * lowest few of their indices, so the report stays small however broken
+ * the mesh is.
+ */
+struct ValidationReport {
+    //! How many offending indices are kept for each kind of problem
+    static constexpr size_t MaxListed = 10;
+
+    //! Number of offending elements and the first MaxListed of their indices
+    struct Problem {
+        Problem() : count(0) {}
+
+        void Add(size_t index) {
+            if (first.size() < MaxListed) first.push_back(index);
+            count++;
+        }
+        //! Appends the problems of a later range of elements
+        void Merge(const Problem& p) {
+            for (size_t i = 0; i < p.first.size() && first.size() < MaxListed; i++) {
+                first.push_back(p.first[i]);
+            }
+            count += p.count;
+        }
+
+        size_t count;
+        std::vector<size_t> first;
+    };
+
+    ValidationReport() : numEdges(0), numFaces(0), numVerts(0) {}
+
+    //! Half-edges without an origin vertex or a pair
+    Problem uninitializedEdges;
+    //! Half-edges whose pair does not point back or runs in the same direction
+    Problem badPairs;
+    //! Half-edges whose next and prev are not inverse or leave the face
+    Problem badLoops;
+    //! Faces using a vertex more than once
+    Problem degenerateFaces;
+    //! Vertices without any half-edge, allowed but reported
+    Problem isolatedVerts;
+    //! Vertices whose half-edge does not start at them
+    Problem badVertEdges;
+    //! Vertices whose one-ring misses some of their half-edges or repeats a neighbor
+    Problem nonManifoldVerts;
+
+    size_t numEdges, numFaces, numVerts;
+
+    bool IsValid() const {
+        return uninitializedEdges.count == 0 && badPairs.count == 0 && badLoops.count == 0 &&
+               degenerateFaces.count == 0 && badVertEdges.count == 0 &&
+               nonManifoldVerts.count == 0;
+    }
+
+    void Print(std::ostream& os) const {
+        Print(os, "half-edges not properly initialized", uninitializedEdges);
+        Print(os, "half-edges with a bad pair", badPairs);
+        Print(os, "half-edges with bad next/prev links", badLoops);
+        os << "Done with edge check (checked " << numEdges << " edges)" << std::endl;
+        Print(os, "degenerate faces", degenerateFaces);
+        os << "Done with face check (checked " << numFaces << " faces)" << std::endl;
+        Print(os, "vertices with a bad half-edge", badVertEdges);
+        Print(os, "non-manifold vertices", nonManifoldVerts);
+        os << "Done with vertex check (checked " << numVerts << " vertices): "
+           << isolatedVerts.count << " isolated vertices found" << std::endl;
+    }
+
+protected:
+    static void Print(std::ostream& os, const char* what, const Problem& p) {
+        if (p.count == 0) return;
+        os << "Found " << p.count << " " << what << ":";
+        for (size_t i : p.first) os << " " << i;
+        if (p.count > p.first.size()) os << " ...";
+        os << std::endl;
+    }
+};
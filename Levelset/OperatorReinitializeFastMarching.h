@@ -13,7 +13,8 @@
 #define __operatorreinitializefastmarching_h__
 
 #include "Levelset/LevelSetOperator.h"
-#include "Util/Heap.h"
+#include "Util/IndexedHeap.h"
+#include <limits>
 #include <map>
 #include <cmath>
 
@@ -38,12 +39,8 @@ protected:
         }
     };
 
-    class Node : public Heap::Heapable {
-    public:
-        Node(Coordinate coord) : coordinate(coord) {}
-        Node(size_t  i, size_t j, size_t k) : coordinate(i, j, k) {}
-        Coordinate coordinate;
-    };
+    //! Marks a tentative point that was deleted since it left the narrow band
+    static constexpr size_t Deleted = (std::numeric_limits<size_t>::max)();
 
     float ComputeTentativeValue(size_t  i, size_t  j, size_t  k) {
         constexpr auto inf = std::numeric_limits<float>::max();
@@ -115,8 +112,8 @@ protected:
 
         // Find the tentative value and see if it's been deleted
         // (it was outside the narrow band)
-        std::map<Coordinate, Node *>::iterator iter = mTentative.find(coord);
-        if (iter != mTentative.end() && (*iter).second == NULL) return;
+        std::map<Coordinate, size_t>::iterator iter = mTentative.find(coord);
+        if (iter != mTentative.end() && (*iter).second == Deleted) return;
 
         // Otherwise, compute tentative value
         auto value = ComputeTentativeValue(i, j, k);
@@ -129,29 +126,24 @@ protected:
 
         // The point is new and within the narrowband
         if (iter == mTentative.end() && insideNarrowBand) {
-            Node *node = new Node(coord);
-            node->cost = value;
+            const size_t node = mNodes.size();
+            mNodes.push_back(coord);
 
-            mHeap.push(node);
+            mHeap.push(node, value);
             mTentative[coord] = node;
             // mexPrintf("Adding (%i,%i,%i) as new tentative point with value %f\n", i,j,k, value);
         }
         // The point is not new and within the narrowband
         else if (insideNarrowBand) {
-            Node *node = (*iter).second;
-            node->cost = value;
-
-            mHeap.update(node);
+            mHeap.update((*iter).second, value);
             // mexPrintf("Updating tentative point (%i,%i,%i) with value %f\n", i,j,k, value);
         }
         // The point is outside the narrowband and should be deleted
         // if possible
         else if (iter != mTentative.end()) {
             // mexPrintf("Outside narrowband at (%i,%i,%i)\n", i,j,k);
-            Node *node = (*iter).second;
-            mHeap.remove(node);
-            delete node;
-            (*iter).second = NULL;
+            mHeap.remove((*iter).second);
+            (*iter).second = Deleted;
         }
         // mexPrintf(" with value %f\n", value);
     }
@@ -201,6 +193,7 @@ public:
         // Clear maps (we can assume that mHeap is empty, given last loop)
         mAccepted.clear();
         mTentative.clear();
+        mNodes.clear();
 
         // Iterate the narrow band and find all points adjacent to
         // the zero-crossing
@@ -259,22 +252,22 @@ public:
         // Accept the smallest tentative value, update its neighbors
         // and continue until we're done
         while (!mHeap.isEmpty()) {
-            Node *node = static_cast<Node *>(mHeap.pop());
-            auto i = node->coordinate.i;
-            auto j = node->coordinate.j;
-            auto k = node->coordinate.k;
-            // mexPrintf("Accepting (%i,%i) with value %f\n", i, j, node->cost);
-
-            mAccepted[node->coordinate] = node->cost;
-
-            UpdateTentative(i - 1, j, k, node->coordinate.inside);
-            UpdateTentative(i + 1, j, k, node->coordinate.inside);
-            UpdateTentative(i, j - 1, k, node->coordinate.inside);
-            UpdateTentative(i, j + 1, k, node->coordinate.inside);
-            UpdateTentative(i, j, k - 1, node->coordinate.inside);
-            UpdateTentative(i, j, k + 1, node->coordinate.inside);
-
-            delete node;
+            const float cost = mHeap.topKey();
+            // A copy, as new tentative points may grow mNodes
+            const Coordinate coord = mNodes[mHeap.pop()];
+            auto i = coord.i;
+            auto j = coord.j;
+            auto k = coord.k;
+            // mexPrintf("Accepting (%i,%i) with value %f\n", i, j, cost);
+
+            mAccepted[coord] = cost;
+
+            UpdateTentative(i - 1, j, k, coord.inside);
+            UpdateTentative(i + 1, j, k, coord.inside);
+            UpdateTentative(i, j - 1, k, coord.inside);
+            UpdateTentative(i, j + 1, k, coord.inside);
+            UpdateTentative(i, j, k - 1, coord.inside);
+            UpdateTentative(i, j, k + 1, coord.inside);
         }
 
         // Loop through narrowband and reset the mask and
@@ -319,11 +312,14 @@ protected:
     // Map of accepted grid points
     std::map<Coordinate, float> mAccepted;
 
-    // Map of tentative grid points
-    std::map<Coordinate, Node *> mTentative;
+    // Map of tentative grid points to their index in mNodes (or Deleted)
+    std::map<Coordinate, size_t> mTentative;
+
+    // Coordinates of the tentative grid points, the index is the handle in mHeap
+    std::vector<Coordinate> mNodes;
 
     // Heap used to store and fetch smallest tentative grid points
-    Heap mHeap;
+    IndexedHeap<float> mHeap;
 
     float MaxNormGradient() {
         float maxGrad = -(std::numeric_limits<float>::max)();
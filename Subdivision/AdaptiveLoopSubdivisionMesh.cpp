@@ -33,7 +33,7 @@ void AdaptiveLoopSubdivisionMesh::Subdivide() {
     for (size_t i = 0; i < GetNumFaces(); i++) {
         // find neighbor faces
         size_t f1, f2, f3;
-        EdgeIterator eit = GetEdgeIterator(f(i).edge);
+        EdgeIterator eit = GetEdgeIterator(FaceEdge(i));
         f1 = eit.Pair().GetEdgeFaceIndex();
         eit.Pair();
         f2 = eit.Next().Pair().GetEdgeFaceIndex();
@@ -84,13 +84,11 @@ void AdaptiveLoopSubdivisionMesh::Subdivide() {
 */
 glm::vec3 AdaptiveLoopSubdivisionMesh::VertexRule(size_t vertexIndex) {
     // Get the current vertex
-    glm::vec3 vtx = v(vertexIndex).pos;
+    glm::vec3 vtx = Position(vertexIndex);
 
     // Get face neighborhood
-    std::vector<size_t> nb = FindNeighborFaces(vertexIndex);
-
-    for (size_t i = 0; i < nb.size(); i++) {
-        if (Subdividable(nb.at(i)) == false) {
+    for (size_t face : FacesAroundVertex(vertexIndex)) {
+        if (Subdividable(face) == false) {
             // don't move position
             return vtx;
         }
@@ -109,7 +107,7 @@ std::vector<std::vector<glm::vec3>> AdaptiveLoopSubdivisionMesh::Subdivide1(size
     // 1. Start by orienting the triangle so that we always have the same case
     // We find the start edge as the edge who shares face with the
     // _not_subdividable_ neighbor
-    HalfEdgeMesh::EdgeIterator eit = GetEdgeIterator(f(faceIndex).edge);
+    HalfEdgeMesh::EdgeIterator eit = GetEdgeIterator(FaceEdge(faceIndex));
     size_t num = 0;
     while (Subdividable(eit.Pair().GetEdgeFaceIndex())) {
         eit.Pair().Next();
@@ -162,7 +160,7 @@ std::vector<std::vector<glm::vec3>> AdaptiveLoopSubdivisionMesh::Subdivide2(size
     // 1. Start by orienting the triangle so that we always have the same case
     // We find the start edge as the edge who shares face with the _subdividable_
     // neighbor
-    EdgeIterator eit = GetEdgeIterator(f(faceIndex).edge);
+    EdgeIterator eit = GetEdgeIterator(FaceEdge(faceIndex));
     size_t num = 0;
     while (!Subdividable(eit.Pair().GetEdgeFaceIndex())) {
         eit.Pair().Next();
@@ -204,7 +202,7 @@ std::vector<std::vector<glm::vec3>> AdaptiveLoopSubdivisionMesh::Subdivide2(size
   or if subdividable for this face is false
 */
 std::vector<std::vector<glm::vec3>> AdaptiveLoopSubdivisionMesh::Subdivide3(size_t faceIndex) {
-    EdgeIterator eit = GetEdgeIterator(f(faceIndex).edge);
+    EdgeIterator eit = GetEdgeIterator(FaceEdge(faceIndex));
     glm::vec3 v1 = VertexRule(eit.GetEdgeVertexIndex());
     glm::vec3 v2 = VertexRule(eit.Next().GetEdgeVertexIndex());
     glm::vec3 v3 = VertexRule(eit.Next().GetEdgeVertexIndex());
@@ -14,35 +14,126 @@
 #include <cassert>
 
 /*! Subdivides the mesh uniformly one step
+ *
+ * The refined connectivity follows from the old one by arithmetic, nothing
+ * is looked up or welded. Vertex v keeps its index and the vertex on edge
+ * e gets GetNumVerts() + e. Face f becomes faces 4f to 4f+3: the corner
+ * faces of its corners 0, 1 and 2 are 4f, 4f+2 and 4f+3, and 4f+1 is the
+ * middle face. Each old half-edge h is split into first(h) from its
+ * origin to the edge vertex and second(h) from there on, and the boundary
+ * half-edge j becomes the boundary half-edges 2j and 2j+1.
  */
 void LoopSubdivisionMesh::Subdivide() {
-    // Create new mesh and copy all the attributes
-    HalfEdgeMesh subDivMesh;
-    subDivMesh.SetTransform(GetTransform());
-    subDivMesh.SetName(GetName());
-    subDivMesh.SetColorMap(GetColorMap());
-    subDivMesh.SetWireframe(GetWireframe());
-    subDivMesh.SetShowNormals(GetShowNormals());
-    subDivMesh.SetOpacity(GetOpacity());
-    if (IsHovering()) subDivMesh.Hover();
-    if (IsSelected()) subDivMesh.Select();
-    subDivMesh.mMinCMap = mMinCMap;
-    subDivMesh.mMaxCMap = mMaxCMap;
-    subDivMesh.mAutoMinMax = mAutoMinMax;
-
-    // loop over each face and create 4 new ones
-    for (size_t i = 0; i < mFaces.size(); i++) {
-        // subdivide face
-        std::vector<std::vector<glm::vec3>> faces = Subdivide(i);
-
-        // add new faces to subDivMesh
-        for (size_t j = 0; j < faces.size(); j++) {
-            subDivMesh.AddFace(faces.at(j));
+    mConn.BuildBoundary();
+    const size_t numVerts = GetNumVerts();
+    const size_t numFaces = GetNumFaces();
+    const size_t numInner = 3 * numFaces;
+    const size_t numHalfEdges = GetNumEdges();
+    const size_t numBoundary = numHalfEdges - numInner;
+
+    // Number the edges by their inner half-edge with the smaller index,
+    // a boundary half-edge always comes after its pair
+    std::vector<uint32_t> edgeOf(numHalfEdges);
+    std::vector<uint32_t> edgeHalfEdge;
+    edgeHalfEdge.reserve((numHalfEdges + 1) / 2);
+    for (size_t h = 0; h < numInner; h++) {
+        const size_t pair = EdgePair(h);
+        if (h < pair) {
+            edgeOf[h] = edgeOf[pair] = static_cast<uint32_t>(edgeHalfEdge.size());
+            edgeHalfEdge.push_back(static_cast<uint32_t>(h));
         }
     }
+    const size_t numEdges = edgeHalfEdge.size();
+
+    const size_t newInner = 4 * numInner;
+    const size_t newHalfEdges = newInner + 2 * numBoundary;
+    if (newHalfEdges > Connectivity::MaxHalfEdges) {
+        std::cerr << "Error: subdivided mesh too large for the half-edge index type" << std::endl;
+        return;
+    }
 
-    // Assigns the new mesh
-    *this = LoopSubdivisionMesh(subDivMesh, ++mNumSubDivs);
+    // The old positions are read by the rules until all new ones are computed
+    std::vector<glm::vec3> positions(numVerts + numEdges);
+    ParallelFor(0, numVerts, [&](size_t v) { positions[v] = VertexRule(v); });
+    ParallelFor(0, numEdges,
+                [&](size_t e) { positions[numVerts + e] = EdgeRule(edgeHalfEdge[e]); });
+
+    // Child face of face f at corner k is 4f + cornerFace[k]
+    static const size_t cornerFace[3] = {0, 2, 3};
+    const auto first = [&](size_t h) {
+        if (h >= numInner) return newInner + 2 * (h - numInner);
+        return 3 * (4 * (h / 3) + cornerFace[h % 3]) + h % 3;
+    };
+    const auto second = [&](size_t h) {
+        if (h >= numInner) return newInner + 2 * (h - numInner) + 1;
+        return 3 * (4 * (h / 3) + cornerFace[(h % 3 + 1) % 3]) + h % 3;
+    };
+
+    Connectivity refined;
+    refined.Assign(
+        numVerts + numEdges, 4 * numFaces, newHalfEdges,
+        [&](Connectivity::Index* vert, Connectivity::Index* pair, Connectivity::Index* vertEdge,
+            Connectivity::Index* boundaryNext, Connectivity::Index* boundaryPrev) {
+            const auto link = [](Connectivity::Index* array, size_t i, size_t value) {
+                array[i] = static_cast<Connectivity::Index>(value);
+            };
+
+            ParallelFor(0, numFaces, [&](size_t f) {
+                const size_t middle = 3 * (4 * f + 1);
+                for (size_t k = 0; k < 3; k++) {
+                    const size_t h = 3 * f + k;
+                    const size_t k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+                    const size_t corner = 3 * (4 * f + cornerFace[k]);
+
+                    // Corner face: the old corner, the vertex on its outgoing
+                    // edge and the vertex on its incoming edge
+                    link(vert, corner + k, EdgeVert(h));
+                    link(vert, corner + k1, numVerts + edgeOf[h]);
+                    link(vert, corner + k2, numVerts + edgeOf[3 * f + k2]);
+                    link(vert, middle + k, numVerts + edgeOf[h]);
+
+                    link(pair, first(h), second(EdgePair(h)));
+                    link(pair, second(h), first(EdgePair(h)));
+                    link(pair, corner + k1, middle + k2);
+                    link(pair, middle + k2, corner + k1);
+                }
+            });
+
+            ParallelFor(0, numBoundary, [&](size_t j) {
+                const size_t b = numInner + j;
+                link(vert, first(b), EdgeVert(b));
+                link(vert, second(b), numVerts + edgeOf[b]);
+                link(pair, first(b), second(EdgePair(b)));
+                link(pair, second(b), first(EdgePair(b)));
+
+                const size_t next = EdgeNext(b), prev = EdgePrev(b);
+                link(boundaryNext, 2 * j, second(b));
+                link(boundaryNext, 2 * j + 1,
+                     next == EdgeState::Uninitialized ? next : first(next));
+                link(boundaryPrev, 2 * j, prev == EdgeState::Uninitialized ? prev : second(prev));
+                link(boundaryPrev, 2 * j + 1, first(b));
+            });
+
+            ParallelFor(0, numVerts, [&](size_t v) {
+                const size_t edge = VertEdge(v);
+                link(vertEdge, v, edge == EdgeState::Uninitialized ? edge : first(edge));
+            });
+            ParallelFor(0, numEdges, [&](size_t e) {
+                link(vertEdge, numVerts + e, second(edgeHalfEdge[e]));
+            });
+        });
+
+    // Move the refined mesh into place
+    mConn = std::move(refined);
+    mPositions.swap(positions);
+    mVertAttribs.clear();
+    mFaceAttribs.clear();
+    mVertAttribs.resize(mPositions.size());
+    mFaceAttribs.resize(4 * numFaces);
+    ReleaseBuildIndex();
+    MarkAllDirty();
+
+    mNumSubDivs++;
     Update();
 }
 
@@ -50,7 +141,7 @@ void LoopSubdivisionMesh::Subdivide() {
  */
 std::vector<std::vector<glm::vec3>> LoopSubdivisionMesh::Subdivide(size_t faceIndex) {
     std::vector<std::vector<glm::vec3>> faces;
-    EdgeIterator eit = GetEdgeIterator(f(faceIndex).edge);
+    EdgeIterator eit = GetEdgeIterator(FaceEdge(faceIndex));
 
     // get the inner halfedges
     size_t e0, e1, e2;
@@ -104,14 +195,13 @@ std::vector<std::vector<glm::vec3>> LoopSubdivisionMesh::Subdivide(size_t faceIn
  */
 glm::vec3 LoopSubdivisionMesh::VertexRule(size_t vertexIndex) {
     // Get the current vertex
-    glm::vec3 vtx = v(vertexIndex).pos;
-    std::vector<size_t> neighbours = FindNeighborVertices(vertexIndex);
-    float k = neighbours.size();
+    glm::vec3 vtx = Position(vertexIndex);
+    const size_t k = VerticesAroundVertex(vertexIndex).size();
 
     glm::vec3 newV = vtx * (1 - k * Beta(k));
 
-    for (int i = 0; i < neighbours.size(); i++) {
-        newV += v(neighbours.at(i)).pos * Beta(k);
+    for (size_t nb : VerticesAroundVertex(vertexIndex)) {
+        newV += Position(nb) * Beta(k);
     }
 
     return newV;
@@ -121,14 +211,14 @@ glm::vec3 LoopSubdivisionMesh::VertexRule(size_t vertexIndex) {
  */
 glm::vec3 LoopSubdivisionMesh::EdgeRule(size_t edgeIndex) {
     // Place the edge vertex halfway along the edge
-    HalfEdge& e0 = e(edgeIndex);
-    HalfEdge& e1 = e(e0.pair);
-    HalfEdge& e2 = e(e0.prev);
-    HalfEdge& e3 = e(e1.prev);
-    glm::vec3& v0 = v(e0.vert).pos;
-    glm::vec3& v1 = v(e1.vert).pos;
-    glm::vec3& v2 = v(e2.vert).pos;
-    glm::vec3& v3 = v(e3.vert).pos;
+    size_t e0 = edgeIndex;
+    size_t e1 = EdgePair(e0);
+    size_t e2 = EdgePrev(e0);
+    size_t e3 = EdgePrev(e1);
+    const glm::vec3& v0 = Position(EdgeVert(e0));
+    const glm::vec3& v1 = Position(EdgeVert(e1));
+    const glm::vec3& v2 = Position(EdgeVert(e2));
+    const glm::vec3& v3 = Position(EdgeVert(e3));
     return ((3.0f / 8.0f) * (v0 + v1)) + ((1.0f / 8.0f) * (v2 + v3));
 }
 
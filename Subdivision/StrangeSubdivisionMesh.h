@@ -16,17 +16,19 @@ protected:
         // Every 4th face is not subdividable - kinda strange!
         // Do something more interesting...
                 
-        HalfEdgeMesh::Face currentFace = f(fi);
-        //HalfEdgeMesh::Face neighbourFace = f(e(e(currentFace.edge).pair).face);
+        // There is no face beyond a boundary edge to hold anything back
+        if (fi == EdgeState::Border) return true;
+        const glm::vec3 currentNormal = mFaceAttribs.Normal(fi);
+        //const glm::vec3 neighbourNormal = mFaceAttribs.Normal(EdgeFace(EdgePair(FaceEdge(fi))));
 
-        std::vector<size_t> oneRing = HalfEdgeMesh::FindNeighborFaces(e(f(fi).edge).vert);
         float angle = 0;
         float angleCurr = 0;
 
-        for (auto face : oneRing) {
-            
-            
-            angleCurr = glm::angle(glm::normalize(currentFace.normal), glm::normalize(f(face).normal));
+        for (size_t face : FacesAroundVertex(EdgeVert(FaceEdge(fi)))) {
+            if (face == EdgeState::Border) continue;
+
+            angleCurr = glm::angle(glm::normalize(currentNormal),
+                                   glm::normalize(mFaceAttribs.Normal(face)));
 
             if (angleCurr > angle) {
                 angle = angleCurr;
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <glm.hpp>
+
+/*! \brief Open addressing hash table mapping keys to element indices.
+ *
+ * Keys and values are stored side by side in one flat, power-of-two sized
+ * array and collisions are resolved by linear probing. Compared to a
+ * std::map this needs no per-entry allocation and a lookup normally
+ * touches a single cache line. Entries can't be erased one by one, the
+ * whole index is dropped with clear() when it is no longer needed.
+ */
+template <typename Key, typename Value, typename Hash>
+class HashIndex {
+public:
+    //! Marks an unused slot, can't be stored as a value
+    static constexpr Value Empty = (std::numeric_limits<Value>::max)();
+
+    HashIndex() : mSize(0) {}
+
+    //! Make room for at least n entries without rehashing
+    void reserve(size_t n) {
+        size_t capacity = 16;
+        while (capacity * 7 < n * 10) capacity *= 2;
+        if (capacity > mSlots.size()) rehash(capacity);
+    }
+
+    //! Return a pointer to the value stored for key, or NULL if not present
+    const Value* find(const Key& key) const {
+        if (mSlots.empty()) return NULL;
+        const size_t mask = mSlots.size() - 1;
+        size_t i = Hash()(key) & mask;
+        while (mSlots[i].value != Empty) {
+            if (mSlots[i].key == key) return &mSlots[i].value;
+            i = (i + 1) & mask;
+        }
+        return NULL;
+    }
+
+    /*! Insert value for key unless the key is already present.
+     * \return the stored value and true if a new entry was created
+     */
+    std::pair<Value, bool> insert(const Key& key, Value value) {
+        if ((mSize + 1) * 10 > mSlots.size() * 7) {
+            rehash(mSlots.empty() ? 16 : mSlots.size() * 2);
+        }
+        const size_t mask = mSlots.size() - 1;
+        size_t i = Hash()(key) & mask;
+        while (mSlots[i].value != Empty) {
+            if (mSlots[i].key == key) return {mSlots[i].value, false};
+            i = (i + 1) & mask;
+        }
+        mSlots[i].key = key;
+        mSlots[i].value = value;
+        mSize++;
+        return {value, true};
+    }
+
+    //! Remove all entries and release the memory
+    void clear() {
+        std::vector<Slot>().swap(mSlots);
+        mSize = 0;
+    }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    //! Number of bytes held by the table
+    size_t memoryUsage() const { return mSlots.capacity() * sizeof(Slot); }
+
+protected:
+    struct Slot {
+        Slot() : value(Empty) {}
+        Key key;
+        Value value;
+    };
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity);
+        old.swap(mSlots);
+        const size_t mask = mSlots.size() - 1;
+        for (const Slot& s : old) {
+            if (s.value == Empty) continue;
+            size_t i = Hash()(s.key) & mask;
+            while (mSlots[i].value != Empty) i = (i + 1) & mask;
+            mSlots[i] = s;
+        }
+    }
+
+    std::vector<Slot> mSlots;
+    size_t mSize;
+};
+
+//! 64 bit finalizer (from MurmurHash3), spreads the bits of a key
+inline uint64_t HashMix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+/*! \brief Quantized vertex position used as key when welding vertices.
+ * With a zero cell size the key is the exact bit pattern of the
+ * coordinates, which gives the same welding as comparing the floats.
+ */
+struct VertexKey {
+    int32_t x, y, z;
+    bool operator==(const VertexKey& k) const { return x == k.x && y == k.y && z == k.z; }
+};
+
+inline VertexKey MakeVertexKey(const glm::vec3& p, float cellSize = 0.f) {
+    VertexKey key;
+    if (cellSize > 0.f) {
+        key.x = static_cast<int32_t>(std::floor(p[0] / cellSize));
+        key.y = static_cast<int32_t>(std::floor(p[1] / cellSize));
+        key.z = static_cast<int32_t>(std::floor(p[2] / cellSize));
+    } else {
+        // Adding 0 turns -0.f into +0.f so both weld
+        const glm::vec3 q = p + glm::vec3(0.f, 0.f, 0.f);
+        std::memcpy(&key.x, &q[0], sizeof(float));
+        std::memcpy(&key.y, &q[1], sizeof(float));
+        std::memcpy(&key.z, &q[2], sizeof(float));
+    }
+    return key;
+}
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& k) const {
+        uint64_t h = HashMix((uint64_t(uint32_t(k.x)) << 32) | uint32_t(k.y));
+        return static_cast<size_t>(HashMix(h ^ uint32_t(k.z)));
+    }
+};
+
+//! Pack an undirected edge between two vertices (< 2^32) into a 64 bit key
+inline uint64_t MakeEdgeKey(size_t v1, size_t v2) {
+    const uint64_t a = std::min(v1, v2);
+    const uint64_t b = std::max(v1, v2);
+    return (a << 32) | (b & 0xffffffffULL);
+}
+
+struct EdgeKeyHash {
+    size_t operator()(uint64_t k) const { return static_cast<size_t>(HashMix(k)); }
+};
+
+/*! Merges vertices with the same (quantized) position and rewrites the
+ * triangle indices accordingly. Keeps the first occurrence of each vertex.
+ * \return the number of vertices that were removed
+ */
+inline size_t WeldVertices(std::vector<glm::vec3>& verts, std::vector<glm::uvec3>& tris,
+                           float cellSize = 0.f) {
+    HashIndex<VertexKey, unsigned int, VertexKeyHash> unique;
+    unique.reserve(verts.size());
+    std::vector<unsigned int> remap(verts.size());
+    size_t numUnique = 0;
+    for (size_t i = 0; i < verts.size(); i++) {
+        auto found = unique.insert(MakeVertexKey(verts[i], cellSize), unsigned(numUnique));
+        remap[i] = found.first;
+        if (found.second) verts[numUnique++] = verts[i];
+    }
+
+    const size_t numRemoved = verts.size() - numUnique;
+    if (numRemoved == 0) return 0;
+
+    verts.resize(numUnique);
+    for (glm::uvec3& t : tris) {
+        for (int k = 0; k < 3; k++) {
+            if (t[k] < remap.size()) t[k] = remap[t[k]];
+        }
+    }
+    return numRemoved;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+/*! \brief Indexed d-ary min heap of keys attached to dense integer handles.
+ *
+ * The callers keep their elements in arrays and refer to them by index,
+ * the heap only stores the key next to the handle in one contiguous
+ * array, so comparisons never leave it. A second array maps every handle
+ * to its slot, which makes update and remove by handle O(log n). A wider
+ * node (D = 4 by default) halves the depth of a binary heap and reads
+ * the children from one or two cache lines.
+ *
+ * \code
+ * IndexedHeap<float> heap(numElements);
+ * heap.push(i, cost[i]);
+ * heap.update(i, newCost);
+ * size_t next = heap.pop();
+ * \endcode
+ */
+template <typename KeyT = float, unsigned D = 4, typename IndexT = uint32_t,
+          typename Compare = std::less<KeyT>>
+class IndexedHeap {
+    static_assert(D >= 2, "a heap node needs at least two children");
+
+public:
+    typedef KeyT Key;
+    typedef IndexT Index;
+
+    //! Slot of a handle that is not in the heap
+    static constexpr Index NotInHeap = (std::numeric_limits<Index>::max)();
+
+    //! Creates an empty heap for handles below numHandles, more are added on demand
+    explicit IndexedHeap(size_t numHandles = 0) : mSlot(numHandles, NotInHeap) {}
+
+    size_t size() const { return mEntries.size(); }
+    bool isEmpty() const { return mEntries.empty(); }
+
+    //! Removes all entries, keeping the memory
+    void clear() {
+        for (const Entry& e : mEntries) mSlot[e.handle] = NotInHeap;
+        mEntries.clear();
+    }
+
+    //! Reserves room for numEntries entries and handles below numHandles
+    void reserve(size_t numEntries, size_t numHandles) {
+        mEntries.reserve(numEntries);
+        if (mSlot.size() < numHandles) mSlot.resize(numHandles, NotInHeap);
+    }
+
+    bool contains(size_t handle) const {
+        return handle < mSlot.size() && mSlot[handle] != NotInHeap;
+    }
+
+    //! Key of a handle that is in the heap
+    Key key(size_t handle) const {
+        assert(contains(handle));
+        return mEntries[mSlot[handle]].key;
+    }
+
+    //! Adds a handle that is not in the heap yet
+    void push(size_t handle, Key key) {
+        assert(!contains(handle) && handle < NotInHeap);
+        if (handle >= mSlot.size()) mSlot.resize(handle + 1, NotInHeap);
+        mEntries.push_back(Entry{key, static_cast<Index>(handle)});
+        siftUp(mEntries.size() - 1);
+    }
+
+    /*! Appends an entry without restoring the heap order, for filling a
+     * heap in bulk. heapify() has to be called before any other operation.
+     */
+    void append(size_t handle, Key key) {
+        assert(!contains(handle) && handle < NotInHeap);
+        if (handle >= mSlot.size()) mSlot.resize(handle + 1, NotInHeap);
+        mSlot[handle] = static_cast<Index>(mEntries.size());
+        mEntries.push_back(Entry{key, static_cast<Index>(handle)});
+    }
+
+    //! Restores the heap order bottom up in O(n) after append()
+    void heapify() {
+        if (mEntries.size() < 2) return;
+        for (size_t i = parent(mEntries.size() - 1) + 1; i-- > 0;) siftDown(i);
+    }
+
+    //! Handle with the smallest key
+    size_t top() const {
+        assert(!isEmpty());
+        return mEntries.front().handle;
+    }
+    Key topKey() const {
+        assert(!isEmpty());
+        return mEntries.front().key;
+    }
+
+    //! Removes and returns the handle with the smallest key
+    size_t pop() {
+        const size_t handle = top();
+        removeSlot(0);
+        return handle;
+    }
+
+    //! Changes the key of a handle in the heap
+    void update(size_t handle, Key key) {
+        assert(contains(handle));
+        const size_t slot = mSlot[handle];
+        const bool up = mLess(key, mEntries[slot].key);
+        mEntries[slot].key = key;
+        if (up) {
+            siftUp(slot);
+        } else {
+            siftDown(slot);
+        }
+    }
+
+    //! Adds the handle or changes its key if it is in the heap already
+    void pushOrUpdate(size_t handle, Key key) {
+        if (contains(handle)) {
+            update(handle, key);
+        } else {
+            push(handle, key);
+        }
+    }
+
+    //! Takes a handle out of the heap
+    void remove(size_t handle) {
+        assert(contains(handle));
+        removeSlot(mSlot[handle]);
+    }
+
+    void print(std::ostream& os) const {
+        for (const Entry& e : mEntries) os << e.key << "(" << e.handle << ") ";
+        os << std::endl;
+    }
+
+protected:
+    struct Entry {
+        Key key;
+        Index handle;
+    };
+
+    static size_t parent(size_t i) { return (i - 1) / D; }
+    static size_t firstChild(size_t i) { return D * i + 1; }
+
+    void removeSlot(size_t slot) {
+        mSlot[mEntries[slot].handle] = NotInHeap;
+        const Entry last = mEntries.back();
+        mEntries.pop_back();
+        if (slot == mEntries.size()) return;
+
+        // The last entry fills the hole and moves whichever way it has to
+        const bool up = slot > 0 && mLess(last.key, mEntries[parent(slot)].key);
+        mEntries[slot] = last;
+        if (up) {
+            siftUp(slot);
+        } else {
+            siftDown(slot);
+        }
+    }
+
+    //! Moves the entry at slot towards the root, the entries passed move down
+    void siftUp(size_t slot) {
+        const Entry e = mEntries[slot];
+        while (slot > 0) {
+            const size_t p = parent(slot);
+            if (!mLess(e.key, mEntries[p].key)) break;
+            place(slot, mEntries[p]);
+            slot = p;
+        }
+        place(slot, e);
+    }
+
+    //! Moves the entry at slot towards the leaves, swapping with the smallest child
+    void siftDown(size_t slot) {
+        const Entry e = mEntries[slot];
+        const size_t n = mEntries.size();
+        while (true) {
+            const size_t first = firstChild(slot);
+            if (first >= n) break;
+            const size_t last = first + D < n ? first + D : n;
+            size_t child = first;
+            for (size_t c = first + 1; c < last; c++) {
+                if (mLess(mEntries[c].key, mEntries[child].key)) child = c;
+            }
+            if (!mLess(mEntries[child].key, e.key)) break;
+            place(slot, mEntries[child]);
+            slot = child;
+        }
+        place(slot, e);
+    }
+
+    void place(size_t slot, const Entry& e) {
+        mEntries[slot] = e;
+        mSlot[e.handle] = static_cast<Index>(slot);
+    }
+
+    //! The heap, keys next to their handles
+    std::vector<Entry> mEntries;
+    //! Slot in mEntries of every handle, NotInHeap if it is not in the heap
+    std::vector<Index> mSlot;
+    Compare mLess;
+};
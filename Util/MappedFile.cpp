@@ -0,0 +1,107 @@
+#include <Util/MappedFile.h>
+#include <iostream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : mData(NULL), mSize(0), mOpen(false), mFile(NULL), mMapping(NULL) {}
+
+bool MappedFile::Open(const std::string& filename) {
+    Close();
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error: could not open " << filename << std::endl;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        std::cerr << "Error: could not get the size of " << filename << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+    mFile = file;
+    mSize = static_cast<size_t>(size.QuadPart);
+    mOpen = true;
+    // A file of size zero can't be mapped, it is just empty
+    if (mSize == 0) return true;
+
+    mMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping != NULL) {
+        mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (mData == NULL) {
+        std::cerr << "Error: could not map " << filename << std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close() {
+    if (mData != NULL) UnmapViewOfFile(mData);
+    if (mMapping != NULL) CloseHandle(mMapping);
+    if (mFile != NULL) CloseHandle(mFile);
+    mData = NULL;
+    mMapping = NULL;
+    mFile = NULL;
+    mSize = 0;
+    mOpen = false;
+}
+
+#else
+
+MappedFile::MappedFile() : mData(NULL), mSize(0), mOpen(false), mFd(-1) {}
+
+bool MappedFile::Open(const std::string& filename) {
+    Close();
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: could not open " << filename << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        std::cerr << "Error: could not get the size of " << filename << std::endl;
+        close(fd);
+        return false;
+    }
+    mFd = fd;
+    mSize = static_cast<size_t>(info.st_size);
+    mOpen = true;
+    // A file of size zero can't be mapped, it is just empty
+    if (mSize == 0) return true;
+
+    void* data = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        std::cerr << "Error: could not map " << filename << std::endl;
+        Close();
+        return false;
+    }
+    // Files are usually parsed in one go, start reading all of it
+    madvise(data, mSize, MADV_WILLNEED);
+    mData = static_cast<const char*>(data);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (mData != NULL) munmap(const_cast<char*>(mData), mSize);
+    if (mFd >= 0) close(mFd);
+    mData = NULL;
+    mFd = -1;
+    mSize = 0;
+    mOpen = false;
+}
+
+#endif
+
+MappedFile::~MappedFile() { Close(); }
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*! \brief Read-only view of a whole file mapped into memory.
+ * The pages are loaded by the OS on first access, so a file can be parsed
+ * straight from the page cache without copying it into a buffer first.
+ */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    //! Maps filename, closing any file mapped before. Returns false on error
+    bool Open(const std::string& filename);
+    void Close();
+
+    bool IsOpen() const { return mOpen; }
+    //! First byte of the file, NULL for an empty file
+    const char* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+protected:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* mData;
+    size_t mSize;
+    bool mOpen;
+#ifdef _WIN32
+    void* mFile;
+    void* mMapping;
+#else
+    int mFd;
+#endif
+};
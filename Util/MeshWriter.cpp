@@ -0,0 +1,38 @@
+#include <Util/MeshWriter.h>
+#include <algorithm>
+#include <cctype>
+
+MeshFormat MeshFormatFromFilename(const std::string& filename) {
+    const size_t dot = filename.rfind('.');
+    if (dot == std::string::npos) return MeshFormat::Obj;
+
+    std::string suffix = filename.substr(dot + 1);
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (suffix == "ply") return MeshFormat::PlyBinary;
+    if (suffix == "stl") return MeshFormat::StlBinary;
+    if (suffix == "hem") return MeshFormat::HalfEdge;
+    return MeshFormat::Obj;
+}
+
+BufferedWriter::BufferedWriter(std::ostream& os) : mStream(os), mBuffer(BlockSize), mSize(0) {}
+
+void BufferedWriter::Write(const void* data, size_t n) {
+    const char* bytes = static_cast<const char*>(data);
+    while (n > 0) {
+        Reserve(1);
+        const size_t count = std::min(n, mBuffer.size() - mSize);
+        std::memcpy(&mBuffer[mSize], bytes, count);
+        mSize += count;
+        bytes += count;
+        n -= count;
+    }
+}
+
+bool BufferedWriter::Flush() {
+    if (mSize > 0) {
+        mStream.write(mBuffer.data(), mSize);
+        mSize = 0;
+    }
+    return mStream.good();
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <glm.hpp>
+
+//! File formats a mesh can be saved in
+enum class MeshFormat {
+    Obj,        //!< Wavefront obj text
+    PlyBinary,  //!< Stanford ply, binary little endian
+    StlBinary,  //!< Binary stl, one normal and three corners per triangle
+    HalfEdge    //!< Native binary half-edge mesh with connectivity, see MeshFile.h
+};
+
+//! Picks the format from the extension of filename, obj if it is not known
+MeshFormat MeshFormatFromFilename(const std::string& filename);
+
+/*! \brief Collects output in a large buffer and hands it to the stream in
+ * big blocks. Numbers are formatted with std::to_chars, which is locale
+ * independent and much faster than operator<< on the stream. Floats are
+ * written with the shortest representation that reads back exactly.
+ */
+class BufferedWriter {
+public:
+    //! Size of the blocks written to the stream
+    static const size_t BlockSize = 1 << 20;
+
+    explicit BufferedWriter(std::ostream& os);
+    ~BufferedWriter() { Flush(); }
+
+    //! Writes n raw bytes
+    void Write(const void* data, size_t n);
+
+    //! Writes v as little endian, whatever the byte order of the machine
+    void WriteLittleEndian(uint32_t v) {
+        const unsigned char b[4] = {
+            static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8),
+            static_cast<unsigned char>(v >> 16), static_cast<unsigned char>(v >> 24)};
+        Write(b, 4);
+    }
+    void WriteLittleEndian(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, 4);
+        WriteLittleEndian(bits);
+    }
+
+    BufferedWriter& operator<<(const char* str) {
+        Write(str, std::strlen(str));
+        return *this;
+    }
+    BufferedWriter& operator<<(char c) {
+        Reserve(1);
+        mBuffer[mSize++] = c;
+        return *this;
+    }
+    BufferedWriter& operator<<(float v) { return Format(v); }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, BufferedWriter&>::type operator<<(T v) {
+        return Format(v);
+    }
+
+    //! Hands the buffered bytes to the stream, false if the stream failed
+    bool Flush();
+
+protected:
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    //! Makes room for n more bytes, flushing if the buffer is full
+    void Reserve(size_t n) {
+        if (mSize + n > mBuffer.size()) Flush();
+    }
+
+    template <typename T>
+    BufferedWriter& Format(T v) {
+        // Longest float or 64 bit integer fits with room to spare
+        Reserve(32);
+        char* begin = &mBuffer[mSize];
+        mSize += std::to_chars(begin, begin + 32, v).ptr - begin;
+        return *this;
+    }
+
+    std::ostream& mStream;
+    std::vector<char> mBuffer;
+    size_t mSize;
+};
+
+/*! Writes an indexed triangle mesh in the given format. The mesh is read
+ * through vert(i), returning vertex i with its pos, normal and color, and
+ * tri(i), returning the zero based corners of triangle i, so no copy of
+ * the mesh is made. title names the mesh type in the file header. Only ply
+ * stores the normals and colors, the colors as bytes, and only those the
+ * mesh has as told by normals and colors.
+ */
+template <typename VertFn, typename TriFn>
+bool WriteMesh(std::ostream& os, MeshFormat format, const char* title, bool normals,
+               bool colors, size_t numVerts, VertFn vert, size_t numTris, TriFn tri) {
+    if (format == MeshFormat::HalfEdge) {
+        std::cerr << "Error: " << title << " can't be saved as a half-edge mesh file" << std::endl;
+        return false;
+    }
+
+    BufferedWriter out(os);
+    if (format == MeshFormat::PlyBinary) {
+        out << "ply\nformat binary_little_endian 1.0\ncomment " << title << "\nelement vertex "
+            << numVerts << "\nproperty float x\nproperty float y\nproperty float z\n";
+        if (normals) out << "property float nx\nproperty float ny\nproperty float nz\n";
+        if (colors) out << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+        out << "element face " << numTris << "\nproperty list uchar int vertex_indices\n"
+            << "end_header\n";
+        for (size_t i = 0; i < numVerts; i++) {
+            const auto& v = vert(i);
+            for (int k = 0; k < 3; k++) out.WriteLittleEndian(v.pos[k]);
+            if (normals) {
+                for (int k = 0; k < 3; k++) out.WriteLittleEndian(v.normal[k]);
+            }
+            if (colors) {
+                for (int k = 0; k < 3; k++) {
+                    const float c = glm::clamp(v.color[k], 0.f, 1.f);
+                    out << static_cast<char>(static_cast<unsigned char>(c * 255.f + 0.5f));
+                }
+            }
+        }
+        for (size_t i = 0; i < numTris; i++) {
+            const glm::uvec3 t = tri(i);
+            out << char(3);
+            for (int k = 0; k < 3; k++) out.WriteLittleEndian(uint32_t(t[k]));
+        }
+    } else if (format == MeshFormat::StlBinary) {
+        char header[80] = {};
+        std::strncpy(header, title, sizeof(header) - 1);
+        out.Write(header, sizeof(header));
+        out.WriteLittleEndian(uint32_t(numTris));
+        for (size_t i = 0; i < numTris; i++) {
+            const glm::uvec3 t = tri(i);
+            const glm::vec3 p[3] = {vert(t[0]).pos, vert(t[1]).pos, vert(t[2]).pos};
+            const glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+            const float len = glm::length(n);
+            const glm::vec3 normal = len > 0 ? n / len : n;
+            for (int k = 0; k < 3; k++) out.WriteLittleEndian(normal[k]);
+            for (int c = 0; c < 3; c++) {
+                for (int k = 0; k < 3; k++) out.WriteLittleEndian(p[c][k]);
+            }
+            // Attribute byte count, unused
+            out << char(0) << char(0);
+        }
+    } else {
+        out << "# " << title << " obj streamer\n# M&A 2008\n\n";
+        out << "# Vertices\n";
+        for (size_t i = 0; i < numVerts; i++) {
+            const glm::vec3& p = vert(i).pos;
+            out << "v " << p[0] << ' ' << p[1] << ' ' << p[2] << '\n';
+        }
+        out << "\n# Faces\n";
+        for (size_t i = 0; i < numTris; i++) {
+            const glm::uvec3 t = tri(i);
+            out << "f " << t[0] + 1 << ' ' << t[1] + 1 << ' ' << t[2] + 1 << '\n';
+        }
+    }
+    return out.Flush();
+}
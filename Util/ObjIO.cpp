@@ -11,112 +11,328 @@
  *************************************************************************************************/
 #include "ObjIO.h"
 #include "Geometry/HalfEdgeMesh.h"
-#include <cassert>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <iterator>
 #include <string>
 #include <vector>
+#include <Util/HashIndex.h>
+#include <Util/MappedFile.h>
+#include <Util/ThreadPool.h>
 #include <Util/Util.h>
 
-bool ObjIO::Load(Mesh* mesh, std::istream& is) {
-    // std::cerr << "Reading obj file.\nOutputting any skipped line(s) for
-    // reference.\n";
-    bool success = ReadHeader(is);
-    if (!success) {
+namespace {
+// Bytes of the file parsed by one task
+const size_t ChunkSize = 1 << 20;
+// Chunks whose faces are parsed at a time while streaming
+const size_t StreamBatch = 16;
+
+// What was read from one chunk of the file. Faces are already split into
+// triangles. Relative corners can only be resolved once the number of
+// vertices in the earlier chunks is known, until then they hold an index
+// into the chunk's own vertices (possibly negative) and are listed in
+// relativeCorners.
+struct Chunk {
+    Chunk() : numVerts(0), numLines(0), errorLine(0) {}
+
+    std::vector<glm::vec3> verts;
+    // Vertex lines in the chunk, also when verts are not kept
+    size_t numVerts;
+    std::vector<int64_t> corners;
+    std::vector<size_t> relativeCorners;
+    size_t numLines;
+    // Line in the chunk of the first error, if error is set
+    size_t errorLine;
+    std::string error;
+};
+
+inline const char* SkipSpace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+inline const char* SkipToken(const char* p, const char* end) {
+    while (p < end && *p != ' ' && *p != '\t') p++;
+    return p;
+}
+
+// True if the line starts with the single letter keyword c (v, f, ...)
+inline bool IsKeyword(const char* p, const char* end, char c) {
+    return end - p >= 2 && (p[0] == c || p[0] == c - 'a' + 'A') && (p[1] == ' ' || p[1] == '\t');
+}
+
+bool ParseFloat(const char*& p, const char* end, float& value) {
+    p = SkipSpace(p, end);
+    // from_chars does not accept an explicit plus sign
+    if (p < end && *p == '+') p++;
+    const std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec == std::errc::invalid_argument) return false;
+    // Values outside the float range are read as zero
+    if (result.ec == std::errc::result_out_of_range) value = 0.f;
+    p = result.ptr;
+    return true;
+}
+
+// Parses the vertex lines if verts is set and the face lines if faces is set
+void ParseChunk(const char* begin, const char* end, Chunk& chunk, bool verts = true,
+                bool faces = true) {
+    std::vector<int64_t> polygon;
+    std::vector<uint8_t> relative;
+
+    for (const char* line = begin; line < end; chunk.numLines++) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        const char* next = lineEnd ? lineEnd + 1 : end;
+        if (!lineEnd) lineEnd = end;
+        if (lineEnd > line && lineEnd[-1] == '\r') lineEnd--;
+        // Comments run to the end of the line, also behind a statement
+        const char* comment = static_cast<const char*>(std::memchr(line, '#', lineEnd - line));
+        if (comment) lineEnd = comment;
+
+        const char* p = SkipSpace(line, lineEnd);
+        if (IsKeyword(p, lineEnd, 'v')) {
+            chunk.numVerts++;
+            if (!verts) {
+                line = next;
+                continue;
+            }
+            glm::vec3 v;
+            p += 2;
+            if (!ParseFloat(p, lineEnd, v[0]) || !ParseFloat(p, lineEnd, v[1]) ||
+                !ParseFloat(p, lineEnd, v[2])) {
+                chunk.error = "Bad vertex";
+                break;
+            }
+            chunk.verts.push_back(v);
+        } else if (faces && IsKeyword(p, lineEnd, 'f')) {
+            polygon.clear();
+            relative.clear();
+            for (p = SkipSpace(p + 2, lineEnd); p < lineEnd; p = SkipSpace(p, lineEnd)) {
+                // Only the vertex index is used, the texture and normal indices are skipped
+                int64_t index = 0;
+                const std::from_chars_result result = std::from_chars(p, lineEnd, index);
+                if (result.ec != std::errc() || index == 0) {
+                    polygon.clear();
+                    break;
+                }
+                p = SkipToken(result.ptr, lineEnd);
+                // obj indices start at 1, negative ones count back from the last vertex
+                if (index > 0) {
+                    polygon.push_back(index - 1);
+                    relative.push_back(0);
+                } else {
+                    polygon.push_back(static_cast<int64_t>(chunk.numVerts) + index);
+                    relative.push_back(1);
+                }
+            }
+            if (polygon.size() < 3) {
+                chunk.error = "Bad face";
+                break;
+            }
+            for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                const size_t fan[3] = {0, i, i + 1};
+                for (size_t corner : fan) {
+                    if (relative[corner]) chunk.relativeCorners.push_back(chunk.corners.size());
+                    chunk.corners.push_back(polygon[corner]);
+                }
+            }
+        }
+        // Anything else (normals, texture coordinates, groups, ...) is skipped
+        line = next;
+    }
+    if (!chunk.error.empty()) chunk.errorLine = chunk.numLines;
+}
+
+// Chunk borders moved forward to the next line start
+std::vector<const char*> FindChunks(const char* begin, const char* end) {
+    std::vector<const char*> borders(1, begin);
+    while (borders.back() < end) {
+        const char* p = borders.back() + std::min<size_t>(ChunkSize, end - borders.back());
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        borders.push_back(nl ? nl + 1 : end);
+    }
+    return borders;
+}
+}  // namespace
+
+bool ObjIO::Load(Mesh* mesh, const std::string& filename) {
+    MappedFile file;
+    if (!file.Open(filename)) {
         return false;
     }
+    if (!Parse(file.data(), file.data() + file.size())) {
+        return false;
+    }
+    return Build(mesh);
+}
 
-    success = ReadData(is);
-    if (!success) {
+bool ObjIO::Load(Mesh* mesh, std::istream& is) {
+    const std::string buf((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    if (!Parse(buf.data(), buf.data() + buf.size())) {
         return false;
     }
+    return Build(mesh);
+}
 
-    // Build mesh
-    const size_t numTris = loadData.tris.size();
-    for (size_t t = 0; t < numTris; t++) {
-        glm::uvec3& triangle = loadData.tris[t];
-        std::vector<glm::vec3> verts;
-        verts.push_back(loadData.verts[triangle[0]]);
-        verts.push_back(loadData.verts[triangle[1]]);
-        verts.push_back(loadData.verts[triangle[2]]);
+bool ObjIO::Build(Mesh* mesh) {
+    // Duplicated positions are welded like AddFace would do
+    WeldVertices(loadData.verts, loadData.tris);
 
-        mesh->AddFace(verts);
+    // Build mesh, meshes that can't take the indexed data get one face at a time
+    if (mesh->Build(loadData.verts, loadData.tris)) {
+        return true;
     }
-    return true;
+    std::cerr << "Falling back to adding faces one by one" << std::endl;
+    return mesh->Mesh::Build(loadData.verts.data(), loadData.verts.size(), loadData.tris.data(),
+                             loadData.tris.size());
 }
 
-bool ObjIO::ReadHeader(std::istream& is) {
-    std::string buf;
-    // just read to the first line starting with a 'v'
-    while (!is.eof() && is.peek() != 'v') {
-        getline(is, buf);
-        // std::cerr << "\"" << buf << "\"\n";
+/*!
+ * The chunk borders are moved forward to the next line start, so every
+ * line is parsed by exactly one task and the split does not depend on
+ * the number of threads. The chunks are then joined in file order.
+ */
+bool ObjIO::Parse(const char* begin, const char* end) {
+    loadData.verts.clear();
+    loadData.tris.clear();
+
+    const std::vector<const char*> borders = FindChunks(begin, end);
+    const size_t numChunks = borders.size() - 1;
+
+    std::vector<Chunk> chunks(numChunks);
+    ParallelFor(
+        0, numChunks, [&](size_t i) { ParseChunk(borders[i], borders[i + 1], chunks[i]); }, 1);
+
+    // Where the vertices and triangles of each chunk go
+    std::vector<size_t> vertOffset(numChunks + 1, 0), triOffset(numChunks + 1, 0);
+    size_t line = 1;
+    for (size_t i = 0; i < numChunks; i++) {
+        if (!chunks[i].error.empty()) {
+            std::cerr << "Error: " << chunks[i].error << " on line " << line + chunks[i].errorLine
+                      << std::endl;
+            return false;
+        }
+        line += chunks[i].numLines;
+        vertOffset[i + 1] = vertOffset[i] + chunks[i].verts.size();
+        triOffset[i + 1] = triOffset[i] + chunks[i].corners.size() / 3;
     }
-    return is.good();
+
+    const int64_t numVerts = static_cast<int64_t>(vertOffset[numChunks]);
+    loadData.verts.resize(vertOffset[numChunks]);
+    loadData.tris.resize(triOffset[numChunks]);
+    std::atomic<bool> badIndex(false);
+    ParallelFor(
+        0, numChunks,
+        [&](size_t i) {
+            Chunk& chunk = chunks[i];
+            std::copy(chunk.verts.begin(), chunk.verts.end(),
+                      loadData.verts.begin() + vertOffset[i]);
+            for (size_t corner : chunk.relativeCorners) {
+                chunk.corners[corner] += static_cast<int64_t>(vertOffset[i]);
+            }
+            for (size_t c = 0; c < chunk.corners.size(); c++) {
+                if (chunk.corners[c] < 0 || chunk.corners[c] >= numVerts) badIndex = true;
+                loadData.tris[triOffset[i] + c / 3][c % 3] =
+                    static_cast<unsigned int>(chunk.corners[c]);
+            }
+        },
+        1);
+    if (badIndex) {
+        std::cerr << "Error: face refers to a vertex that does not exist" << std::endl;
+        loadData.tris.clear();
+        return false;
+    }
+    return true;
 }
 
-bool ObjIO::ReadData(std::istream& is) {
-    std::string lineBuf;
-    int c;
-    int i = 0;
-    while (!is.eof()) {
-        c = is.peek();
-        switch (c) {
-            case 'V':
-            case 'v': {
-                std::string startBuf;
-                is >> startBuf;        // get the start of the line
-                getline(is, lineBuf);  // get the rest of the line
-                if (startBuf == "v") {
-                    loadData.verts.push_back(vec3<float>(lineBuf));
-                }
-            } break;
-            case 'F':
-            case 'f': {
-                std::stringstream buf;
-                is.get(*buf.rdbuf(), '\n');  // read a line into buf
-                is.get();                    // read the not extracted \n
-                buf << "\n";                 // and add it to the string stream
-
-                std::string tmp;
-                buf >> tmp;  // get the first f or F (+ whitespace)
-
-                // count the number of faces, delimited by whitespace
-                int count = 0;
-                while (buf >> tmp) {
-                    count++;
-                }
-                // reset stream
-                buf.clear();
-                buf.seekg(0, std::ios::beg);
+/*!
+ * The vertices are read first, in parallel like Parse does, to find the
+ * bounding box for the sink. The faces are then parsed in batches of
+ * StreamBatch chunks and handed over in file order, so only the corners
+ * of one batch are held at a time.
+ */
+bool ObjIO::Stream(TriangleSink* sink, const std::string& filename) {
+    MappedFile file;
+    if (!file.Open(filename)) {
+        return false;
+    }
+    const std::vector<const char*> borders = FindChunks(file.data(), file.data() + file.size());
+    const size_t numChunks = borders.size() - 1;
 
-                // Determine wheter we have a triangle or a quad
-                if (count == 3) {
-                    loadData.tris.push_back(ReadTri(buf));
-                } else {
-                    std::cerr << "Encountered polygon with " << count << " faces. Bailing out.\n";
+    std::vector<Chunk> chunks(numChunks);
+    ParallelFor(
+        0, numChunks,
+        [&](size_t i) { ParseChunk(borders[i], borders[i + 1], chunks[i], true, false); }, 1);
+
+    // First vertex and line of each chunk
+    std::vector<size_t> vertOffset(numChunks + 1, 0), lineOffset(numChunks + 1, 1);
+    for (size_t i = 0; i < numChunks; i++) {
+        if (!chunks[i].error.empty()) {
+            std::cerr << "Error: " << chunks[i].error << " on line "
+                      << lineOffset[i] + chunks[i].errorLine << std::endl;
+            return false;
+        }
+        lineOffset[i + 1] = lineOffset[i] + chunks[i].numLines;
+        vertOffset[i + 1] = vertOffset[i] + chunks[i].verts.size();
+    }
+
+    std::vector<glm::vec3>& verts = loadData.verts;
+    verts.resize(vertOffset[numChunks]);
+    loadData.tris.clear();
+    ParallelFor(
+        0, numChunks,
+        [&](size_t i) {
+            std::copy(chunks[i].verts.begin(), chunks[i].verts.end(),
+                      verts.begin() + vertOffset[i]);
+            chunks[i] = Chunk();
+        },
+        1);
+
+    glm::vec3 min(0.f), max(0.f);
+    if (!verts.empty()) {
+        min = max = verts[0];
+        for (const glm::vec3& v : verts) {
+            min = glm::min(min, v);
+            max = glm::max(max, v);
+        }
+    }
+    sink->BeginTriangles(min, max);
+
+    const int64_t numVerts = static_cast<int64_t>(verts.size());
+    for (size_t first = 0; first < numChunks; first += StreamBatch) {
+        const size_t last = std::min(numChunks, first + StreamBatch);
+        ParallelFor(
+            first, last,
+            [&](size_t i) { ParseChunk(borders[i], borders[i + 1], chunks[i], false, true); },
+            1);
+
+        for (size_t i = first; i < last; i++) {
+            Chunk& chunk = chunks[i];
+            if (!chunk.error.empty()) {
+                std::cerr << "Error: " << chunk.error << " on line "
+                          << lineOffset[i] + chunk.errorLine << std::endl;
+                return false;
+            }
+            for (size_t corner : chunk.relativeCorners) {
+                chunk.corners[corner] += static_cast<int64_t>(vertOffset[i]);
+            }
+            for (size_t c = 0; c < chunk.corners.size(); c += 3) {
+                const int64_t* t = &chunk.corners[c];
+                if (std::min(t[0], std::min(t[1], t[2])) < 0 ||
+                    std::max(t[0], std::max(t[1], t[2])) >= numVerts) {
+                    std::cerr << "Error: face refers to a vertex that does not exist"
+                              << std::endl;
                     return false;
                 }
-            } break;
-            default:
-                // otherwise just skip the row
-                getline(is, lineBuf);
-                // output it so we see what we miss :)
-                // std::cerr << "\"" << lineBuf << "\"\n";
-                break;
+                sink->AddTriangle(verts[t[0]], verts[t[1]], verts[t[2]]);
+            }
+            chunk = Chunk();
         }
-        i++;
     }
-    return true;
-}
-
-glm::uvec3 ObjIO::ReadTri(std::istream& is) {
-    //  This is a simplified version of an obj reader that can't read normal and
-    //  texture indices
-    std::string buf, v;
-    is >> buf;
-    assert(buf == "f" || buf == "F");
+    sink->EndTriangles();
 
-    getline(is, v);                                      // read indices
-    return vec3<unsigned int>(v) - glm::uvec3(1, 1, 1);  // obj file format is 1-based
+    std::vector<glm::vec3>().swap(verts);
+    return true;
 }
@@ -13,23 +13,39 @@
 #define __obj_io_h__
 
 #include "Geometry/Mesh.h"
+#include "Util/TriangleSink.h"
 #include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <glm.hpp>
 
+/*! \brief Reads Wavefront obj files into a mesh.
+ * Only vertex positions and faces are used. Faces may have any number of
+ * corners given as v, v/vt, v//vn or v/vt/vn with absolute or relative
+ * (negative) indices, polygons are split into triangle fans. The file is
+ * cut into newline aligned chunks that are parsed in parallel.
+ */
 class ObjIO {
 public:
     ObjIO() {}
 
+    //! Loads a file through a memory mapping, false return on error
+    bool Load(Mesh*, const std::string& filename);
     bool Load(Mesh*, std::istream& is);  // false return on error
 
+    /*! Hands the triangles of a file to sink one by one, without building
+     * the triangle list. Only the positions are kept in memory. False
+     * return on error.
+     */
+    bool Stream(TriangleSink* sink, const std::string& filename);
+
 protected:
-    bool ReadHeader(std::istream& is);
-    bool ReadData(std::istream& is);
+    //! Parses a whole obj file held in memory into loadData
+    bool Parse(const char* begin, const char* end);
 
-    static glm::uvec3 ReadTri(std::istream& is);
+    //! Builds mesh from loadData
+    bool Build(Mesh* mesh);
 
     struct LoadData {
         std::vector<glm::vec3> verts;
@@ -0,0 +1,595 @@
+#include "PlyIO.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <Util/MappedFile.h>
+#include <Util/ThreadPool.h>
+#include <Util/Util.h>
+
+namespace {
+enum class PlyType { Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64 };
+
+bool ParseType(const std::string& name, PlyType& type) {
+    static const struct {
+        const char* name;
+        PlyType type;
+    } types[] = {{"char", PlyType::Int8},      {"int8", PlyType::Int8},
+                 {"uchar", PlyType::Uint8},    {"uint8", PlyType::Uint8},
+                 {"short", PlyType::Int16},    {"int16", PlyType::Int16},
+                 {"ushort", PlyType::Uint16},  {"uint16", PlyType::Uint16},
+                 {"int", PlyType::Int32},      {"int32", PlyType::Int32},
+                 {"uint", PlyType::Uint32},    {"uint32", PlyType::Uint32},
+                 {"float", PlyType::Float32},  {"float32", PlyType::Float32},
+                 {"double", PlyType::Float64}, {"float64", PlyType::Float64}};
+    for (const auto& t : types) {
+        if (name == t.name) {
+            type = t.type;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t TypeSize(PlyType type) {
+    switch (type) {
+        case PlyType::Int8:
+        case PlyType::Uint8:
+            return 1;
+        case PlyType::Int16:
+        case PlyType::Uint16:
+            return 2;
+        case PlyType::Int32:
+        case PlyType::Uint32:
+        case PlyType::Float32:
+            return 4;
+        case PlyType::Float64:
+            return 8;
+    }
+    return 0;
+}
+
+// Value of full intensity for colors of the type
+double ColorScale(PlyType type) {
+    switch (type) {
+        case PlyType::Int8:
+            return 127.0;
+        case PlyType::Uint8:
+            return 255.0;
+        case PlyType::Int16:
+            return 32767.0;
+        case PlyType::Uint16:
+            return 65535.0;
+        case PlyType::Int32:
+            return 2147483647.0;
+        case PlyType::Uint32:
+            return 4294967295.0;
+        default:
+            return 1.0;
+    }
+}
+
+template <typename T>
+inline T ReadAs(const char* p, bool swap) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    if (swap) EndianSwap(&value, 1);
+    return value;
+}
+
+// Reads one value of the given type, swapping it if the file byte order is not the host's
+double ReadValue(const char* p, PlyType type, bool swap) {
+    switch (type) {
+        case PlyType::Int8:
+            return ReadAs<int8_t>(p, swap);
+        case PlyType::Uint8:
+            return ReadAs<uint8_t>(p, swap);
+        case PlyType::Int16:
+            return ReadAs<int16_t>(p, swap);
+        case PlyType::Uint16:
+            return ReadAs<uint16_t>(p, swap);
+        case PlyType::Int32:
+            return ReadAs<int32_t>(p, swap);
+        case PlyType::Uint32:
+            return ReadAs<uint32_t>(p, swap);
+        case PlyType::Float32:
+            return ReadAs<float>(p, swap);
+        case PlyType::Float64:
+            return ReadAs<double>(p, swap);
+    }
+    return 0.0;
+}
+
+// Reads a list length or index, negative values are returned as a huge index
+size_t ReadIndex(const char* p, PlyType type, bool swap) {
+    const double value = ReadValue(p, type, swap);
+    return value < 0.0 ? size_t(-1) : static_cast<size_t>(value);
+}
+
+struct Property {
+    std::string name;
+    // Type of the value, or of the entries of a list
+    PlyType type;
+    // Type of the number of entries of a list
+    PlyType countType;
+    bool list;
+};
+
+struct Element {
+    std::string name;
+    size_t count;
+    std::vector<Property> props;
+
+    // Size of every record, zero if there are lists and the size varies
+    size_t RecordSize() const {
+        size_t size = 0;
+        for (const Property& prop : props) {
+            if (prop.list) return 0;
+            size += TypeSize(prop.type);
+        }
+        return size;
+    }
+
+    // Byte offset of a property in records without lists, -1 if it is missing
+    std::ptrdiff_t Offset(const char* name) const {
+        std::ptrdiff_t offset = 0;
+        for (const Property& prop : props) {
+            if (prop.name == name) return offset;
+            offset += TypeSize(prop.type);
+        }
+        return -1;
+    }
+
+    const Property* Find(const char* name) const {
+        for (const Property& prop : props) {
+            if (prop.name == name) return &prop;
+        }
+        return NULL;
+    }
+};
+
+/*
+ * Reads the header up to and including the end_header line. p is left at
+ * the first byte of the data.
+ */
+bool ParseHeader(const char*& p, const char* end, bool& bigEndian, std::vector<Element>& elements) {
+    bool haveFormat = false;
+    for (size_t lineNumber = 1; p < end; lineNumber++) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd) break;
+        std::istringstream line(std::string(p, lineEnd));
+        p = lineEnd + 1;
+
+        std::string keyword;
+        line >> keyword;
+        if (lineNumber == 1) {
+            if (keyword != "ply") {
+                std::cerr << "Error: not a ply file" << std::endl;
+                return false;
+            }
+        } else if (keyword == "format") {
+            std::string format;
+            line >> format;
+            if (format == "binary_little_endian" || format == "binary_big_endian") {
+                bigEndian = format == "binary_big_endian";
+                haveFormat = true;
+            } else {
+                std::cerr << "Error: ply format '" << format << "' is not supported" << std::endl;
+                return false;
+            }
+        } else if (keyword == "element") {
+            Element element;
+            if (!(line >> element.name >> element.count)) {
+                std::cerr << "Error: bad element on ply header line " << lineNumber << std::endl;
+                return false;
+            }
+            elements.push_back(element);
+        } else if (keyword == "property") {
+            Property prop;
+            std::string type;
+            line >> type;
+            prop.list = type == "list";
+            bool ok = !elements.empty();
+            if (prop.list) {
+                std::string countType;
+                line >> countType >> type;
+                ok = ok && ParseType(countType, prop.countType);
+            }
+            ok = ok && ParseType(type, prop.type) && (line >> prop.name);
+            if (!ok) {
+                std::cerr << "Error: bad property on ply header line " << lineNumber << std::endl;
+                return false;
+            }
+            elements.back().props.push_back(prop);
+        } else if (keyword == "end_header") {
+            if (!haveFormat) {
+                std::cerr << "Error: ply header has no format" << std::endl;
+                return false;
+            }
+            return true;
+        }
+        // comment, obj_info and unknown keywords are skipped
+    }
+    std::cerr << "Error: ply header has no end_header" << std::endl;
+    return false;
+}
+
+// Moves p past one property, false if it runs past end
+bool SkipProperty(const Property& prop, const char*& p, const char* end, bool swap) {
+    size_t size = TypeSize(prop.type);
+    if (prop.list) {
+        if (TypeSize(prop.countType) > size_t(end - p)) return false;
+        const size_t count = ReadIndex(p, prop.countType, swap);
+        p += TypeSize(prop.countType);
+        if (count > size_t(end - p) / size) return false;
+        size *= count;
+    }
+    if (size > size_t(end - p)) return false;
+    p += size;
+    return true;
+}
+
+// Moves p past one record with lists, false if it runs past end
+bool SkipRecord(const Element& element, const char*& p, const char* end, bool swap) {
+    for (const Property& prop : element.props) {
+        if (!SkipProperty(prop, p, end, swap)) return false;
+    }
+    return true;
+}
+
+// Moves p past all records of an element that is not read
+bool SkipElement(const Element& element, const char*& p, const char* end, bool swap) {
+    const size_t recordSize = element.RecordSize();
+    if (recordSize > 0) {
+        p += element.count * recordSize;
+        return true;
+    }
+    for (size_t i = 0; i < element.count; i++) {
+        if (!SkipRecord(element, p, end, swap)) {
+            std::cerr << "Error: ply file is truncated in element " << element.name << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Where x, y and z are in the vertex records, false if they are missing
+bool FindPositions(const Element& element, std::ptrdiff_t pos[3], PlyType posType[3]) {
+    const char* names[3] = {"x", "y", "z"};
+    for (int k = 0; k < 3; k++) {
+        pos[k] = element.Offset(names[k]);
+        if (element.RecordSize() == 0 || pos[k] < 0) {
+            std::cerr << "Error: ply vertices need x, y, z and no lists" << std::endl;
+            return false;
+        }
+        posType[k] = element.Find(names[k])->type;
+    }
+    return true;
+}
+
+// The list of corners of the face records, NULL if there is none
+const Property* FindIndices(const Element& element) {
+    const Property* indices = element.Find("vertex_indices");
+    if (!indices) indices = element.Find("vertex_index");
+    if (!indices || !indices->list) {
+        std::cerr << "Error: ply faces have no vertex_indices list" << std::endl;
+        return NULL;
+    }
+    return indices;
+}
+
+/*
+ * Walks the face records from p one by one and calls fn(first, prev, curr)
+ * for every triangle of their fans. Returns false if a face is bad or
+ * truncated, or if fn returns false.
+ */
+template <typename Fn>
+bool ForEachFaceTriangle(const Element& element, const Property* indices, const char*& p,
+                         const char* end, bool swap, Fn fn) {
+    const size_t countSize = TypeSize(indices->countType);
+    const size_t indexSize = TypeSize(indices->type);
+    for (size_t i = 0; i < element.count; i++) {
+        for (const Property& prop : element.props) {
+            if (&prop != indices) {
+                if (!SkipProperty(prop, p, end, swap)) {
+                    std::cerr << "Error: ply file is truncated in face " << i << std::endl;
+                    return false;
+                }
+                continue;
+            }
+            const size_t count =
+                countSize <= size_t(end - p) ? ReadIndex(p, prop.countType, swap) : 0;
+            p += countSize;
+            if (count < 3 || count > size_t(end - p) / indexSize) {
+                std::cerr << "Error: bad or truncated ply face " << i << std::endl;
+                return false;
+            }
+            const size_t first = ReadIndex(p, prop.type, swap);
+            size_t prev = ReadIndex(p + indexSize, prop.type, swap);
+            for (size_t k = 2; k < count; k++) {
+                const size_t curr = ReadIndex(p + k * indexSize, prop.type, swap);
+                if (!fn(first, prev, curr)) return false;
+                prev = curr;
+            }
+            p += count * indexSize;
+        }
+    }
+    return true;
+}
+}  // namespace
+
+bool PlyIO::Load(Mesh* mesh, const std::string& filename) {
+    MappedFile file;
+    if (!file.Open(filename)) {
+        return false;
+    }
+    if (!Parse(file.data(), file.data() + file.size())) {
+        return false;
+    }
+    return Build(mesh);
+}
+
+bool PlyIO::Load(Mesh* mesh, std::istream& is) {
+    const std::string buf((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    if (!Parse(buf.data(), buf.data() + buf.size())) {
+        return false;
+    }
+    return Build(mesh);
+}
+
+bool PlyIO::Build(Mesh* mesh) {
+    if (mesh->Build(loadData.verts, loadData.tris)) {
+        // The mesh kept the vertices in file order, so the attributes line up
+        mesh->SetVertexAttributes(loadData.normals.empty() ? NULL : loadData.normals.data(),
+                                  loadData.colors.empty() ? NULL : loadData.colors.data());
+        return true;
+    }
+    std::cerr << "Falling back to adding faces one by one, vertex attributes are dropped"
+              << std::endl;
+    return mesh->Mesh::Build(loadData.verts.data(), loadData.verts.size(), loadData.tris.data(),
+                             loadData.tris.size());
+}
+
+/*!
+ * Records of a fixed size, which vertices normally are, are decoded in
+ * parallel. Faces are as well if they all turn out to be triangles,
+ * otherwise they are walked one by one. Polygons are fanned straight into
+ * the triangle list as their indices are read.
+ */
+bool PlyIO::Parse(const char* begin, const char* end) {
+    loadData.verts.clear();
+    loadData.tris.clear();
+    loadData.normals.clear();
+    loadData.colors.clear();
+
+    const char* p = begin;
+    bool bigEndian = false;
+    std::vector<Element> elements;
+    if (!ParseHeader(p, end, bigEndian, elements)) {
+        return false;
+    }
+    const bool swap = bigEndian != IsBigEndian();
+
+    for (const Element& element : elements) {
+        const size_t recordSize = element.RecordSize();
+        if (recordSize > 0 && element.count > size_t(end - p) / recordSize) {
+            std::cerr << "Error: ply file is truncated in element " << element.name << std::endl;
+            return false;
+        }
+
+        if (element.name == "vertex") {
+            std::ptrdiff_t pos[3];
+            PlyType posType[3], normalType[3], colorType[3];
+            if (!FindPositions(element, pos, posType)) {
+                return false;
+            }
+            const std::ptrdiff_t normal[3] = {element.Offset("nx"), element.Offset("ny"),
+                                              element.Offset("nz")};
+            const std::ptrdiff_t color[3] = {element.Offset("red"), element.Offset("green"),
+                                             element.Offset("blue")};
+            const bool hasNormals = normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0;
+            const bool hasColors = color[0] >= 0 && color[1] >= 0 && color[2] >= 0;
+            const char* names[6] = {"nx", "ny", "nz", "red", "green", "blue"};
+            for (int k = 0; k < 3; k++) {
+                if (hasNormals) normalType[k] = element.Find(names[k])->type;
+                if (hasColors) colorType[k] = element.Find(names[3 + k])->type;
+            }
+
+            loadData.verts.resize(element.count);
+            if (hasNormals) loadData.normals.resize(element.count);
+            if (hasColors) loadData.colors.resize(element.count);
+            ParallelFor(0, element.count, [&](size_t i) {
+                const char* record = p + i * recordSize;
+                for (int k = 0; k < 3; k++) {
+                    loadData.verts[i][k] =
+                        static_cast<float>(ReadValue(record + pos[k], posType[k], swap));
+                    if (hasNormals) {
+                        loadData.normals[i][k] = static_cast<float>(
+                            ReadValue(record + normal[k], normalType[k], swap));
+                    }
+                    if (hasColors) {
+                        loadData.colors[i][k] = static_cast<float>(
+                            ReadValue(record + color[k], colorType[k], swap) /
+                            ColorScale(colorType[k]));
+                    }
+                }
+            });
+            p += element.count * recordSize;
+        } else if (element.name == "face") {
+            const Property* indices = FindIndices(element);
+            if (!indices) {
+                return false;
+            }
+            const size_t countSize = TypeSize(indices->countType);
+            const size_t indexSize = TypeSize(indices->type);
+
+            // All faces are triangles if the records are of the triangle size and say so
+            size_t fixedSize = 0, listOffset = 0, numLists = 0;
+            for (const Property& prop : element.props) {
+                if (prop.list) {
+                    numLists++;
+                } else {
+                    fixedSize += TypeSize(prop.type);
+                    if (numLists == 0) listOffset += TypeSize(prop.type);
+                }
+            }
+            const size_t triangleSize = fixedSize + countSize + 3 * indexSize;
+            std::atomic<bool> allTriangles(numLists == 1 &&
+                                           element.count <= size_t(end - p) / triangleSize);
+            if (allTriangles) {
+                ParallelFor(0, element.count, [&](size_t i) {
+                    const char* record = p + i * triangleSize + listOffset;
+                    if (ReadIndex(record, indices->countType, swap) != 3) allTriangles = false;
+                });
+            }
+
+            if (allTriangles) {
+                loadData.tris.resize(element.count);
+                ParallelFor(0, element.count, [&](size_t i) {
+                    const char* record = p + i * triangleSize + listOffset + countSize;
+                    for (int k = 0; k < 3; k++) {
+                        loadData.tris[i][k] = static_cast<unsigned int>(
+                            ReadIndex(record + k * indexSize, indices->type, swap));
+                    }
+                });
+                p += element.count * triangleSize;
+                continue;
+            }
+
+            loadData.tris.reserve(element.count);
+            const bool ok = ForEachFaceTriangle(
+                element, indices, p, end, swap, [&](size_t first, size_t prev, size_t curr) {
+                    loadData.tris.push_back(glm::uvec3(first, prev, curr));
+                    return true;
+                });
+            if (!ok) {
+                return false;
+            }
+        } else if (!SkipElement(element, p, end, swap)) {
+            return false;
+        }
+    }
+
+    const size_t numVerts = loadData.verts.size();
+    std::atomic<bool> badIndex(false);
+    ParallelFor(0, loadData.tris.size(), [&](size_t i) {
+        const glm::uvec3& t = loadData.tris[i];
+        if (t[0] >= numVerts || t[1] >= numVerts || t[2] >= numVerts) badIndex = true;
+    });
+    if (badIndex) {
+        std::cerr << "Error: face refers to a vertex that does not exist" << std::endl;
+        loadData.tris.clear();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ * Nothing of the size of the mesh is allocated: the corners are decoded
+ * straight from the vertex records in the mapped file, and the faces are
+ * walked one by one into the sink, polygons as fans.
+ */
+bool PlyIO::Stream(TriangleSink* sink, const std::string& filename) {
+    MappedFile file;
+    if (!file.Open(filename)) {
+        return false;
+    }
+    const char* p = file.data();
+    const char* end = file.data() + file.size();
+    bool bigEndian = false;
+    std::vector<Element> elements;
+    if (!ParseHeader(p, end, bigEndian, elements)) {
+        return false;
+    }
+    const bool swap = bigEndian != IsBigEndian();
+
+    const char* vertexData = NULL;
+    size_t numVerts = 0, vertexSize = 0;
+    std::ptrdiff_t pos[3];
+    PlyType posType[3];
+    auto position = [&](size_t i) {
+        const char* record = vertexData + i * vertexSize;
+        glm::vec3 v;
+        for (int k = 0; k < 3; k++) {
+            v[k] = static_cast<float>(ReadValue(record + pos[k], posType[k], swap));
+        }
+        return v;
+    };
+
+    for (const Element& element : elements) {
+        const size_t recordSize = element.RecordSize();
+        if (recordSize > 0 && element.count > size_t(end - p) / recordSize) {
+            std::cerr << "Error: ply file is truncated in element " << element.name << std::endl;
+            return false;
+        }
+
+        if (element.name == "vertex") {
+            if (!FindPositions(element, pos, posType)) {
+                return false;
+            }
+            vertexData = p;
+            numVerts = element.count;
+            vertexSize = recordSize;
+            p += element.count * recordSize;
+
+            typedef std::pair<glm::vec3, glm::vec3> Box;
+            const Box empty(glm::vec3(std::numeric_limits<float>::max()),
+                            glm::vec3(-std::numeric_limits<float>::max()));
+            const Box box = ParallelReduce(
+                size_t(0), numVerts, empty,
+                [&](size_t b, size_t e) {
+                    Box part = empty;
+                    for (size_t i = b; i < e; i++) {
+                        const glm::vec3 v = position(i);
+                        part.first = glm::min(part.first, v);
+                        part.second = glm::max(part.second, v);
+                    }
+                    return part;
+                },
+                [](const Box& a, const Box& b) {
+                    return Box(glm::min(a.first, b.first), glm::max(a.second, b.second));
+                });
+            if (numVerts > 0) {
+                sink->BeginTriangles(box.first, box.second);
+            } else {
+                sink->BeginTriangles(glm::vec3(0.f), glm::vec3(0.f));
+            }
+        } else if (element.name == "face") {
+            if (!vertexData) {
+                std::cerr << "Error: ply faces before the vertices can't be streamed" << std::endl;
+                return false;
+            }
+            const Property* indices = FindIndices(element);
+            if (!indices) {
+                return false;
+            }
+            bool badIndex = false;
+            const bool ok = ForEachFaceTriangle(
+                element, indices, p, end, swap, [&](size_t first, size_t prev, size_t curr) {
+                    if (first >= numVerts || prev >= numVerts || curr >= numVerts) {
+                        badIndex = true;
+                        return false;
+                    }
+                    sink->AddTriangle(position(first), position(prev), position(curr));
+                    return true;
+                });
+            if (!ok) {
+                if (badIndex) {
+                    std::cerr << "Error: face refers to a vertex that does not exist" << std::endl;
+                }
+                return false;
+            }
+        } else if (!SkipElement(element, p, end, swap)) {
+            return false;
+        }
+    }
+
+    if (!vertexData) {
+        std::cerr << "Error: ply file has no vertices" << std::endl;
+        return false;
+    }
+    sink->EndTriangles();
+    return true;
+}
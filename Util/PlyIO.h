@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Geometry/Mesh.h"
+#include "Util/TriangleSink.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm.hpp>
+
+/*! \brief Reads binary Stanford ply files into a mesh.
+ * Both binary_little_endian and binary_big_endian files are read on any
+ * machine. The vertex positions are required, normals (nx, ny, nz) and
+ * colors (red, green, blue) are optional and handed to the mesh through
+ * Mesh::SetVertexAttributes. Faces may be polygons, they are split into
+ * triangle fans. Other elements and properties are skipped. ply is an
+ * indexed format, so the vertices are not welded.
+ */
+class PlyIO {
+public:
+    PlyIO() {}
+
+    //! Loads a file through a memory mapping, false return on error
+    bool Load(Mesh*, const std::string& filename);
+    bool Load(Mesh*, std::istream& is);  // false return on error
+
+    /*! Hands the triangles of a file to sink one by one, without building
+     * the triangle list. The positions are read from the mapped file as
+     * they are needed, so the vertices have to come before the faces.
+     * False return on error.
+     */
+    bool Stream(TriangleSink* sink, const std::string& filename);
+
+protected:
+    //! Parses a whole ply file held in memory into loadData
+    bool Parse(const char* begin, const char* end);
+
+    //! Builds mesh from loadData
+    bool Build(Mesh* mesh);
+
+    struct LoadData {
+        std::vector<glm::vec3> verts;
+        std::vector<glm::uvec3> tris;
+        //! Empty if the file has no normals or colors
+        std::vector<glm::vec3> normals, colors;
+    } loadData;
+};
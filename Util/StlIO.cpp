@@ -0,0 +1,99 @@
+#include "StlIO.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <Util/HashIndex.h>
+#include <Util/MappedFile.h>
+#include <Util/ThreadPool.h>
+#include <Util/Util.h>
+
+namespace {
+// 80 byte header and the number of triangles
+const size_t HeaderSize = 84;
+// Normal, three corners and the attribute byte count
+const size_t TriangleSize = 50;
+}  // namespace
+
+bool StlIO::Load(Mesh* mesh, const std::string& filename) {
+    MappedFile file;
+    if (!file.Open(filename)) {
+        return false;
+    }
+    if (!Parse(file.data(), file.data() + file.size())) {
+        return false;
+    }
+    return Build(mesh);
+}
+
+bool StlIO::Load(Mesh* mesh, std::istream& is) {
+    const std::string buf((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    if (!Parse(buf.data(), buf.data() + buf.size())) {
+        return false;
+    }
+    return Build(mesh);
+}
+
+bool StlIO::Build(Mesh* mesh) {
+    if (mesh->Build(loadData.verts, loadData.tris)) {
+        return true;
+    }
+    std::cerr << "Falling back to adding faces one by one" << std::endl;
+    return mesh->Mesh::Build(loadData.verts.data(), loadData.verts.size(), loadData.tris.data(),
+                             loadData.tris.size());
+}
+
+/*!
+ * The triangles have a fixed size, so they are decoded in parallel straight
+ * into the corner and triangle arrays, corner c of triangle i becoming
+ * vertex 3i+c before welding.
+ */
+bool StlIO::Parse(const char* begin, const char* end) {
+    loadData.verts.clear();
+    loadData.tris.clear();
+
+    const size_t size = end - begin;
+    uint32_t numTris = 0;
+    if (size >= HeaderSize) {
+        std::memcpy(&numTris, begin + 80, 4);
+        if (IsBigEndian()) numTris = EndianSwap(numTris);
+    }
+    // Some writers pad the file, but it must hold all the triangles
+    if (size < HeaderSize || numTris > (size - HeaderSize) / TriangleSize) {
+        if (size >= 5 && std::strncmp(begin, "solid", 5) == 0) {
+            std::cerr << "Error: ascii stl is not supported" << std::endl;
+        } else {
+            std::cerr << "Error: stl file is truncated" << std::endl;
+        }
+        return false;
+    }
+
+    loadData.verts.resize(3 * size_t(numTris));
+    loadData.tris.resize(numTris);
+    ParallelFor(0, numTris, [&](size_t i) {
+        // Skip the normal
+        const char* corners = begin + HeaderSize + i * TriangleSize + 12;
+        for (size_t c = 0; c < 3; c++) {
+            glm::vec3& v = loadData.verts[3 * i + c];
+            std::memcpy(&v[0], corners + 12 * c, 12);
+            if (IsBigEndian()) EndianSwap(&v[0], 3);
+            loadData.tris[i][c] = static_cast<unsigned int>(3 * i + c);
+        }
+    });
+
+    WeldVertices(loadData.verts, loadData.tris);
+
+    // Slivers shorter than the welding tolerance collapse
+    const auto degenerate = [](const glm::uvec3& t) {
+        return t[0] == t[1] || t[1] == t[2] || t[2] == t[0];
+    };
+    const size_t numDegenerate =
+        std::count_if(loadData.tris.begin(), loadData.tris.end(), degenerate);
+    if (numDegenerate > 0) {
+        std::cerr << "Warning: dropped " << numDegenerate << " degenerate triangles" << std::endl;
+        loadData.tris.erase(
+            std::remove_if(loadData.tris.begin(), loadData.tris.end(), degenerate),
+            loadData.tris.end());
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Geometry/Mesh.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glm.hpp>
+
+/*! \brief Reads binary stl files into a mesh.
+ * stl stores every triangle with its own three corners, so corners at the
+ * same position are welded into one vertex, and triangles that collapse in
+ * the process are dropped. The stored face normals are not used. The
+ * little endian numbers are read correctly on big endian machines too.
+ */
+class StlIO {
+public:
+    StlIO() {}
+
+    //! Loads a file through a memory mapping, false return on error
+    bool Load(Mesh*, const std::string& filename);
+    bool Load(Mesh*, std::istream& is);  // false return on error
+
+protected:
+    //! Parses a whole stl file held in memory into loadData
+    bool Parse(const char* begin, const char* end);
+
+    //! Builds mesh from loadData
+    bool Build(Mesh* mesh);
+
+    struct LoadData {
+        std::vector<glm::vec3> verts;
+        std::vector<glm::uvec3> tris;
+    } loadData;
+};
@@ -0,0 +1,101 @@
+#include <Util/ThreadPool.h>
+#include <cstdlib>
+
+namespace {
+// Set while a thread executes chunks, nested loops then run serially
+thread_local bool tInsideLoop = false;
+// Only one loop at a time is handed to the workers
+std::mutex gRunMutex;
+}  // namespace
+
+ThreadPool& ThreadPool::Instance() {
+    // MOA_NUM_THREADS overrides the number of hardware threads
+    static ThreadPool pool([] {
+        const char* env = std::getenv("MOA_NUM_THREADS");
+        const long n = env ? std::strtol(env, NULL, 10) : 0;
+        return n > 0 ? size_t(n) : size_t(std::max(1u, std::thread::hardware_concurrency()));
+    }());
+    return pool;
+}
+
+ThreadPool::ThreadPool(size_t numThreads)
+    : mJob(NULL)
+    , mBegin(0)
+    , mEnd(0)
+    , mGrain(1)
+    , mNextChunk(0)
+    , mNumChunks(0)
+    , mGeneration(0)
+    , mBusy(0)
+    , mQuit(false) {
+    for (size_t i = 1; i < numThreads; i++) {
+        mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_all();
+    for (std::thread& t : mWorkers) t.join();
+}
+
+void ThreadPool::Run(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn) {
+    grain = std::max<size_t>(grain, 1);
+    if (tInsideLoop || mWorkers.empty()) {
+        for (size_t b = begin; b < end; b += grain) fn(b, std::min(end, b + grain));
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(gRunMutex);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJob = &fn;
+        mBegin = begin;
+        mEnd = end;
+        mGrain = grain;
+        mNumChunks = (end - begin + grain - 1) / grain;
+        mNextChunk = 0;
+        mBusy = mWorkers.size();
+        mGeneration++;
+    }
+    mWake.notify_all();
+
+    ProcessChunks();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return mBusy == 0; });
+    mJob = NULL;
+}
+
+void ThreadPool::ProcessChunks() {
+    tInsideLoop = true;
+    for (size_t c = mNextChunk++; c < mNumChunks; c = mNextChunk++) {
+        const size_t b = mBegin + c * mGrain;
+        (*mJob)(b, std::min(mEnd, b + mGrain));
+    }
+    tInsideLoop = false;
+}
+
+void ThreadPool::WorkerLoop() {
+    size_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [&] { return mQuit || mGeneration != generation; });
+            if (mQuit) return;
+            generation = mGeneration;
+        }
+
+        ProcessChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mBusy--;
+        }
+        mDone.notify_one();
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*! \brief A shared pool of worker threads for data parallel loops.
+ *
+ * The pool is created on first use with one worker per hardware thread
+ * (the calling thread is one of them), or MOA_NUM_THREADS if that is set.
+ * Work is handed out in chunks of a fixed grain size, so how a range is
+ * split never depends on the number of threads. Loops started from inside
+ * a worker run serially.
+ */
+class ThreadPool {
+public:
+    //! The pool shared by all meshes and algorithms
+    static ThreadPool& Instance();
+
+    //! Number of threads taking part in a parallel loop, including the caller
+    size_t GetNumThreads() const { return mWorkers.size() + 1; }
+
+    /*! Calls fn(chunkBegin, chunkEnd) for consecutive chunks of at most
+     * grain elements covering [begin, end), and waits for all of them.
+     */
+    void Run(size_t begin, size_t end, size_t grain,
+             const std::function<void(size_t, size_t)>& fn);
+
+    ~ThreadPool();
+
+protected:
+    explicit ThreadPool(size_t numThreads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void WorkerLoop();
+    void ProcessChunks();
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+
+    // The currently running loop
+    const std::function<void(size_t, size_t)>* mJob;
+    size_t mBegin, mEnd, mGrain;
+    std::atomic<size_t> mNextChunk;
+    size_t mNumChunks;
+    size_t mGeneration;
+    size_t mBusy;
+    bool mQuit;
+};
+
+//! Default number of elements processed per chunk
+static const size_t DefaultGrain = 4096;
+
+/*! Runs fn(chunkBegin, chunkEnd) over [begin, end) in parallel
+ */
+template <typename Func>
+inline void ParallelForChunks(size_t begin, size_t end, Func fn, size_t grain = DefaultGrain) {
+    if (end <= begin) return;
+    if (end - begin <= grain) {
+        fn(begin, end);
+        return;
+    }
+    ThreadPool::Instance().Run(begin, end, grain, std::function<void(size_t, size_t)>(fn));
+}
+
+/*! Runs fn(i) for every i in [begin, end) in parallel
+ */
+template <typename Func>
+inline void ParallelFor(size_t begin, size_t end, Func fn, size_t grain = DefaultGrain) {
+    ParallelForChunks(
+        begin, end,
+        [&fn](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) fn(i);
+        },
+        grain);
+}
+
+/*! Reduces [begin, end) in parallel. Each chunk of grain elements is
+ * reduced by chunkFn(chunkBegin, chunkEnd) and the partial results are
+ * folded into init with combine in chunk order. The chunks don't depend on
+ * the number of threads, so neither does the result, also for floating
+ * point sums.
+ */
+template <typename T, typename ChunkFunc, typename Combine>
+inline T ParallelReduce(size_t begin, size_t end, T init, ChunkFunc chunkFn, Combine combine,
+                        size_t grain = DefaultGrain) {
+    if (end <= begin) return init;
+    grain = std::max<size_t>(grain, 1);
+    std::vector<T> partial((end - begin + grain - 1) / grain, init);
+    ParallelForChunks(
+        begin, end, [&](size_t b, size_t e) { partial[(b - begin) / grain] = chunkFn(b, e); },
+        grain);
+    for (const T& p : partial) init = combine(init, p);
+    return init;
+}
+
+/*! Sorts [first, last) by sorting fixed size blocks in parallel and then
+ * merging neighbouring blocks pairwise.
+ */
+template <typename Iter, typename Compare>
+inline void ParallelSort(Iter first, Iter last, Compare comp, size_t grain = 1 << 16) {
+    const size_t n = static_cast<size_t>(last - first);
+    if (n <= grain) {
+        std::sort(first, last, comp);
+        return;
+    }
+    const size_t numBlocks = (n + grain - 1) / grain;
+    ParallelFor(
+        0, numBlocks,
+        [&](size_t b) {
+            std::sort(first + b * grain, first + std::min(n, (b + 1) * grain), comp);
+        },
+        1);
+    for (size_t width = grain; width < n; width *= 2) {
+        const size_t numMerges = (n + 2 * width - 1) / (2 * width);
+        ParallelFor(
+            0, numMerges,
+            [&](size_t m) {
+                const size_t lo = m * 2 * width;
+                const size_t mid = std::min(n, lo + width);
+                const size_t hi = std::min(n, lo + 2 * width);
+                if (mid < hi) std::inplace_merge(first + lo, first + mid, first + hi, comp);
+            },
+            1);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm.hpp>
+
+/*! \brief Takes the triangles of a mesh one at a time while a file is read.
+ * The readers call BeginTriangles with the bounding box of the vertices,
+ * then AddTriangle for every triangle with its corners counter clockwise,
+ * and EndTriangles when the file is done. If reading fails half way,
+ * EndTriangles is not called.
+ */
+class TriangleSink {
+public:
+    virtual ~TriangleSink() {}
+
+    virtual void BeginTriangles(const glm::vec3& min, const glm::vec3& max) = 0;
+    virtual void AddTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) = 0;
+    virtual void EndTriangles() = 0;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/*! \brief Disjoint sets that can be merged from several threads at once.
+ *
+ * Every element points to a parent, the roots name the sets. Unite links
+ * the root with the larger index below the one with the smaller index
+ * with a compare-and-swap that only succeeds while the linked element is
+ * still a root, so no locks are needed. Find halves the path it walks
+ * with a compare-and-swap as well. As parents always have a smaller index
+ * than their children the root of a set is its smallest element, no
+ * matter in which order the threads merged the sets.
+ */
+template <typename IndexT = uint32_t>
+class UnionFind {
+public:
+    explicit UnionFind(size_t size) : mParent(new std::atomic<IndexT>[size]), mSize(size) {
+        for (size_t i = 0; i < size; i++) {
+            mParent[i].store(static_cast<IndexT>(i), std::memory_order_relaxed);
+        }
+    }
+
+    size_t size() const { return mSize; }
+
+    //! Return the root of the set containing x
+    size_t Find(size_t x) {
+        while (true) {
+            IndexT parent = mParent[x].load(std::memory_order_relaxed);
+            if (parent == x) return x;
+            const IndexT grandParent = mParent[parent].load(std::memory_order_relaxed);
+            // Skipping a level is only a shortcut, it is fine if another thread got there first
+            if (parent != grandParent) {
+                mParent[x].compare_exchange_weak(parent, grandParent, std::memory_order_relaxed);
+            }
+            x = grandParent;
+        }
+    }
+
+    //! Merge the sets containing a and b
+    void Unite(size_t a, size_t b) {
+        while (true) {
+            a = Find(a);
+            b = Find(b);
+            if (a == b) return;
+            if (a < b) std::swap(a, b);
+            // Fails if a stopped being a root in between, then try again from the new roots
+            IndexT expected = static_cast<IndexT>(a);
+            if (mParent[a].compare_exchange_strong(expected, static_cast<IndexT>(b))) return;
+        }
+    }
+
+protected:
+    std::unique_ptr<std::atomic<IndexT>[]> mParent;
+    size_t mSize;
+};
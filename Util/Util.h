@@ -2,6 +2,8 @@
 
 #include <algorithm>  //for transform
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <glm.hpp>
 #include <iostream>
@@ -160,15 +162,24 @@ inline uint32_t EndianSwap(uint32_t x) {
     return ((x >> 24) | ((x << 8) & 0x00FF0000) | ((x >> 8) & 0x0000FF00) | (x << 24));
 }
 
-//! Byte swap array, only works for 32bit types
+/*! Byte swap array of any fixed size type (int16, float, double, ...).
+ * The values are copied through memcpy, writing a float through a
+ * uint32_t pointer would break strict aliasing.
+ */
 template <typename T>
 inline void EndianSwap(T* data, size_t num) {
     if (sizeof(T) == sizeof(uint32_t)) {
-        auto tmpPtr = reinterpret_cast<uint32_t*>(data);
-        std::transform(tmpPtr, tmpPtr + num, tmpPtr, [](const auto x) {
-            return ((x >> 24) | ((x << 8) & 0x00FF0000) | ((x >> 8) & 0x0000FF00) | (x << 24));
-        });
+        auto bytes = reinterpret_cast<unsigned char*>(data);
+        for (size_t i = 0; i < num; i++) {
+            uint32_t x;
+            std::memcpy(&x, bytes + 4 * i, 4);
+            x = EndianSwap(x);
+            std::memcpy(bytes + 4 * i, &x, 4);
+        }
     } else {
-        // badness
+        auto bytes = reinterpret_cast<unsigned char*>(data);
+        for (size_t i = 0; i < num; i++) {
+            std::reverse(bytes + i * sizeof(T), bytes + (i + 1) * sizeof(T));
+        }
     }
 }
\ No newline at end of file